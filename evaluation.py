@@ -509,6 +509,74 @@ class Performance( Experiment ):
 
     # end class performance
 
+class Placement( Performance ):
+    """
+    The class for comparing the instrumentation placements: the
+    early default and -tasksan-late-placement, which instruments
+    after mem2reg, SROA and LICM. It reports the access checks the
+    pass keeps and the slowdown of each placement.
+
+    Example: ./evaluation.py placement RacyFibonacci 30
+    """
+    def __init__( self ):
+        Experiment.__init__(self)
+        self.repetitions = 20
+        self.placements = {"early": [], "late": ["-tasksan-late-placement"]}
+
+    def compileInstrumentedApp( self, appName, placement ):
+        outName  = "./." + appName + placement + ".exe"
+        command = ["./tasksan", "-o", outName,
+                   "-mllvm", "-tasksan-report-eliminated"]
+        for flag in self.placements[placement]:
+            command.extend(["-mllvm", flag])
+        command.extend( BenchArgFactory.getInstance( appName ).getFullCommand() )
+        p = subprocess.Popen(command, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+        out, err = p.communicate()
+        checks = 0
+        for count in re.findall(r"(\d+) access checks at", err):
+            checks = checks + int(count)
+        return checks
+
+    def runPlacedApp( self, appName, placement, inputSize ):
+        command  = ["./." + appName + placement + ".exe"]
+        command.extend( BenchArgFactory.getInstance(appName).getFormattedInput(inputSize) )
+        start = clock()
+        self.execute( command )
+        return (clock() - start)
+
+    def runExperiments( self ):
+        head = ["Application", "Input size", "Checks early", "Checks late",
+                "Slowdown early", "Slowdown late"]
+        row_format ="| {:<27}| {:<11}| {:<13}| {:<12}| {:<15}| {:<14}|"
+        print row_format.format(*head)
+        for app in self.apps:
+            app = app.replace(".cc", "")
+            self.compileOriginalApp( app )
+            checks = {}
+            for placement in self.placements:
+                checks[placement] = self.compileInstrumentedApp( app, placement )
+            inputs = self.inputSizes
+            if len(inputs) < 1:
+                inputs = BenchArgFactory.getInstance(app).getPerformanceInputs()[:1]
+            if len(inputs) < 1:
+                inputs = [16]
+
+            for inputSz in inputs:
+                times = {"orig": 0, "early": 0, "late": 0}
+                for iter in range( self.repetitions ):
+                    times["orig"] += self.runOriginalApp( app, str(inputSz) )
+                    for placement in self.placements:
+                        times[placement] += self.runPlacedApp( app, placement, str(inputSz) )
+                if times["orig"] <= 0:
+                    print "ERROR: execution time zero!"
+                    continue
+                row = [app, inputSz, checks["early"], checks["late"],
+                       round( times["early"] / times["orig"], 2),
+                       round( times["late"] / times["orig"], 2)]
+                print row_format.format(*row)
+
+    # end class Placement
+
 class Help( object ):
     """
     Help is invoked when user supplies wrong command
@@ -517,7 +585,7 @@ class Help( object ):
     def __init__( self ):
         print "./evaluation.py <experiment> <application> <input size>"
         print ""
-        print "    <experiment> is \"correctness\" or \"performance\" or \"archer\""
+        print "    <experiment> is \"correctness\", \"performance\", \"placement\" or \"archer\""
         print "    <application> can be one of:"
         print "         RacyBackgroundExample"
         print "         RacyBanking"
@@ -553,6 +621,9 @@ if __name__ == "__main__":
             performance = Performance()
             performance.runExperiments()
             print "Performance"
+        elif option == "placement":
+            placement = Placement()
+            placement.runExperiments()
         elif option == "help":
             Help()
         else:
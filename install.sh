@@ -312,6 +312,11 @@ CXX=clang++ cmake -G Ninja ${taskSanHomeDir}/src/instrumentor
 ninja
 reportIfSuccessful "Compiling TaskSanitizer runtime"
 
+mkdir -p ${buildsDir}/analyzer-build && cd ${buildsDir}/analyzer-build
+CXX=clang++ cmake -G Ninja ${taskSanHomeDir}/src/analyzer
+ninja
+reportIfSuccessful "Compiling TaskSanitizer trace analyzer"
+
 mkdir -p ${buildsDir}/tasksan-build && cd ${buildsDir}/tasksan-build
 rm -rf libTaskSanitizer.so
 CXX=clang++ cmake -G Ninja ${taskSanHomeDir}/src/instrumentor/pass/
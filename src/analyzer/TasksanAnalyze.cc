@@ -0,0 +1,81 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// tasksan-analyze checks a trace recorded by running a program
+// with TASKSAN_RECORD=<trace> and prints the determinacy races
+// the online checker would have reported. The accesses are
+// checked by detector threads, split by address like with
+// TASKSAN_DETECTOR_THREADS, while one thread replays the events.
+//
+// Usage: tasksan-analyze [-j workers] <trace>
+//   -j 0 checks everything on the replaying thread
+
+#include "detector/determinacy/traceReader.h"
+#include "detector/determinacy/checker.h"
+#include "detector/determinacy/asyncChecker.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+static int usage(const char * program) {
+  std::cerr << "Usage: " << program << " [-j workers] <trace>" << std::endl;
+  return 1;
+}
+
+int main(int argc, char * argv[]) {
+  unsigned workers = std::thread::hardware_concurrency();
+  const char * path = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-j") && i + 1 < argc) {
+      workers = atoi(argv[++i]);
+    } else if (!strncmp(argv[i], "-j", 2) && argv[i][2]) {
+      workers = atoi(argv[i] + 2);
+    } else if (argv[i][0] == '-' || path) {
+      return usage(argv[0]);
+    } else {
+      path = argv[i];
+    }
+  }
+  if (!path) return usage(argv[0]);
+
+  TraceReader reader;
+  std::string error;
+  if (!reader.open(path, error) || !reader.registerSites(error)) {
+    std::cerr << "tasksan-analyze: " << error << std::endl;
+    return 1;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  Checker checker;
+  bool replayed;
+  if (workers) {
+    AsyncChecker asyncChecker(checker, workers);
+    replayed = reader.replay(asyncChecker, error);
+  } else {
+    replayed = reader.replay(checker, error);
+  }
+  if (!replayed) {
+    std::cerr << "tasksan-analyze: " << error << std::endl;
+    return 1;
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  std::cerr << "tasksan-analyze: " << reader.getEventCount()
+            << " task events and " << reader.getAccessCount()
+            << " accesses of " << reader.getStreamCount()
+            << " threads checked in " << elapsed.count() << " s" << std::endl;
+  checker.reportConflicts();
+  return 0;
+}
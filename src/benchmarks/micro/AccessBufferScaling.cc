@@ -0,0 +1,143 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// Measures access throughput of the detector from 1 to N threads.
+// Each thread plays one task and issues reads and writes on its
+// own block of addresses. Three paths are compared:
+//  mutex:    a global lock is taken for every access, as the
+//            runtime did before per-thread buffers
+//  buffered: accesses are appended to a per-thread AccessBuffer
+//            and drained into the checker in batches; the
+//            checker synchronizes them per address shard
+//  async:    full buffers are queued to detector threads of an
+//            AsyncChecker, split by the address slice each worker
+//            owns. Two numbers are printed: the rate seen
+//            by the application threads, and the rate until the
+//            detector threads have checked everything.
+//
+// Usage: accessBufferScaling [max threads] [accesses per thread]
+//                            [detector workers]
+
+#include "detector/determinacy/checker.h"
+#include "detector/determinacy/asyncChecker.h"
+#include "instrumentor/eventlogger/AccessBuffer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define ADDRESSES_PER_TASK 4096
+
+static std::mutex checkerLock;
+static AsyncChecker * asyncChecker;
+
+static AccessRecord makeAccess(int taskID, long i) {
+  AccessRecord access;
+  access.accessing_task_id = taskID;
+  access.destination_address =
+      (ADDRESS)(((long)taskID << 20) + (i % ADDRESSES_PER_TASK) * 8);
+  access.value_written = i;
+  access.source_site_id = 1 + (i & 7);
+  access.is_write_action = (i & 3) == 0;
+  return access;
+}
+
+static void mutexPath(Checker * checker, int taskID, long accesses) {
+  for (long i = 0; i < accesses; i++) {
+    AccessRecord access = makeAccess(taskID, i);
+    checkerLock.lock();
+    checker->saveMemoryAccess(access);
+    checkerLock.unlock();
+  }
+}
+
+static void bufferedPath(Checker * checker, int taskID, long accesses) {
+  AccessBuffer * buffer = new AccessBuffer();
+  for (long i = 0; i < accesses; i++) {
+    buffer->append(makeAccess(taskID, i));
+    if ( buffer->isFull() ) {
+      checker->saveMemoryAccesses(buffer->records, buffer->count);
+      buffer->clear();
+    }
+  }
+  // task end
+  checker->saveMemoryAccesses(buffer->records, buffer->count);
+  delete buffer;
+}
+
+static void asyncPath(Checker * checker, int taskID, long accesses) {
+  AccessBuffer * buffer = new AccessBuffer();
+  for (long i = 0; i < accesses; i++) {
+    buffer->append(makeAccess(taskID, i));
+    if ( buffer->isFull() ) {
+      asyncChecker->saveMemoryAccesses(buffer->records, buffer->count);
+      buffer->clear();
+    }
+  }
+  asyncChecker->saveMemoryAccesses(buffer->records, buffer->count);
+  delete buffer;
+}
+
+// Returns millions of accesses per second. With detector threads,
+// drained is set to the rate until all accesses are checked.
+static double run(int threads, long accesses,
+                  void (*path)(Checker *, int, long),
+                  unsigned detectors = 0, double * drained = NULL) {
+  Checker checker;
+  checker.registerFuncSignature("bench", 1);
+  for (int t = 1; t <= threads; t++) {
+    checker.onTaskCreate(t);
+  }
+  if (detectors) asyncChecker = new AsyncChecker(checker, detectors);
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (int t = 1; t <= threads; t++) {
+    workers.push_back(std::thread(path, &checker, t, accesses));
+  }
+  for (auto & worker : workers) worker.join();
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  if (detectors) {
+    delete asyncChecker;
+    std::chrono::duration<double> total =
+        std::chrono::steady_clock::now() - start;
+    *drained = (threads * accesses) / total.count() / 1e6;
+  }
+  return (threads * accesses) / elapsed.count() / 1e6;
+}
+
+int main(int argc, char * argv[]) {
+  int maxThreads = std::thread::hardware_concurrency();
+  long accesses = 1000000;
+  if (argc > 1) maxThreads = atoi(argv[1]);
+  unsigned detectors = 1;
+  if (argc > 2) accesses = atol(argv[2]);
+  if (argc > 3) detectors = atoi(argv[3]);
+  if (maxThreads < 1) maxThreads = 1;
+
+  printf("threads  mutex(M acc/s)  buffered(M acc/s)"
+         "  async(M acc/s)  async drained(M acc/s)\n");
+  for (int threads = 1; threads <= maxThreads; threads *= 2) {
+    double locked = run(threads, accesses, mutexPath);
+    double buffered = run(threads, accesses, bufferedPath);
+    double drained = 0;
+    double async = run(threads, accesses, asyncPath, detectors, &drained);
+    printf("%7d  %14.2f  %17.2f  %14.2f  %22.2f\n", threads, locked,
+           buffered, async, drained);
+  }
+  return 0;
+}
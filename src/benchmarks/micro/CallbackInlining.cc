@@ -0,0 +1,103 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// Measures what inlining the fast path of the access callbacks
+// saves per access. Each access runs the body of __tasksan_read8
+// or __tasksan_write8 (task lookup, filter check, buffering)
+// either through an opaque call, as with libLogger, or inlined,
+// as when libLoggerFast.bc is linked in with TASKSAN_LTO. Two
+// access patterns are timed:
+//   filtered:  words the task accessed before, dropped by the
+//              access filter without reaching the buffer
+//   buffered:  new words, appended to the buffer and checked
+//
+// Usage: callbackInlining [accesses]
+
+#include "instrumentor/eventlogger/Logger.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static thread_local TaskInfo * currentTask = NULL;
+
+// the bodies of the read and write callbacks
+static inline void readAccess(void * addr, int siteID) {
+  TaskInfo * task = currentTask;
+  if (task && task->active) INS::Read(*task, addr, siteID);
+}
+
+static inline void writeAccess(void * addr, long value, int siteID) {
+  TaskInfo * task = currentTask;
+  if (task && task->active) INS::Write(*task, addr, value, siteID);
+}
+
+__attribute__((noinline)) static void readCall(void * addr, int siteID) {
+  readAccess(addr, siteID);
+}
+
+__attribute__((noinline)) static void writeCall(void * addr, long value,
+                                                int siteID) {
+  writeAccess(addr, value, siteID);
+}
+
+// called through pointers so that the calls cannot be inlined
+static void (* volatile readCallback)(void *, int) = readCall;
+static void (* volatile writeCallback)(void *, long, int) = writeCall;
+
+// Returns ns per access of reading and writing words
+// [0, words) of data in turn, accesses times in total
+template <bool Inlined>
+static double run(long * data, long words, long accesses) {
+  void (* read)(void *, int) = readCallback;
+  void (* write)(void *, long, int) = writeCallback;
+  TaskInfo task;
+  task.taskID = 1;
+  task.active = true;
+  currentTask = &task;
+
+  auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < accesses; i += 2) {
+    long * word = &data[i % words];
+    if (Inlined) {
+      readAccess(word, 1);
+      writeAccess(word, i % words, 2);
+    } else {
+      read(word, 1);
+      write(word, i % words, 2);
+    }
+  }
+  INS::flushAccesses();
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  currentTask = NULL;
+  return elapsed.count() / accesses;
+}
+
+int main(int argc, char * argv[]) {
+  long accesses = 20000000;
+  if (argc > 1) accesses = atol(argv[1]);
+
+  const long filteredWords = ACCESS_FILTER_SLOTS / 2;
+  const long bufferedWords = 1 << 22;
+  std::vector<long> data(bufferedWords);
+
+  printf("pattern    call(ns/access)  inlined(ns/access)\n");
+  double call = run<false>(data.data(), filteredWords, accesses);
+  double inlined = run<true>(data.data(), filteredWords, accesses);
+  printf("filtered   %15.2f  %18.2f\n", call, inlined);
+  call = run<false>(data.data(), bufferedWords, accesses);
+  inlined = run<true>(data.data(), bufferedWords, accesses);
+  printf("buffered   %15.2f  %18.2f\n", call, inlined);
+  return 0;
+}
@@ -0,0 +1,69 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// Measures the average latency of the instrumentation callbacks
+// of reads and writes done inside OpenMP tasks. Every task works
+// on its own array, so no determinacy race is reported and the
+// time is spent in the access callbacks. Compare the numbers of
+// an instrumented build with those of a plain build.
+//
+// Build and run:
+//   ./tasksan -O2 src/benchmarks/micro/CallbackLatency.cc -o latency
+//   clang++ -fopenmp -O2 src/benchmarks/micro/CallbackLatency.cc -o plain
+//   ./latency [tasks] [accesses per task]
+//   TASKSAN_SAMPLING=address=0.1 ./latency   (sampling mode)
+// The read and write of an iteration are reported by one batch
+// call; add -mllvm -tasksan-batch-accesses=false to the build to
+// measure one callback per access, and build with TASKSAN_LTO=lld
+// to measure the callbacks inlined (see CallbackInlining.cc).
+
+#include <omp.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#define ARRAY_SIZE 1024
+
+static void taskBody(long * data, long accesses) {
+  for (long i = 0; i < accesses; i++) {
+    long slot = i % ARRAY_SIZE;
+    data[slot] = data[slot] + i; // one read and one write
+  }
+}
+
+int main(int argc, char * argv[]) {
+  int tasks = 64;
+  long accesses = 100000;
+  if (argc > 1) tasks = atoi(argv[1]);
+  if (argc > 2) accesses = atol(argv[2]);
+
+  long * data = (long *)calloc((size_t)tasks * ARRAY_SIZE, sizeof(long));
+
+  auto start = std::chrono::steady_clock::now();
+#pragma omp parallel
+#pragma omp single
+  {
+    for (int t = 0; t < tasks; t++) {
+#pragma omp task firstprivate(t)
+      taskBody(&data[(size_t)t * ARRAY_SIZE], accesses);
+    }
+#pragma omp taskwait
+  }
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  double total = 2.0 * tasks * accesses;
+  printf("threads: %d, accesses: %.0f, ns per access: %.2f\n",
+         omp_get_max_threads(), total, elapsed.count() / total);
+  free(data);
+  return 0;
+}
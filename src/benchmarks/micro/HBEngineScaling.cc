@@ -0,0 +1,117 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// Compares the happens-before engines on two task graphs, replayed
+// with the task events the runtime sends to the checker:
+//  fib:   the recursion of RacyFibonacci, two spawns and a
+//         taskwait per call, sent as fork-join events
+//  chain: a pipeline where every task depends on the one before
+// For each engine it prints the time to build the graph and the
+// time of random happens-before queries.
+//
+// Usage: hbEngineScaling [fib n] [chain length] [queries]
+
+#include "detector/determinacy/serialBagEngine.h"
+#include "detector/determinacy/vectorClockEngine.h"
+#include "detector/determinacy/spOrderEngine.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+typedef std::chrono::duration<double, std::milli> Millis;
+
+static int nextTaskID;
+
+static int newTask(HBEngine & engine) {
+  int taskID = nextTaskID++;
+  engine.onTaskCreate(taskID);
+  return taskID;
+}
+
+// Replays fib(n) from segment seg and returns its last segment
+static int fib(HBEngine & engine, int seg, int n) {
+  if (n < 2) return seg;
+
+  int child1 = newTask(engine);
+  engine.onTaskSpawn(seg, child1);
+  int cont1 = newTask(engine);
+  engine.onTaskContinue(seg, cont1);
+  fib(engine, child1, n - 1);
+
+  int child2 = newTask(engine);
+  engine.onTaskSpawn(cont1, child2);
+  int cont2 = newTask(engine);
+  engine.onTaskContinue(cont1, cont2);
+  fib(engine, child2, n - 2);
+
+  // taskwait
+  int after = newTask(engine);
+  engine.onTaskSync(cont2, after, {child1, child2});
+  return after;
+}
+
+static VOID buildFib(HBEngine & engine, int n) {
+  fib(engine, newTask(engine), n);
+}
+
+static VOID buildChain(HBEngine & engine, int length) {
+  int prev = newTask(engine);
+  for (int i = 1; i < length; i++) {
+    int task = newTask(engine);
+    engine.saveHappensBeforeEdge(prev, task);
+    prev = task;
+  }
+}
+
+static VOID run(const char * graph, HBEngine * engine,
+                VOID (*build)(HBEngine &, int), int size, long queries) {
+  nextTaskID = 0;
+  auto start = std::chrono::steady_clock::now();
+  build(*engine, size);
+  Millis buildTime = std::chrono::steady_clock::now() - start;
+
+  std::mt19937 random(42);
+  std::uniform_int_distribution<int> pick(0, nextTaskID - 1);
+  long ordered = 0;
+  start = std::chrono::steady_clock::now();
+  for (long q = 0; q < queries; q++) {
+    const VOID * view = engine->getTaskView(pick(random));
+    ordered += engine->happensBefore(view, pick(random));
+  }
+  Millis queryTime = std::chrono::steady_clock::now() - start;
+
+  printf("%-6s %-37s %9d %12.2f %12.2f %9ld\n", graph, engine->getName(),
+         nextTaskID, buildTime.count(), queryTime.count(), ordered);
+  delete engine;
+}
+
+int main(int argc, char * argv[]) {
+  int fibN = 18;
+  int chainLength = 20000;
+  long queries = 1000000;
+  if (argc > 1) fibN = atoi(argv[1]);
+  if (argc > 2) chainLength = atoi(argv[2]);
+  if (argc > 3) queries = atol(argv[3]);
+
+  printf("graph  engine                                    tasks"
+         "   build(ms)   query(ms)   ordered\n");
+  // without retirement, so that every task can be queried
+  run("fib", new SerialBagEngine(false), buildFib, fibN, queries);
+  run("fib", new VectorClockEngine(), buildFib, fibN, queries);
+  run("fib", new SPOrderEngine(), buildFib, fibN, queries);
+  run("chain", new SerialBagEngine(false), buildChain, chainLength, queries);
+  run("chain", new VectorClockEngine(), buildChain, chainLength, queries);
+  run("chain", new SPOrderEngine(), buildChain, chainLength, queries);
+  return 0;
+}
@@ -0,0 +1,126 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// Measures the heap used by the serial-bag engine with and
+// without retirement of ended tasks. Two task graphs are
+// replayed with the events the runtime sends to the checker:
+//  flat: one task spawns all others, with a taskwait every
+//        64 children
+//  fib:  the recursion of RacyFibonacci, two spawns and a
+//        taskwait per call
+// The last segment of every child ends before the taskwait of
+// its parent. Heap in use is read from mallinfo2().
+//
+// Usage: taskRetirement [flat tasks] [fib n]
+
+#include "detector/determinacy/serialBagEngine.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <malloc.h>
+
+#define FLAT_BATCH 64
+
+typedef std::chrono::duration<double, std::milli> Millis;
+
+static int nextTaskID;
+
+static int newTask(HBEngine & engine) {
+  int taskID = nextTaskID++;
+  engine.onTaskCreate(taskID);
+  return taskID;
+}
+
+// Replays fib(n) from segment seg and returns its last segment
+static int fib(HBEngine & engine, int seg, int n) {
+  if (n < 2) return seg;
+
+  int child1 = newTask(engine);
+  engine.onTaskSpawn(seg, child1);
+  int cont1 = newTask(engine);
+  engine.onTaskContinue(seg, cont1);
+  engine.onTaskEnd(fib(engine, child1, n - 1));
+
+  int child2 = newTask(engine);
+  engine.onTaskSpawn(cont1, child2);
+  int cont2 = newTask(engine);
+  engine.onTaskContinue(cont1, cont2);
+  engine.onTaskEnd(fib(engine, child2, n - 2));
+
+  // taskwait
+  int after = newTask(engine);
+  engine.onTaskSync(cont2, after, {child1, child2});
+  return after;
+}
+
+static VOID buildFib(HBEngine & engine, int n) {
+  engine.onTaskEnd(fib(engine, newTask(engine), n));
+}
+
+static VOID buildFlat(HBEngine & engine, int tasks) {
+  int seg = newTask(engine);
+  std::vector<int> children;
+  while (nextTaskID < tasks) {
+    int child = newTask(engine);
+    engine.onTaskSpawn(seg, child);
+    int cont = newTask(engine);
+    engine.onTaskContinue(seg, cont);
+    engine.onTaskEnd(child);
+    children.push_back(child);
+    seg = cont;
+
+    if (children.size() == FLAT_BATCH) {
+      int after = newTask(engine);
+      engine.onTaskSync(seg, after, children);
+      children.clear();
+      seg = after;
+    }
+  }
+  engine.onTaskEnd(seg);
+}
+
+static size_t heapInUse() {
+  return mallinfo2().uordblks;
+}
+
+static VOID run(const char * graph, bool retire,
+                VOID (*build)(HBEngine &, int), int size) {
+  nextTaskID = 0;
+  size_t before = heapInUse();
+  auto start = std::chrono::steady_clock::now();
+  SerialBagEngine * engine = new SerialBagEngine(retire);
+  build(*engine, size);
+  Millis buildTime = std::chrono::steady_clock::now() - start;
+  size_t after = heapInUse();
+
+  printf("%-5s %-7s %9d %10.2f %11.1f %9zu %9zu %9zu\n", graph,
+         retire ? "on" : "off", nextTaskID, buildTime.count(),
+         (after - before) / (1024.0 * 1024.0), engine->liveTaskCount(),
+         engine->retiredTaskCount(), engine->releasedTaskCount());
+  delete engine;
+}
+
+int main(int argc, char * argv[]) {
+  int flatTasks = 4000;  // HB sets of the parent grow linearly
+  int fibN = 26;
+  if (argc > 1) flatTasks = atoi(argv[1]);
+  if (argc > 2) fibN = atoi(argv[2]);
+
+  printf("graph retire      tasks  build(ms)   heap(MiB)      live"
+         "   retired  released\n");
+  run("flat", false, buildFlat, flatTasks);
+  run("flat", true, buildFlat, flatTasks);
+  run("fib", false, buildFib, fibN);
+  run("fib", true, buildFib, fibN);
+  return 0;
+}
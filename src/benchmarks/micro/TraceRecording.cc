@@ -0,0 +1,123 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// Measures record mode. Each thread plays one task and records
+// reads and writes on its own block of addresses, drained in
+// AccessBuffer sized batches like the runtime does. Prints the
+// recording rate, the trace size per access, and the rate of
+// replaying the trace into the checker with 0 (replaying thread
+// only) and the given number of detector workers.
+//
+// Usage: traceRecording [threads] [accesses per thread]
+//                       [detector workers] [trace path]
+
+#include "detector/determinacy/traceWriter.h"
+#include "detector/determinacy/traceReader.h"
+#include "detector/determinacy/asyncChecker.h"
+#include "instrumentor/eventlogger/AccessBuffer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#define ADDRESSES_PER_TASK 4096
+
+static SourceSite sites[8];
+
+static AccessRecord makeAccess(int taskID, long i, uint32_t siteBase) {
+  AccessRecord access;
+  access.accessing_task_id = taskID;
+  access.destination_address =
+      (ADDRESS)(((long)taskID << 20) + (i % ADDRESSES_PER_TASK) * 8);
+  access.value_written = i;
+  access.source_site_id = siteBase + (i & 7);
+  access.is_write_action = (i & 3) == 0;
+  return access;
+}
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+static double analyze(const char * path, unsigned workers) {
+  TraceReader reader;
+  std::string error;
+  if (!reader.open(path, error)) {
+    fprintf(stderr, "%s\n", error.c_str());
+    exit(1);
+  }
+  auto start = std::chrono::steady_clock::now();
+  Checker checker;
+  if (workers) {
+    AsyncChecker async(checker, workers);
+    reader.replay(async, error);
+  } else {
+    reader.replay(checker, error);
+  }
+  return reader.getAccessCount() / seconds(start) / 1e6;
+}
+
+int main(int argc, char * argv[]) {
+  int threads = 4;
+  long accesses = 1000000;
+  unsigned workers = 2;
+  const char * path = "/tmp/traceRecording.trace";
+  if (argc > 1) threads = atoi(argv[1]);
+  if (argc > 2) accesses = atol(argv[2]);
+  if (argc > 3) workers = atoi(argv[3]);
+  if (argc > 4) path = argv[4];
+
+  for (int i = 0; i < 8; i++) {
+    sites[i] = SourceSite{"TraceRecording.cc", "task", 10u + i, 3};
+  }
+  uint32_t siteBase = SiteTable::instance().registerModule(sites, 8);
+
+  auto start = std::chrono::steady_clock::now();
+  uint64_t size;
+  {
+    TraceWriter writer(path);
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; t++) {
+      pool.push_back(std::thread([&, t]() {
+        int taskID = t + 1;
+        writer.onTaskCreate(taskID);
+        AccessBuffer buffer;
+        for (long i = 0; i < accesses; i++) {
+          buffer.records[buffer.count++] = makeAccess(taskID, i, siteBase);
+          if (buffer.isFull()) {
+            writer.saveMemoryAccesses(buffer.records, buffer.count);
+            buffer.clear();
+          }
+        }
+        writer.saveMemoryAccesses(buffer.records, buffer.count);
+        writer.onTaskEnd(taskID);
+      }));
+    }
+    for (auto & thread : pool) thread.join();
+    writer.close();
+    size = writer.size();
+  }
+  double recorded = threads * accesses / seconds(start) / 1e6;
+
+  printf("threads  record(M acc/s)  bytes/access"
+         "  analyze 0(M acc/s)  analyze %u(M acc/s)\n", workers);
+  printf("%7d  %15.2f  %12.2f  %18.2f  %18.2f\n", threads, recorded,
+         (double)size / (threads * accesses), analyze(path, 0),
+         analyze(path, workers));
+  if (argc <= 4) unlink(path);
+  return 0;
+}
@@ -0,0 +1,38 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// Defines the entries of an access batch. The compiler pass
+// collects the accesses of straight-line code, i.e. up to the end
+// of a basic block or the next call, in a stack array of entries
+// and reports them with one call:
+//
+//   __tasksan_access_batch(entries, count)
+//
+// so that the runtime looks up the task once for all of them.
+
+#ifndef _COMMON_ACCESSBATCH_H_
+#define _COMMON_ACCESSBATCH_H_
+
+#include <cstdint>
+
+// Layout must match the entries emitted by the compiler pass
+typedef struct BatchedAccess {
+  void *   address;
+  long     value;     // written value, 0 for reads
+  int32_t  site_id;   // see common/SiteTable.h
+  uint8_t  size;      // bytes accessed
+  uint8_t  is_write;
+} BatchedAccess;
+
+static_assert(sizeof(BatchedAccess) == 24, "BatchedAccess layout changed");
+
+#endif // end AccessBatch.h
@@ -0,0 +1,41 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// Defines the AccessRecord struct. It is a plain record of one
+// memory access of a task as seen by the instrumentation runtime
+// and is handed to the checker as is, without text formatting.
+// A record with a range size stands for all bytes of the range,
+// e.g. those of a memcpy; its value is not known. A strided range
+// stands for range_width bytes every range_stride bytes from its
+// address, e.g. the elements a loop touches, and spans range_size
+// bytes from the first to the end of the last element.
+
+#ifndef _COMMON_ACCESSRECORD_H_
+#define _COMMON_ACCESSRECORD_H_
+
+#include "common/defs.h"
+
+struct AccessRecord {
+  INTEGER accessing_task_id;
+  uint32_t range_size = 0; // bytes of a range access, 0 otherwise
+  uint32_t stack_id = 0;   // see functionengine/FunctionEngine.h
+  ADDRESS destination_address;
+  union {
+    VALUE    value_written;
+    uint64_t range_stride;  // of a strided range, see range_width
+  };
+  INTEGER source_site_id;  // see common/SiteTable.h
+  bool    is_write_action;
+  uint8_t range_width = 0; // bytes per stride, 0 if contiguous
+};
+
+#endif // end AccessRecord.h
@@ -0,0 +1,40 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// Defines AlignedNew, a base of types aligned beyond max_align_t,
+// e.g. to keep hot members on their own cache lines. Before C++17
+// new ignores such alignment, so these types allocate their
+// objects with posix_memalign instead.
+
+#ifndef _COMMON_ALIGNEDNEW_H_
+#define _COMMON_ALIGNEDNEW_H_
+
+#include <cstdlib>
+#include <new>
+
+template <size_t Alignment>
+struct AlignedNew {
+  static void * operator new(size_t size) {
+    void * memory;
+    if (posix_memalign(&memory, Alignment, size)) throw std::bad_alloc();
+    return memory;
+  }
+
+  static void * operator new[](size_t size) {
+    return operator new(size);
+  }
+
+  static void operator delete(void * memory) { free(memory); }
+  static void operator delete[](void * memory) { free(memory); }
+};
+
+#endif // end AlignedNew.h
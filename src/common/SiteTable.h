@@ -0,0 +1,90 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// Defines source sites of instrumented accesses. The compiler
+// pass emits a constant table of SourceSite entries per module
+// and registers it from a module constructor. Every access
+// callback then carries only a 32-bit site id:
+//
+//   site id = module base (from registration) + index in table
+//
+// Id 0 means unknown site. Sites are decoded only when a
+// determinacy race is recorded.
+
+#ifndef _COMMON_SITETABLE_H_
+#define _COMMON_SITETABLE_H_
+
+#include "common/defs.h"
+#include <cstdint>
+
+// Layout must match the table emitted by the compiler pass
+typedef struct SourceSite {
+  const char * file;
+  const char * function;
+  uint32_t line;
+  uint32_t column;
+} SourceSite;
+
+class SiteTable {
+  public:
+    // The process-wide table. Built on first use since modules
+    // register their sites from constructors.
+    static SiteTable & instance() {
+      static SiteTable table;
+      return table;
+    }
+
+    // Registers the sites of one module and returns its base id
+    uint32_t registerModule(const SourceSite * sites, uint32_t count) {
+      std::lock_guard<std::mutex> guard(lock);
+      uint32_t base = nextBase;
+      modules.push_back(Module{base, count, sites});
+      nextBase += count;
+      return base;
+    }
+
+    // Returns the site with the given id or NULL if unknown
+    const SourceSite * find(uint32_t siteID) {
+      std::lock_guard<std::mutex> guard(lock);
+      for (const Module & module : modules) {
+        if (siteID >= module.base && siteID < module.base + module.count) {
+          return &module.sites[siteID - module.base];
+        }
+      }
+      return NULL;
+    }
+
+    // Calls visit(base, sites, count) for every module, in the
+    // order of registration
+    template <typename Visitor>
+    VOID forEachModule(Visitor visit) {
+      std::lock_guard<std::mutex> guard(lock);
+      for (const Module & module : modules) {
+        visit(module.base, module.sites, module.count);
+      }
+    }
+
+  private:
+    typedef struct Module {
+      uint32_t base;
+      uint32_t count;
+      const SourceSite * sites;
+    } Module;
+
+    SiteTable(): nextBase(1) {}
+
+    std::mutex lock;
+    uint32_t nextBase;
+    std::vector<Module> modules;
+};
+
+#endif // end SiteTable.h
@@ -28,6 +28,8 @@ class Action {
   VALUE source_line_num;
   INTEGER source_func_id;
   std::string source_func_name;
+  INTEGER source_site_id = 0; // site from the compiler pass, 0 if none
+  uint32_t stack_id = 0;      // call stack of the task, 0 if none
   bool is_write_action;
 
   Action(INTEGER tskId, VALUE val, VALUE ln, INTEGER fuId):
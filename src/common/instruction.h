@@ -30,7 +30,7 @@ class Instruction {
   // raw representation of instruction
   std::string raw;
 
-  const std::unordered_map<std::string, OPERATION> operation_map{
+  std::unordered_map<std::string, OPERATION> operation_map{
     {"add", ADD}, {"sub", SUB}, {"mul", MUL}, {"shl", SHL}, };
 
   // Default constructor
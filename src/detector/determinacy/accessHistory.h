@@ -0,0 +1,133 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// Defines the per-address access history of the checker. Each
+// address keeps a ring of compact HistoryCells allocated in the
+// same block as its header, so a scan touches one contiguous
+// piece of memory and recording an access allocates nothing.
+// Full actions are rebuilt from cells only to report a race.
+
+#ifndef _DETECTOR_DETERMINACY_ACCESSHISTORY_H_
+#define _DETECTOR_DETERMINACY_ACCESSHISTORY_H_
+
+#include "common/defs.h"
+#include "common/action.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#define HISTORY_DEFAULT_CAPACITY 5
+#define HISTORY_MAX_CAPACITY     64
+
+// One recorded access to an address
+typedef struct HistoryCell {
+  VALUE    value;        // value written, if isWrite
+  int32_t  taskID;
+  uint32_t siteID;       // source site, 0 for text log actions
+  union {
+    int32_t  lineNum;    // line of text log actions
+    uint32_t stackID;    // call stack of accesses with a site
+  };
+  uint32_t funcID  : 31; // function of text log actions
+  uint32_t isWrite : 1;
+
+  static HistoryCell fromAction(const Action & action) {
+    HistoryCell cell;
+    cell.value   = action.value_written;
+    cell.taskID  = action.accessing_task_id;
+    cell.siteID  = action.source_site_id;
+    if (cell.siteID) {
+      cell.stackID = action.stack_id;
+    } else {
+      cell.lineNum = action.source_line_num;
+    }
+    cell.funcID  = action.source_func_id;
+    cell.isWrite = action.is_write_action;
+    return cell;
+  }
+
+  Action toAction(ADDRESS addr) const {
+    Action action(taskID, addr, value,
+                  siteID ? 0 : (VALUE)lineNum, (INTEGER)funcID);
+    action.source_site_id = siteID;
+    if (siteID) action.stack_id = stackID;
+    action.is_write_action = isWrite;
+    return action;
+  }
+} HistoryCell;
+
+// Ring of recent accesses to one address. Histories of addresses
+// in the same shadow granule are chained in its shadow cell.
+typedef struct AddressHistory {
+  ADDRESS address;
+  struct AddressHistory * next;
+  uint16_t capacity;
+  uint16_t count;
+  uint16_t head;          // index of the oldest cell
+  HistoryCell cells[1];   // capacity cells follow the header
+
+  static AddressHistory * create(ADDRESS addr, unsigned capacity) {
+    AddressHistory * history = static_cast<AddressHistory *>(
+        malloc(sizeof(AddressHistory) + (capacity - 1) * sizeof(HistoryCell)));
+    history->address  = addr;
+    history->next     = NULL;
+    history->capacity = capacity;
+    history->count    = 0;
+    history->head     = 0;
+    return history;
+  }
+
+  static VOID destroy(AddressHistory * history) {
+    free(history);
+  }
+
+  inline bool isFull() const { return count == capacity; }
+
+  // Returns the i-th cell, counting from the oldest
+  inline const HistoryCell & at(unsigned i) const {
+    return cells[(head + i) % capacity];
+  }
+
+  // Appends a cell. The ring must not be full.
+  inline VOID push(const HistoryCell & cell) {
+    cells[(head + count) % capacity] = cell;
+    count++;
+  }
+
+  // Removes the i-th cell, keeping the order of the others
+  inline VOID evict(unsigned i) {
+    for (; i + 1 < count; i++) {
+      cells[(head + i) % capacity] = cells[(head + i + 1) % capacity];
+    }
+    count--;
+    if (count == 0) head = 0;
+  }
+
+  inline VOID evictOldest() {
+    head = (head + 1) % capacity;
+    count--;
+  }
+
+  // Moves the cells to a larger block and frees this one.
+  // The caller relinks the returned history in its chain.
+  AddressHistory * grow(unsigned newCapacity) {
+    AddressHistory * grown = create(address, newCapacity);
+    grown->next = next;
+    for (unsigned i = 0; i < count; i++) {
+      grown->push(at(i));
+    }
+    destroy(this);
+    return grown;
+  }
+} AddressHistory;
+
+#endif // end accessHistory.h
@@ -0,0 +1,256 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// this file implements the asynchronous checker.
+#include "detector/determinacy/asyncChecker.h"
+#include <algorithm>
+#include <cstdlib>
+
+// items a worker processes from one queue before moving on
+#define ASYNC_DRAIN_LIMIT 64
+
+static std::atomic<uint64_t> nextCheckerID(1);
+
+// channel of the calling thread and the checker it belongs to
+static thread_local uint64_t localOwner = 0;
+static thread_local AsyncChannel * localChannel = NULL;
+
+AsyncChecker::AsyncChecker(Checker & checker, unsigned workerThreads):
+  checker(checker), id(nextCheckerID++), channelCount(0),
+  postedEvents(0), appliedEvents(0), stopping(false),
+  workerCount(std::min(std::max(workerThreads, 1u),
+                       (unsigned)ASYNC_MAX_WORKERS)) {
+  for (unsigned index = 0; index < workerCount; index++) {
+    workers.push_back(std::thread(&AsyncChecker::detect, this, index));
+  }
+}
+
+AsyncChecker::~AsyncChecker() {
+  stop();
+  size_t count = channelCount.load();
+  for (size_t i = 0; i < count; i++) {
+    for (unsigned w = 0; w < workerCount; w++) {
+      WorkerQueue & queue = channels[i]->queues[w];
+      AccessBatch ** batch;
+      while ((batch = queue.freeBatches.front())) {
+        delete *batch;
+        queue.freeBatches.pop();
+      }
+      delete queue.pending;
+    }
+    delete [] channels[i]->queues;
+    delete channels[i];
+  }
+}
+
+unsigned AsyncChecker::getThreadCountFromEnv() {
+  const char * value = getenv("TASKSAN_DETECTOR_THREADS");
+  if (!value) return 0;
+
+  long threads = atol(value);
+  return (threads < 1) ? 0 : (unsigned)threads;
+}
+
+AsyncChannel & AsyncChecker::getChannel() {
+  if (localOwner == id) return *localChannel;
+
+  std::lock_guard<std::mutex> guard(channelsLock);
+  size_t count = channelCount.load(std::memory_order_relaxed);
+  if (count == ASYNC_MAX_CHANNELS) {
+    std::cerr << "TaskSanitizer: too many threads for "
+              << ASYNC_MAX_CHANNELS << " detector channels" << std::endl;
+    exit(1);
+  }
+  localChannel = new AsyncChannel();
+  localChannel->queues = new WorkerQueue[workerCount];
+  localChannel->eventWorker = count % workerCount;
+  localChannel->postedBatches = 0;
+  localChannel->checkedBatches = 0;
+  localOwner = id;
+  channels[count] = localChannel;
+  channelCount.store(count + 1, std::memory_order_release);
+  return *localChannel;
+}
+
+// Waits for room in the queue; the worker frees it
+VOID AsyncChecker::post(WorkerQueue & queue, const AsyncItem & item) {
+  while (!queue.items.push(item)) {
+    std::this_thread::yield();
+  }
+}
+
+VOID AsyncChecker::postEvent(uint8_t kind, int first, int second,
+                             std::vector<int> * childIDs) {
+  AsyncChannel & channel = getChannel();
+  AsyncItem item;
+  item.seq = postedEvents.fetch_add(1);
+  item.batches = channel.postedBatches;
+  item.kind = kind;
+  item.first = first;
+  item.second = second;
+  item.batch = NULL;
+  item.childIDs = childIDs;
+  post(channel.queues[channel.eventWorker], item);
+}
+
+VOID AsyncChecker::postBatch(AsyncChannel & channel, WorkerQueue & queue) {
+  AsyncItem item;
+  item.seq = postedEvents.load(std::memory_order_acquire);
+  item.batches = 0;
+  item.kind = ASYNC_ACCESSES;
+  item.first = item.second = 0;
+  item.batch = queue.pending;
+  item.childIDs = NULL;
+  channel.postedBatches++;
+  post(queue, item);
+  queue.pending = NULL;
+}
+
+VOID AsyncChecker::saveMemoryAccesses(const AccessRecord * accesses,
+                                      size_t count) {
+  AsyncChannel & channel = getChannel();
+  for (size_t i = 0; i < count; i++) {
+    unsigned worker = (workerCount == 1) ? 0 :
+        Checker::getShardIndex(accesses[i].destination_address) % workerCount;
+    WorkerQueue & queue = channel.queues[worker];
+
+    if (!queue.pending) {
+      AccessBatch ** recycled = queue.freeBatches.front();
+      if (recycled) {
+        queue.pending = *recycled;
+        queue.freeBatches.pop();
+      } else {
+        queue.pending = new AccessBatch();
+      }
+      queue.pending->count = 0;
+    }
+    queue.pending->records[queue.pending->count++] = accesses[i];
+    if (queue.pending->count == ASYNC_BATCH_CAPACITY) {
+      postBatch(channel, queue);
+    }
+  }
+
+  // events may follow, so nothing stays pending
+  for (unsigned worker = 0; worker < workerCount; worker++) {
+    if (channel.queues[worker].pending) {
+      postBatch(channel, channel.queues[worker]);
+    }
+  }
+}
+
+VOID AsyncChecker::onTaskCreate(int taskID) {
+  postEvent(ASYNC_TASK_CREATE, taskID, 0);
+}
+
+VOID AsyncChecker::saveHappensBeforeEdge(int parentID, int childID) {
+  postEvent(ASYNC_EDGE, parentID, childID);
+}
+
+VOID AsyncChecker::onTaskSpawn(int parentID, int childID) {
+  postEvent(ASYNC_SPAWN, parentID, childID);
+}
+
+VOID AsyncChecker::onTaskContinue(int prevID, int nextID) {
+  postEvent(ASYNC_CONTINUE, prevID, nextID);
+}
+
+VOID AsyncChecker::onTaskSync(int prevID, int nextID,
+                              const std::vector<int> & childIDs) {
+  postEvent(ASYNC_SYNC, prevID, nextID, new std::vector<int>(childIDs));
+}
+
+VOID AsyncChecker::onTaskEnd(int taskID) {
+  postEvent(ASYNC_END, taskID, 0);
+}
+
+VOID AsyncChecker::keepTask(int taskID) {
+  postEvent(ASYNC_KEEP, taskID, 0);
+}
+
+VOID AsyncChecker::stop() {
+  stopping.store(true);
+  for (std::thread & worker : workers) {
+    worker.join();
+  }
+  workers.clear();
+}
+
+VOID AsyncChecker::detect(unsigned index) {
+  while (true) {
+    // nothing is posted anymore once stopping is seen
+    bool done = stopping.load();
+    bool progress = false, idle = true;
+
+    size_t count = channelCount.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; i++) {
+      bool empty;
+      progress |= drainQueue(*channels[i], channels[i]->queues[index], empty);
+      idle &= empty;
+    }
+    if (done && idle) return;
+    if (!progress) std::this_thread::yield();
+  }
+}
+
+bool AsyncChecker::drainQueue(AsyncChannel & channel, WorkerQueue & queue,
+                              bool & empty) {
+  int processed = 0;
+  AsyncItem * item;
+  while ((item = queue.items.front())) {
+    uint64_t applied = appliedEvents.load(std::memory_order_acquire);
+    if (item->kind == ASYNC_ACCESSES) {
+      if (applied < item->seq) break;  // edges not applied yet
+
+      checker.saveMemoryAccesses(item->batch->records, item->batch->count);
+      if (!queue.freeBatches.push(item->batch)) delete item->batch;
+      channel.checkedBatches.fetch_add(1, std::memory_order_release);
+    } else {
+      if (applied != item->seq) break;  // earlier events first
+      if (channel.checkedBatches.load(std::memory_order_acquire) <
+          item->batches) break;         // accesses before the event
+
+      applyEvent(*item);
+      appliedEvents.store(applied + 1, std::memory_order_release);
+    }
+    queue.items.pop();
+    if (++processed == ASYNC_DRAIN_LIMIT) break;
+  }
+  empty = !queue.items.front();
+  return processed > 0;
+}
+
+VOID AsyncChecker::applyEvent(const AsyncItem & item) {
+  switch (item.kind) {
+    case ASYNC_TASK_CREATE:
+      checker.onTaskCreate(item.first);
+      break;
+    case ASYNC_EDGE:
+      checker.saveHappensBeforeEdge(item.first, item.second);
+      break;
+    case ASYNC_SPAWN:
+      checker.onTaskSpawn(item.first, item.second);
+      break;
+    case ASYNC_CONTINUE:
+      checker.onTaskContinue(item.first, item.second);
+      break;
+    case ASYNC_SYNC:
+      checker.onTaskSync(item.first, item.second, *item.childIDs);
+      delete item.childIDs;
+      break;
+    case ASYNC_END:
+      checker.onTaskEnd(item.first);
+      break;
+    case ASYNC_KEEP:
+      checker.keepTask(item.first);
+      break;
+  }
+}
@@ -0,0 +1,161 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// Defines the AsyncChecker class. It moves the work of a Checker
+// off the application threads to a pool of detector workers.
+// Every worker owns the checker shards whose index modulo the
+// number of workers is its own, hence a disjoint slice of the
+// address space with its own histories and conflict tables.
+// Range accesses go to the owner of their first address but lock
+// the range history and the shards of every address they cover,
+// so they contend with the other workers.
+//
+// Every application thread gets a channel with a pair of
+// single-producer/single-consumer queues per worker, and only
+// copies its accesses, split by owning worker, and its task events
+// into them. Task events are applied to the shared HB engine by
+// one worker per channel; all workers read the engine.
+//
+// Task events get increasing numbers and are applied in that
+// order. An access batch carries the number of events posted
+// before it was queued and is checked only once those events are
+// applied, so it sees every happens-before edge its accesses
+// depend on. An event waits until all batches its thread queued
+// before it are checked, so a segment is not ended while some
+// worker still has its accesses.
+//
+// Enabled by setting TASKSAN_DETECTOR_THREADS to the number of
+// workers.
+
+#ifndef _DETECTOR_DETERMINACY_ASYNCCHECKER_H_
+#define _DETECTOR_DETERMINACY_ASYNCCHECKER_H_
+
+#include "common/defs.h"
+#include "common/AccessRecord.h"
+#include "common/AlignedNew.h"
+#include "detector/determinacy/checker.h"
+#include "detector/determinacy/eventSink.h"
+#include "detector/determinacy/spscQueue.h"
+#include <atomic>
+#include <thread>
+
+#define ASYNC_QUEUE_CAPACITY  256   // items per channel
+#define ASYNC_BATCH_CAPACITY  1024  // records per access batch
+#define ASYNC_MAX_CHANNELS    1024  // application threads
+#define ASYNC_MAX_WORKERS     CHECKER_SHARDS
+
+enum AsyncItemKind {
+  ASYNC_ACCESSES,
+  ASYNC_TASK_CREATE,
+  ASYNC_EDGE,
+  ASYNC_SPAWN,
+  ASYNC_CONTINUE,
+  ASYNC_SYNC,
+  ASYNC_END,
+  ASYNC_KEEP
+};
+
+typedef struct AccessBatch {
+  size_t count;
+  AccessRecord records[ASYNC_BATCH_CAPACITY];
+} AccessBatch;
+
+typedef struct AsyncItem {
+  uint64_t seq;       // number of the event, or events before the batch
+  uint64_t batches;   // batches of the thread queued before the event
+  uint8_t kind;
+  int first;          // task IDs of the event
+  int second;
+  AccessBatch * batch;            // ASYNC_ACCESSES
+  std::vector<int> * childIDs;    // ASYNC_SYNC
+} AsyncItem;
+
+// queues between one application thread and one worker
+typedef struct alignas(CACHE_LINE_SIZE) WorkerQueue
+    : AlignedNew<CACHE_LINE_SIZE> {
+  SPSCQueue<AsyncItem, ASYNC_QUEUE_CAPACITY> items;  // to the worker
+  SPSCQueue<AccessBatch *, ASYNC_QUEUE_CAPACITY> freeBatches; // back
+  AccessBatch * pending;  // being filled by the application thread
+
+  WorkerQueue(): pending(NULL) {}
+} WorkerQueue;
+
+typedef struct AsyncChannel : AlignedNew<CACHE_LINE_SIZE> {
+  WorkerQueue * queues;        // one per worker
+  unsigned eventWorker;        // the worker that applies the events
+  uint64_t postedBatches;      // written by the application thread
+  alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> checkedBatches;
+} AsyncChannel;
+
+// allocated with AlignedNew, as its counters are cache aligned
+class AsyncChecker : public EventSink,
+                     public AlignedNew<CACHE_LINE_SIZE> {
+  public:
+    AsyncChecker(Checker & checker, unsigned workerThreads);
+    ~AsyncChecker();
+
+    // Returns TASKSAN_DETECTOR_THREADS, 0 when not set
+    static unsigned getThreadCountFromEnv();
+
+    // Queues events and accesses of the calling thread, with the
+    // same meaning as the methods of Checker
+    VOID saveMemoryAccesses(const AccessRecord * accesses, size_t count);
+    VOID onTaskCreate(int taskID);
+    VOID saveHappensBeforeEdge(int parentID, int childID);
+    VOID onTaskSpawn(int parentID, int childID);
+    VOID onTaskContinue(int prevID, int nextID);
+    VOID onTaskSync(int prevID, int nextID,
+                    const std::vector<int> & childIDs);
+    VOID onTaskEnd(int taskID);
+    VOID keepTask(int taskID);
+
+    // Waits until every queued item is checked and joins the
+    // workers. Application threads must not post anymore.
+    VOID stop();
+
+  private:
+    // Returns the channel of the calling thread
+    AsyncChannel & getChannel();
+
+    VOID postEvent(uint8_t kind, int first, int second,
+                   std::vector<int> * childIDs = NULL);
+    VOID post(WorkerQueue & queue, const AsyncItem & item);
+
+    // Queues the pending batch of a worker queue
+    VOID postBatch(AsyncChannel & channel, WorkerQueue & queue);
+
+    // Body of the worker thread index
+    VOID detect(unsigned index);
+
+    // Processes items at the head of a queue until it is empty or
+    // waits for other queues. Returns false if nothing could be
+    // processed.
+    bool drainQueue(AsyncChannel & channel, WorkerQueue & queue,
+                    bool & empty);
+    VOID applyEvent(const AsyncItem & item);
+
+    Checker & checker;
+    uint64_t id;  // tells channels of different instances apart
+
+    AsyncChannel * channels[ASYNC_MAX_CHANNELS];
+    std::atomic<size_t> channelCount;
+    std::mutex channelsLock;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> postedEvents;
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> appliedEvents;
+    std::atomic<bool> stopping;
+
+    unsigned workerCount;
+    std::vector<std::thread> workers;
+};
+
+#endif // end asyncChecker.h
@@ -13,10 +13,21 @@
 // this file implements the checking tool functionalities.
 #include "detector/determinacy/checker.h"  // header
 #include "common/MemoryActions.h"
+#include "functionengine/FunctionEngine.h"
 #include <cassert>
+#include <cstdlib>
 
 #define VERBOSE
-#define CONC_THREASHOLD 5
+
+// Reads a history capacity from the environment
+static unsigned getCapacityFromEnv(const char * name, unsigned fallback) {
+  const char * value = getenv(name);
+  if (!value) return fallback;
+
+  long capacity = atol(value);
+  if (capacity < 1) return fallback;
+  return (capacity > UINT16_MAX) ? UINT16_MAX : (unsigned)capacity;
+}
 
 // Saves the function name/signature for reporting determinacy races
 void Checker::registerFuncSignature(std::string funcName, int funcID) {
@@ -24,118 +35,125 @@ void Checker::registerFuncSignature(std::string funcName, int funcID) {
   functions[funcID] = funcName;
 }
 
+Checker::Checker(): rangeCount(0), rangeLow(UINTPTR_MAX), rangeHigh(0) {
+  pthread_rwlock_init(&hbLock, NULL);
+  pthread_rwlock_init(&rangeLock, NULL);
+  hbEngine = createHBEngine();
+  historyCapacity = getCapacityFromEnv("TASKSAN_HISTORY_CAPACITY",
+                                       HISTORY_DEFAULT_CAPACITY);
+  maxHistoryCapacity = getCapacityFromEnv("TASKSAN_HISTORY_MAX_CAPACITY",
+      std::max(historyCapacity, (unsigned)HISTORY_MAX_CAPACITY));
+  maxHistoryCapacity = std::max(maxHistoryCapacity, historyCapacity);
+}
+
 // Executed when a new task is created
 void Checker::onTaskCreate(int taskID) {
-
-  // we already know its parents
-  // use this information to inherit or greate new serial bag
-  auto parentTasks = graph[taskID].inEdges.begin();
-  if (parentTasks == graph[taskID].inEdges.end()) { // if no HB tasks in graph
-
-    // check if has no serial bag
-    if (serial_bags.find(taskID) == serial_bags.end()) {
-      auto newTaskbag = new SerialBag();
-      if (graph.find(taskID) != graph.end()) {
-        // specify number of tasks dependent of this task
-        newTaskbag->outBufferCount = graph[taskID].outEdges.size();
-      } else {//put it in the simple HB graph
-          graph[taskID] = Task();
-      }
-      graph[taskID].taskID = taskID; // save the ID of the task
-      serial_bags[taskID] = newTaskbag;
-    }
-  } else { // has parent tasks
-    // look for the parents serial bags and inherit them
-    // or construct your own by cloning the parent's
-
-    // 1.find the parent bag which can be inherited
-    SerialBagPtr taskBag = NULL;
-    auto inEdge = graph[taskID].inEdges.begin();
-/* Hassan 02.01.2021 modify this code to accommodate chunked tasks.
-    for (; inEdge != graph[taskID].inEdges.end(); inEdge++) {
-
-      // take with outstr 1 and longest
-      auto curBag = serial_bags[*inEdge];
-      if (curBag->outBufferCount == 1) {
-        serial_bags.erase(*inEdge);
-        graph[taskID].inEdges.erase(*inEdge);
-        taskBag = curBag;
-        curBag->HB.insert(*inEdge);
-        break;  // could optimize by looking all bags
-      }
-    }
-*/
-
-    if (!taskBag) {
-      taskBag = new SerialBag(); // no bag inherited
-    }
-    // the number of inheriting bags
-    taskBag->outBufferCount = graph[taskID].outEdges.size();
-
-    // 2. merge the HBs of the parent nodes
-    inEdge = graph[taskID].inEdges.begin();
-    for (; inEdge != graph[taskID].inEdges.end(); inEdge++) {
-      auto aBag = serial_bags[*inEdge];
-      taskBag->HB.insert(aBag->HB.begin(), aBag->HB.end()); // merging...
-      taskBag->HB.insert(*inEdge); // parents happen-before me
-/* Hassan 02.01.2021 modify this code to accommodate chunked tasks.
-      aBag->outBufferCount--; // for inheriting bags
-      if (!aBag->outBufferCount)
-        serial_bags.erase(*inEdge);
-*/
-    }
-
-    graph[taskID].taskID = taskID; // set the ID of the task
-    serial_bags[taskID] = taskBag; // 3. add the bag to serial_bags
-  }
+  pthread_rwlock_wrlock(&hbLock);
+  hbEngine->onTaskCreate(taskID);
+  pthread_rwlock_unlock(&hbLock);
 }
 
 // Saves a happens edge between predecessor and successor task in
 // dependence edge
 void Checker::saveHappensBeforeEdge(int parentId, int siblingId) {
-  if ( graph.find(parentId) == graph.end() ) {
-    graph[parentId] = Task();
-  }
-  if ( graph.find(siblingId) == graph.end() ) {
-    graph[siblingId] = Task();
-    graph[siblingId].taskID = siblingId;
-  }
+  pthread_rwlock_wrlock(&hbLock);
+  hbEngine->saveHappensBeforeEdge(parentId, siblingId);
+  pthread_rwlock_unlock(&hbLock);
+}
+
+// Executed when segment parentId creates a task
+void Checker::onTaskSpawn(int parentId, int childId) {
+  pthread_rwlock_wrlock(&hbLock);
+  hbEngine->onTaskSpawn(parentId, childId);
+  pthread_rwlock_unlock(&hbLock);
+}
+
+// Executed when a task goes on in a new segment after a spawn
+void Checker::onTaskContinue(int prevId, int nextId) {
+  pthread_rwlock_wrlock(&hbLock);
+  hbEngine->onTaskContinue(prevId, nextId);
+  pthread_rwlock_unlock(&hbLock);
+}
 
-  graph[parentId].outEdges.insert(siblingId);
-  graph[siblingId].inEdges.insert(parentId);
-  Checker::onTaskCreate(siblingId);
+// Executed when a task goes on in a new segment after a taskwait
+void Checker::onTaskSync(int prevId, int nextId,
+                         const std::vector<int> & childIds) {
+  pthread_rwlock_wrlock(&hbLock);
+  hbEngine->onTaskSync(prevId, nextId, childIds);
+  pthread_rwlock_unlock(&hbLock);
 }
 
-// Detects determinacy race on a memory read or write
-void Checker::detectRaceOnMem(
-    int taskID,
-    std::string operation,
-    std::stringstream & ssin) {
+// Executed when the last segment of a task has finished
+void Checker::onTaskEnd(int taskId) {
+  pthread_rwlock_wrlock(&hbLock);
+  hbEngine->onTaskEnd(taskId);
+  pthread_rwlock_unlock(&hbLock);
+}
 
-  Action action;
-  action.accessing_task_id = taskID;
-  constructMemoryAction(ssin, operation, action);
+// Executed when a task sends a dependence token
+void Checker::keepTask(int taskId) {
+  pthread_rwlock_wrlock(&hbLock);
+  hbEngine->keepTask(taskId);
+  pthread_rwlock_unlock(&hbLock);
+}
 
-  if (action.source_func_id == 0) {
-    std::cout << "Warning function Id 0: " << std::endl;
-    exit(0);
+// Checks a memory access record which comes directly from
+// the instrumentation runtime.
+VOID Checker::saveMemoryAccess(const AccessRecord & access) {
+  if (access.range_size) {
+    saveMemoryAccesses(&access, 1);
+    return;
   }
-  MemoryActions memActions( action ); // save first action
-
-  if ( !ssin.eof() ) { // there are still tokens
-    std::string separator;
-    ssin >> separator;
-    ssin >> taskID;
-    Action lastWAction;
-    lastWAction.accessing_task_id = taskID;
-    ssin >> operation;
-    constructMemoryAction(ssin, operation, lastWAction);
-    memActions.storeAction( lastWAction ); // save second action
+  Action action(access.accessing_task_id,
+                access.destination_address,
+                access.value_written, 0, 0);
+  action.source_site_id = access.source_site_id;
+  action.stack_id = access.stack_id;
+  action.is_write_action = access.is_write_action;
+
+  MemoryActions memActions( action );
+  saveTaskActions( memActions );
+}
+
+// Checks accesses in the order they were recorded by a thread.
+// The happens-before structures are locked once for the batch.
+VOID Checker::saveMemoryAccesses(const AccessRecord * accesses,
+                                 size_t count) {
+  pthread_rwlock_rdlock(&hbLock);
+  INTEGER lastTaskID = -1;
+  const VOID * taskView = NULL;
+
+  for (size_t i = 0; i < count; i++) {
+    const AccessRecord & access = accesses[i];
+    if (access.accessing_task_id != lastTaskID) {
+      taskView = hbEngine->getTaskView(access.accessing_task_id);
+      lastTaskID = access.accessing_task_id;
+    }
+
+    Action action(access.accessing_task_id,
+                  access.destination_address,
+                  access.value_written, 0, 0);
+    action.source_site_id = access.source_site_id;
+    action.stack_id = access.stack_id;
+    action.is_write_action = access.is_write_action;
+    if (access.range_size) {
+      checkRange(action, access, taskView);
+    } else {
+      checkTaskActions( MemoryActions( action ), taskView );
+    }
   }
-  saveTaskActions( memActions ); // save the actions
+  pthread_rwlock_unlock(&hbLock);
 }
 
 void Checker::saveTaskActions( const MemoryActions & taskActions ) {
+  pthread_rwlock_rdlock(&hbLock);
+  checkTaskActions(taskActions,
+                   hbEngine->getTaskView(taskActions.accessing_task_id));
+  pthread_rwlock_unlock(&hbLock);
+}
+
+void Checker::checkTaskActions( const MemoryActions & taskActions,
+                                const VOID * taskView ) {
 
   // CASES
   // 1. first action -> just save
@@ -147,111 +165,271 @@ void Checker::saveTaskActions( const MemoryActions & taskActions ) {
   //        write in the parallel writes,update and take it forward
   //        4.2.1 check conflicts with other parallel tasks
 
-  auto perAddrActions = writes.find(taskActions.destination_address);
-  if (perAddrActions == writes.end()) {// 1. first action
-     writes[taskActions.destination_address] = std::list<MemoryActions>();
+  HistoryShard & shard = getShard(taskActions.destination_address);
+  std::lock_guard<std::mutex> shardGuard(shard.lock);
+
+  // find history of the exact address in the granule's cell
+  ADDRESS addr = taskActions.destination_address;
+  AddressHistory ** link = &shadow.getCell(addr);
+  while (*link && (*link)->address != addr) {
+    link = &(*link)->next;
   }
-  std::list<MemoryActions> & AddrActions = writes[taskActions.destination_address];
-  for (auto lastWrt = AddrActions.begin();
-       lastWrt != AddrActions.end(); lastWrt++) {
-    // actions of same task
-    if (taskActions.accessing_task_id == lastWrt->accessing_task_id) continue;
+  if (!*link) { // 1. first action gets an empty ring
+    *link = AddressHistory::create(addr, historyCapacity);
+  }
+  AddressHistory * history = *link;
+
+  // oldest cell ordered before this action, evicted first
+  int victim = -1;
+  const Action & curAction = taskActions.action;
+
+  for (unsigned i = 0; i < history->count; i++) {
+    const HistoryCell & lastWrt = history->at(i);
 
-    auto HBfound = serial_bags[taskActions.accessing_task_id]->HB.find(lastWrt->accessing_task_id);
-    auto end     = serial_bags[taskActions.accessing_task_id]->HB.end();
-    if (HBfound != end) continue; // 3. there's happens-before
+    // 2. actions of same task, or
+    // 3. there's happens-before
+    if (taskActions.accessing_task_id == lastWrt.taskID ||
+        hbEngine->happensBefore(taskView, lastWrt.taskID)) {
+      if (victim < 0) victim = i;
+      continue;
+    }
 
     // 4. parallel, possible race! ((check race))
 
     // check write-write case (different values written)
     // 4.1 both write to shared memory
-    if ( (taskActions.action.is_write_action && lastWrt->action.is_write_action) &&
-         (taskActions.action.value_written != lastWrt->action.value_written) ) {
+    if ( (curAction.is_write_action && lastWrt.isWrite) &&
+         (curAction.value_written != lastWrt.value) ) {
       // write different values, code for recording errors
-      saveDeterminacyRaceReport( taskActions.action, lastWrt->action );
-    } else if ((!taskActions.action.is_write_action) && lastWrt->action.is_write_action) {
+      saveDeterminacyRaceReport(shard, curAction, lastWrt.toAction(addr));
+    } else if ((!curAction.is_write_action) && lastWrt.isWrite) {
     // 4.2 read-after-write or write-after-read conflicts
     // (a) taskActions is read-only and lastWrt is a writer:
       // code for recording errors
-      saveDeterminacyRaceReport(taskActions.action, lastWrt->action);
-    } else if ((!lastWrt->action.is_write_action) && taskActions.action.is_write_action ) {
+      saveDeterminacyRaceReport(shard, curAction, lastWrt.toAction(addr));
+    } else if ((!lastWrt.isWrite) && curAction.is_write_action ) {
     // (b) lastWrt is read-only and taskActions is a writer:
       // code for recording errors
-      saveDeterminacyRaceReport(taskActions.action, lastWrt->action);
+      saveDeterminacyRaceReport(shard, curAction, lastWrt.toAction(addr));
     }
   } // end for
 
-  if (AddrActions.size() >= CONC_THREASHOLD) {
-    AddrActions.pop_front(); // remove oldest element
+  if ( history->isFull() ) {
+    if (victim >= 0) {
+      history->evict(victim);
+    } else if (history->capacity < maxHistoryCapacity) {
+      // all cells are parallel to this action: a contended
+      // address, keep them all
+      history = history->grow(
+          std::min(2u * history->capacity, maxHistoryCapacity));
+      *link = history;
+    } else {
+      history->evictOldest();
+    }
+  }
+
+  history->push( HistoryCell::fromAction(curAction) ); // save
+
+  // ranges recorded so far which cover the address
+  if (rangeCount.load()) {
+    checkCoveringRanges(shard, curAction, taskView);
+  }
+}
+
+// Returns true if a parallel access conflicts with a range
+// access. Ranges carry no value, so writes always conflict, even
+// those of memsets that store the same value.
+static inline bool conflictsWithRange(bool isWrite, bool rangeIsWrite) {
+  return isWrite || rangeIsWrite;
+}
+
+VOID Checker::checkRange(const Action & curAction,
+                         const AccessRecord & access, const VOID * taskView) {
+  RangeCell current;
+  current.start = reinterpret_cast<uintptr_t>(curAction.destination_address);
+  current.end = current.start + access.range_size;
+  current.stride = access.range_width ? access.range_stride : 0;
+  current.width = access.range_width;
+  current.cell = HistoryCell::fromAction(curAction);
+  const HistoryCell & cell = current.cell;
+
+  pthread_rwlock_wrlock(&rangeLock);
+  ranges.forEachOverlap(current.start, current.end,
+                        [&](const RangeCell & range) {
+    uintptr_t at;
+    if (!current.overlaps(range, at)) return false;
+    if (range.cell.taskID == cell.taskID ||
+        hbEngine->happensBefore(taskView, range.cell.taskID)) {
+      // an ordered range inside this one adds nothing anymore
+      return current.covers(range) && (cell.isWrite || !range.cell.isWrite);
+    }
+    if (conflictsWithRange(cell.isWrite, range.cell.isWrite)) {
+      ADDRESS overlap = reinterpret_cast<ADDRESS>(at);
+      std::lock_guard<std::mutex> guard(rangeShard.lock);
+      Action action(curAction);
+      action.destination_address = overlap;
+      saveDeterminacyRaceReport(rangeShard, action,
+                                range.cell.toAction(overlap));
+    }
+    return false;
+  });
+  ranges.insert(current);
+  if (current.start < rangeLow.load()) rangeLow.store(current.start);
+  if (current.end > rangeHigh.load()) rangeHigh.store(current.end);
+  rangeCount.store(ranges.size());
+  pthread_rwlock_unlock(&rangeLock);
+
+  checkRangeAddresses(curAction, current, taskView);
+}
+
+VOID Checker::checkRangeAddresses(const Action & curAction,
+                                  const RangeCell & range,
+                                  const VOID * taskView) {
+  size_t first = range.start >> SHADOW_GRANULE_BITS;
+  size_t last = (range.end - 1) >> SHADOW_GRANULE_BITS;
+  bool lockAll = (last - first) >= RANGE_SCAN_LOCK_ALL;
+  if (lockAll) {
+    for (HistoryShard & shard : shards) shard.lock.lock();
+  }
+
+  // a contiguous range is one element of its whole size
+  uintptr_t stride = range.stride ? range.stride : range.end - range.start;
+  uintptr_t width = range.stride ? range.width : stride;
+  size_t granule = first;  // next one to scan
+  for (uintptr_t element = range.start; element < range.end;
+       element += stride) {
+    size_t lastOfElement = (element + width - 1) >> SHADOW_GRANULE_BITS;
+    granule = std::max(granule, (size_t)(element >> SHADOW_GRANULE_BITS));
+    for (; granule <= lastOfElement; granule++) {
+      ADDRESS addr = reinterpret_cast<ADDRESS>(granule << SHADOW_GRANULE_BITS);
+      AddressHistory ** cell = shadow.findCell(addr);
+      if (!cell) {  // page never touched: skip it
+        granule =
+            (((granule >> SHADOW_PAGE_BITS) + 1) << SHADOW_PAGE_BITS) - 1;
+        continue;
+      }
+
+      HistoryShard & shard = getShard(addr);
+      if (!lockAll) shard.lock.lock();
+      for (AddressHistory * history = *cell; history;
+           history = history->next) {
+        uintptr_t address = reinterpret_cast<uintptr_t>(history->address);
+        uintptr_t at;
+        if (!range.overlaps(address, address + 1, at)) continue;
+
+        for (unsigned i = 0; i < history->count; i++) {
+          const HistoryCell & other = history->at(i);
+          if (curAction.accessing_task_id == other.taskID ||
+              hbEngine->happensBefore(taskView, other.taskID) ||
+              !conflictsWithRange(other.isWrite, curAction.is_write_action)) {
+            continue;
+          }
+          Action action(curAction);
+          action.destination_address = history->address;
+          saveDeterminacyRaceReport(shard, action,
+                                    other.toAction(history->address));
+        }
+      }
+      if (!lockAll) shard.lock.unlock();
+    }
   }
 
-  writes[taskActions.destination_address].push_back( taskActions ); // save
+  if (lockAll) {
+    for (HistoryShard & shard : shards) shard.lock.unlock();
+  }
+}
+
+VOID Checker::checkCoveringRanges(HistoryShard & shard,
+                                  const Action & curAction,
+                                  const VOID * taskView) {
+  uintptr_t addr = reinterpret_cast<uintptr_t>(curAction.destination_address);
+  if (addr < rangeLow.load() || addr >= rangeHigh.load()) return;
+
+  pthread_rwlock_rdlock(&rangeLock);
+  ranges.forEachOverlap(addr, addr + 1, [&](const RangeCell & range) {
+    uintptr_t at;
+    if (!range.overlaps(addr, addr + 1, at)) return false;
+    if (curAction.accessing_task_id != range.cell.taskID &&
+        !hbEngine->happensBefore(taskView, range.cell.taskID) &&
+        conflictsWithRange(curAction.is_write_action, range.cell.isWrite)) {
+      saveDeterminacyRaceReport(shard, curAction,
+          range.cell.toAction(curAction.destination_address));
+    }
+    return false;
+  });
+  pthread_rwlock_unlock(&rangeLock);
 }
 
 // Records the determinacy race warning to the conflicts table.
 // This is per pair of concurrent tasks.
-VOID Checker::saveDeterminacyRaceReport(const Action& curMemAction,
-                                       const Action& prevMemAction) {
+// Caller holds the lock of the shard.
+VOID Checker::saveDeterminacyRaceReport(HistoryShard & shard,
+                                        const Action& curMemAction,
+                                        const Action& prevMemAction) {
   Conflict aConflict(curMemAction, prevMemAction);
+  resolveSite(aConflict.action1);
+  resolveSite(aConflict.action2);
+
+  bool commutative;
+  commutativityLock.lock();
+  commutative = commutativeChecker.isCommutative(aConflict);
+  commutativityLock.unlock();
 
   // store only if conflict is not commutative
-  if ( !commutativeChecker.isCommutative(aConflict) ) {
+  if ( !commutative ) {
 
     // code for recording errors
     std::pair<int, int> linePair =
         {
-          std::min(curMemAction.source_line_num, prevMemAction.source_line_num),
-          std::max(curMemAction.source_line_num, prevMemAction.source_line_num)
+          std::min(aConflict.action1.source_line_num,
+                   aConflict.action2.source_line_num),
+          std::max(aConflict.action1.source_line_num,
+                   aConflict.action2.source_line_num)
         };
-    conflictTable[linePair].insert( aConflict );
+    shard.conflictTable[linePair].insert( aConflict );
   }
 }
 
+// Decodes the source site of an action, if it has one.
+VOID Checker::resolveSite(Action & action) {
+  if (!action.source_site_id) return;
 
-// Adds a new task node in the simple happens-before graph
-// @params: logLine, a log entry the contains the task ids
-void Checker::addTaskNode(std::string & logLine) {
-    std::stringstream ssin(logLine);
-    int sibId;
-    int parId;
-
-    ssin >> sibId;
-    ssin >> parId;
-    //std::cout << line << "(" << sibId << " " << parId << ")" << std::endl;
-    Checker::saveHappensBeforeEdge(parId, sibId);
+  const SourceSite * site =
+      SiteTable::instance().find(action.source_site_id);
+  if (site) {
+    action.source_line_num = site->line;
+    action.source_func_name = site->function;
+  }
 }
 
-// Constructs action object from the log file
-void Checker::constructMemoryAction(std::stringstream & ssin,
-                                    std::string & operation,
-                                    Action & action) {
-    std::string tempBuff;
-    ssin >> tempBuff; // address
-    action.destination_address = (ADDRESS)stoul(tempBuff, 0, 16);
-
-    ssin >> tempBuff; // value
-    action.value_written = stol(tempBuff);
-
-    ssin >> tempBuff; // line number
-    action.source_line_num = stol(tempBuff);
-
-    ssin >> action.source_func_id; // get function id
+const AddressHistory * Checker::findHistory(ADDRESS addr) {
+  HistoryShard & shard = getShard(addr);
+  std::lock_guard<std::mutex> shardGuard(shard.lock);
+  AddressHistory ** cell = shadow.findCell(addr);
+  AddressHistory * history = cell ? *cell : NULL;
+  while (history && history->address != addr) {
+    history = history->next;
+  }
+  return history;
+}
 
-    if (operation == "W") {
-      action.is_write_action = true;
-    } else {
-      action.is_write_action = false;
+// Collects the conflicts recorded by the shards into conflictTable
+VOID Checker::mergeConflicts() {
+  auto merge = [&](HistoryShard & shard) {
+    std::lock_guard<std::mutex> shardGuard(shard.lock);
+    for (auto & entry : shard.conflictTable) {
+      conflictTable[entry.first].insert(entry.second.begin(),
+                                        entry.second.end());
     }
-#ifdef DEBUG // check if data correctly set
-    std::cout << "Action constructed: ";
-    std::ostringstream buff;
-    action.printAction(buff);
-    std::cout << buff.str();
-    std::cout << std::endl;
-#endif
+    shard.conflictTable.clear();
+  };
+  for (auto & shard : shards) merge(shard);
+  merge(rangeShard);
 }
 
+
 void Checker::checkCommutativeOperations(CommutativityChecker & validator) {
+  mergeConflicts();
   // a pair of conflicting task body with a set of line numbers
   for (auto it = conflictTable.begin(); it != conflictTable.end(); ) {
     for ( auto aConflict = it->second.begin();
@@ -270,7 +448,40 @@ void Checker::checkCommutativeOperations(CommutativityChecker & validator) {
   }
 }
 
+// Returns the function name of an action for reporting
+std::string Checker::getFunctionName(const Action & action) {
+  if ( !action.source_func_name.empty() ) {
+    return action.source_func_name;
+  }
+  auto func = functions.find(action.source_func_id);
+  return (func == functions.end()) ? "unknown" : func->second;
+}
+
+// Prints the call stack of an action from the innermost
+// function, if the instrumentation recorded one
+VOID Checker::printCallStack(const Action & action) {
+  std::vector<uint32_t> frames;
+  if (!action.stack_id ||
+      !FunctionEngine::instance().getStack(action.stack_id, frames)) {
+    return;
+  }
+  std::cout << "        task " << action.accessing_task_id << " called from:";
+  const char * separator = " ";
+  for (uint32_t siteID : frames) {
+    const SourceSite * site = SiteTable::instance().find(siteID);
+    std::cout << separator;
+    if (site) {
+      std::cout << site->function << ":" << site->line;
+    } else {
+      std::cout << "unknown";
+    }
+    separator = " <- ";
+  }
+  std::cout << std::endl;
+}
+
 VOID Checker::reportConflicts() {
+  mergeConflicts();
   const std::string emptyLine(
        "                                                            ");
   const std::string borderLine(
@@ -279,7 +490,11 @@ VOID Checker::reportConflicts() {
   std::cout << emptyLine                               << std::endl;
   std::cout << "                    TaskSanitizer Summary  "      << std::endl;
   std::cout << emptyLine                               << std::endl;
-  std::cout << " Total number of tasks: " <<  graph.size() << std::endl;
+  std::cout << " Total number of tasks: " << hbEngine->taskCount() << std::endl;
+  std::cout << " Happens-before engine: " << hbEngine->getName() << std::endl;
+  if (!samplingSummary.empty()) {
+    std::cout << " Sampling: " << samplingSummary << std::endl;
+  }
   std::cout << emptyLine                               << std::endl;
   std::cout << emptyLine                               << std::endl;
   std::cout << emptyLine                               << std::endl;
@@ -309,15 +524,17 @@ VOID Checker::reportConflicts() {
 
     for (auto aConflict : it.second) {
       std::cout << "      " <<  aConflict.addr << " lines: " << " "
-                << functions.at( aConflict.action1.source_func_id )
+                << getFunctionName( aConflict.action1 )
                 << ": "     << aConflict.action1.source_line_num
-                << ", "     << functions.at( aConflict.action2.source_func_id )
+                << ", "     << getFunctionName( aConflict.action2 )
                 << ": "     << aConflict.action2.source_line_num
                 << " task ids: (" << aConflict.action1.accessing_task_id
                 << "["      << (aConflict.action1.is_write_action? "W]" : "R]")
                 << " "      << aConflict.action2.accessing_task_id
                 << "["      << (aConflict.action2.is_write_action? "W])" : "R])")
                 << std::endl;
+      printCallStack(aConflict.action1);
+      printCallStack(aConflict.action2);
       addressCount++;
 
       if (addressCount == 10) break;
@@ -329,28 +546,32 @@ VOID Checker::reportConflicts() {
 }
 
 VOID Checker::testing() {
-  for (auto it = writes.begin(); it != writes.end(); it++) {
-     std::cout << it->first << ": Bucket {" << it->second.size();
-     std::cout <<"} "<< std::endl;
-  }
-  std::cout << "Total Addresses: " << writes.size() << std::endl;
+  size_t totalAddresses = 0;
+  shadow.forEachCell([&totalAddresses](AddressHistory * history) {
+    for (; history; history = history->next) {
+       std::cout << history->address << ": Bucket {";
+       std::cout << history->count << "} " << std::endl;
+       totalAddresses++;
+    }
+  });
+  std::cout << "Total Addresses: " << totalAddresses << std::endl;
 
   // testing
   std::cout << "====================" << std::endl;
-  for (auto it = serial_bags.begin(); it != serial_bags.end(); it++) {
-      std::cout << it->first << " ("<< it->second->outBufferCount<< "): {";
-      for (auto x = it->second->HB.begin();
-           x != it->second->HB.end(); x++) {
-        std::cout << *x << " ";
-      }
-      std::cout << "}" << std::endl;
-  }
+  hbEngine->print(std::cout);
 }
 
-// Implementation of the checker destructor frees
-// the memory dynamically generated for S-bags
+// Implementation of the checker destructor frees the
+// happens-before engine and the access histories
 Checker::~Checker() {
-  for (auto it = serial_bags.begin(); it != serial_bags.end(); it++) {
-    delete it->second;
-  }
+  delete hbEngine;
+  shadow.forEachCell([](AddressHistory * history) {
+    while (history) {
+      AddressHistory * next = history->next;
+      AddressHistory::destroy(history);
+      history = next;
+    }
+  });
+  pthread_rwlock_destroy(&hbLock);
+  pthread_rwlock_destroy(&rangeLock);
 }
@@ -19,75 +19,165 @@
 // includes and definitions
 #include "common/defs.h"
 #include "common/MemoryActions.h"
+#include "common/AccessRecord.h"
+#include "common/SiteTable.h"
 #include "detector/determinacy/conflict.h"
 #include "detector/determinacy/report.h"
+#include "detector/determinacy/shadowMemory.h"
+#include "detector/determinacy/accessHistory.h"
+#include "detector/determinacy/rangeHistory.h"
+#include "detector/determinacy/hbEngine.h"
+#include "detector/determinacy/eventSink.h"
 #include "detector/commutativity/CommutativityChecker.h"
-#include <list>
-
-// a bag to hold the tasks that happened-before
-typedef struct SerialBag {
-  int outBufferCount;
-  UNORD_INTSET HB;  // unordered int set
-
-  SerialBag(): outBufferCount(0){}
-} SerialBag;
-
-// for constructing happans-before between tasks
-typedef struct Task {
-  int taskID;     // identity of the task
-  UNORD_INTSET inEdges;  // incoming data streams
-  UNORD_INTSET outEdges; // outgoing data streams
-} Task;
-
-typedef SerialBag * SerialBagPtr;
-
-class Checker {
+#include <atomic>
+#include <mutex>
+#include <pthread.h>
+
+// number of address shards of the access history
+#define CHECKER_SHARDS 64
+
+// granules a range scans before it takes all shard locks at once
+#define RANGE_SCAN_LOCK_ALL (8 * CHECKER_SHARDS)
+#define CACHE_LINE_SIZE 64
+
+// One lock shard of the access history. Granules are assigned
+// to shards by hash and each shard has its own lock, so accesses
+// to unrelated addresses do not contend.
+typedef struct alignas(CACHE_LINE_SIZE) HistoryShard {
+  std::mutex lock;
+  std::map<std::pair<int, int>, std::set<Conflict>> conflictTable;
+} HistoryShard;
+
+class Checker : public EventSink {
   public:
-  VOID addTaskNode(std::string & logLine);
   VOID saveTaskActions(const MemoryActions & taskActions);
 
+  // Checks a single memory access handed over by the runtime
+  VOID saveMemoryAccess(const AccessRecord & access);
+
+  // Checks a batch of memory accesses drained from a thread buffer
+  VOID saveMemoryAccesses(const AccessRecord * accesses, size_t count);
+
   // a pair of conflicting task body with a set of line numbers
   VOID checkCommutativeOperations(CommutativityChecker & validator);
 
   VOID registerFuncSignature(std::string funcName, int funcID);
   VOID onTaskCreate(int taskID);
   VOID saveHappensBeforeEdge(int parentId, int siblingId);
-  VOID detectRaceOnMem(int taskID,
-                                 std::string operation,
-                                 std::stringstream & ssin);
 
+  // fork-join events of task segments, see hbEngine.h
+  VOID onTaskSpawn(int parentId, int childId);
+  VOID onTaskContinue(int prevId, int nextId);
+  VOID onTaskSync(int prevId, int nextId, const std::vector<int> & childIds);
+  VOID onTaskEnd(int taskId);
+  VOID keepTask(int taskId);
+
+  // Returns conflicts of all shards merged into one table
   std::map<std::pair<int, int>, std::set<Conflict>> & getConflicts() {
+    mergeConflicts();
     return conflictTable;
   }
 
+  // Returns the access history of an address, NULL if it has
+  // none. It may change once other threads check accesses to it.
+  const AddressHistory * findHistory(ADDRESS addr);
+
+  // Returns the shard of an address. Threads that split point
+  // accesses by shard do not contend on the shard locks; a range
+  // locks the shards of all addresses it covers.
+  static inline size_t getShardIndex(ADDRESS addr) {
+    size_t key = reinterpret_cast<size_t>(addr) >> SHADOW_GRANULE_BITS;
+    return (key ^ (key >> 6)) % CHECKER_SHARDS;
+  }
+
   VOID initializeCommutativityChecker(char *fileName) {
     commutativeChecker.parseTasksIR(fileName);
   }
   VOID reportConflicts();
+
+  // Notes in the report that only sampled accesses were checked
+  VOID setSamplingSummary(const std::string & summary) {
+    samplingSummary = summary;
+  }
   VOID testing();
+  Checker();
   ~Checker();
 
   private:
-    // Constructs action object from the log file
-    VOID constructMemoryAction(std::stringstream & ssin,
-                               std::string & opType,
-                               Action & action);
-    VOID saveDeterminacyRaceReport(const Action& curWrite,
-                                  const Action& write);
-
-    // hold bags of tasks
-    std::unordered_map <INTEGER, SerialBagPtr> serial_bags;
-    std::unordered_map<INTEGER, Task> graph;  // in and out edges
-    // for write actions
-    std::unordered_map<ADDRESS, std::list<MemoryActions>> writes;
+    // Checks actions against the history of their shard.
+    // Caller holds hbLock for reading.
+    VOID checkTaskActions(const MemoryActions & taskActions,
+                          const VOID * taskView);
+
+    // Checks a range access, contiguous or strided, against the
+    // ranges and then against the addresses it covers. Caller
+    // holds hbLock for reading.
+    VOID checkRange(const Action & action, const AccessRecord & access,
+                    const VOID * taskView);
+
+    // Checks the histories of addresses a range covers against
+    // it. Caller holds hbLock for reading.
+    VOID checkRangeAddresses(const Action & action, const RangeCell & range,
+                             const VOID * taskView);
+
+    // Checks a recorded action against the ranges covering its
+    // address. Caller holds the lock of shard and hbLock.
+    VOID checkCoveringRanges(HistoryShard & shard, const Action & action,
+                             const VOID * taskView);
+    // Fills line and function of an action from its source site
+    VOID resolveSite(Action & action);
+    std::string getFunctionName(const Action & action);
+    VOID printCallStack(const Action & action);
+    VOID saveDeterminacyRaceReport(HistoryShard & shard,
+                                   const Action& curWrite,
+                                   const Action& write);
+
+    VOID mergeConflicts();
+
+    // all addresses of a shadow granule map to the same shard
+    inline HistoryShard & getShard(ADDRESS addr) {
+      return shards[getShardIndex(addr)];
+    }
+
+    // happens-before relation of tasks, selected at startup
+    HBEngine * hbEngine;
+
+    // protects hbEngine, which is read on every access
+    // and written only on task events
+    pthread_rwlock_t hbLock;
+
+    // per-address history of memory actions, found through the
+    // shadow memory and locked through the shard of the address
+    ShadowMemory<AddressHistory *> shadow;
+
+    // initial and largest number of cells of a history ring,
+    // from TASKSAN_HISTORY_CAPACITY and TASKSAN_HISTORY_MAX_CAPACITY
+    unsigned historyCapacity;
+    unsigned maxHistoryCapacity;
+    HistoryShard shards[CHECKER_SHARDS];
+
+    // range accesses, e.g. of memcpy and memset. Ranges are
+    // inserted before they scan the shards and actions are
+    // recorded before they look at the ranges, so a range and a
+    // parallel action always meet on one of both sides.
+    RangeHistory ranges;
+    pthread_rwlock_t rangeLock;
+    std::atomic<size_t> rangeCount;     // 0 lets actions skip ranges
+    std::atomic<uintptr_t> rangeLow;    // hull of all ranges
+    std::atomic<uintptr_t> rangeHigh;
+    HistoryShard rangeShard;            // conflicts among ranges
+
     std::map<std::pair<int, int>, std::set<Conflict>> conflictTable;
+    std::string samplingSummary;  // empty if all accesses are checked
     CONFLICT_PAIRS conflictTasksAndLines;
 
-    // For holding function signatures.
+    // For holding function signatures of the text log path.
+    // Accesses from the runtime carry site ids instead.
     std::unordered_map<INTEGER, std::string> functions;
 
-    // the commutativity checker
+    // the commutativity checker, it is not thread safe
    CommutativityChecker commutativeChecker;
+   std::mutex commutativityLock;
 };
 
 #endif // end checker.h
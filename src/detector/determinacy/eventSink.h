@@ -0,0 +1,43 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// Defines the EventSink interface: the task and access events the
+// runtime reports to the detector. The Checker analyzes them as
+// they come, the AsyncChecker queues them to detector workers and
+// the TraceWriter records them for tasksan-analyze.
+
+#ifndef _DETECTOR_DETERMINACY_EVENTSINK_H_
+#define _DETECTOR_DETERMINACY_EVENTSINK_H_
+
+#include "common/defs.h"
+#include "common/AccessRecord.h"
+#include <vector>
+
+class EventSink {
+  public:
+    virtual VOID saveMemoryAccesses(const AccessRecord * accesses,
+                                    size_t count) = 0;
+    virtual VOID onTaskCreate(int taskID) = 0;
+    virtual VOID saveHappensBeforeEdge(int parentID, int childID) = 0;
+
+    // fork-join events of task segments, see hbEngine.h
+    virtual VOID onTaskSpawn(int parentID, int childID) = 0;
+    virtual VOID onTaskContinue(int prevID, int nextID) = 0;
+    virtual VOID onTaskSync(int prevID, int nextID,
+                            const std::vector<int> & childIDs) = 0;
+    virtual VOID onTaskEnd(int taskID) = 0;
+    virtual VOID keepTask(int taskID) = 0;
+
+    virtual ~EventSink() {}
+};
+
+#endif // end eventSink.h
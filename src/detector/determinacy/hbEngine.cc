@@ -0,0 +1,35 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// this file implements the selection of the happens-before engine.
+#include "detector/determinacy/hbEngine.h"  // header
+#include "detector/determinacy/serialBagEngine.h"
+#include "detector/determinacy/vectorClockEngine.h"
+#include "detector/determinacy/spOrderEngine.h"
+#include <cstdlib>
+#include <cstring>
+
+HBEngine * createHBEngine() {
+  const char * name = getenv("TASKSAN_HB_ENGINE");
+  if (!name || !strcmp(name, "serial-bag")) {
+    return new SerialBagEngine();
+  }
+  if (!strcmp(name, "vector-clock")) {
+    return new VectorClockEngine();
+  }
+  if (!strcmp(name, "sp-order")) {
+    return new SPOrderEngine();
+  }
+  std::cerr << "TaskSanitizer: unknown TASKSAN_HB_ENGINE " << name
+            << ", using serial-bag" << std::endl;
+  return new SerialBagEngine();
+}
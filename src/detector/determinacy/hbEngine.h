@@ -0,0 +1,90 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// Defines the interface of happens-before (HB) engines. An engine
+// keeps the HB relation between task segments and answers whether
+// an earlier task is ordered before the current one.
+//
+// Engines are not thread safe. The checker calls onTaskCreate and
+// saveHappensBeforeEdge under its write lock and the queries under
+// its read lock. The engine is chosen at startup through the
+// TASKSAN_HB_ENGINE environment variable:
+//   serial-bag    sets of HB tasks shared with the parents (default)
+//   vector-clock  sparse clocks over strands of the task graph
+//   sp-order      English-Hebrew labels of fork-join task trees
+//
+// Task segments are linked either by general edges (task
+// dependences, text logs) or by the fork-join events spawn,
+// continue and sync. Engines that do not use the fork-join
+// structure see these as general edges.
+
+#ifndef _DETECTOR_DETERMINACY_HBENGINE_H_
+#define _DETECTOR_DETERMINACY_HBENGINE_H_
+
+#include "common/defs.h"
+
+class HBEngine {
+  public:
+    virtual ~HBEngine() {}
+
+    // Executed when a new task is created
+    virtual VOID onTaskCreate(int taskID) = 0;
+
+    // Saves the edge parentID ---happens-before---> childID
+    virtual VOID saveHappensBeforeEdge(int parentID, int childID) = 0;
+
+    // Segment parentID creates the task whose first segment is childID
+    virtual VOID onTaskSpawn(int parentID, int childID) {
+      saveHappensBeforeEdge(parentID, childID);
+    }
+
+    // The task goes on in segment nextID after creating a task
+    virtual VOID onTaskContinue(int prevID, int nextID) {
+      saveHappensBeforeEdge(prevID, nextID);
+    }
+
+    // The task goes on in segment nextID after waiting for the
+    // children created since its last taskwait. childIDs are the
+    // first segments of the children.
+    virtual VOID onTaskSync(int prevID, int nextID,
+                            const std::vector<int> & childIDs) {
+      saveHappensBeforeEdge(prevID, nextID);
+      for (int childID : childIDs) {
+        saveHappensBeforeEdge(childID, nextID);
+      }
+    }
+
+    // The last segment of a task has finished; no more accesses
+    // or incoming edges will name it
+    virtual VOID onTaskEnd(int /* taskID */) {}
+
+    // The task sent a dependence token, so it may be the parent
+    // of edges at any later time
+    virtual VOID keepTask(int /* taskID */) {}
+
+    // Returns the HB state of a task to pass to happensBefore,
+    // or NULL if the task is unknown. It is valid until the
+    // engine is changed.
+    virtual const VOID * getTaskView(int taskID) = 0;
+
+    // Returns true if prevTaskID happens before the task of view
+    virtual bool happensBefore(const VOID * view, int prevTaskID) const = 0;
+
+    virtual size_t taskCount() = 0;
+    virtual const char * getName() = 0;
+    virtual VOID print(std::ostream & os) = 0;
+};
+
+// Creates the engine named by TASKSAN_HB_ENGINE
+HBEngine * createHBEngine();
+
+#endif // end hbEngine.h
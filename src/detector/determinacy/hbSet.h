@@ -0,0 +1,281 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// Defines HBSet, a persistent set of task IDs. The set is a trie
+// of bitmaps:
+//
+//   leaf:  a bitmap of 2^HBSET_LEAF_BITS consecutive task IDs
+//   inner: 2^HBSET_FANOUT_BITS children, NULL when empty
+//
+// Nodes are reference counted and shared between sets. Copying a
+// set shares its root. A union adopts the nodes of the other set
+// wherever they add to or equal its own, so a child that takes the
+// HB set of its parents only allocates the nodes along its delta.
+// A node is changed in place only when a single set refers to it.
+//
+// Sets are not thread safe; the engine that owns them serializes
+// updates.
+
+#ifndef _DETECTOR_DETERMINACY_HBSET_H_
+#define _DETECTOR_DETERMINACY_HBSET_H_
+
+#include "common/defs.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#define HBSET_LEAF_BITS    8  // 256 task IDs per leaf
+#define HBSET_FANOUT_BITS  4  // 16 children per inner node
+
+#define HBSET_LEAF_WORDS   ((1 << HBSET_LEAF_BITS) / 64)
+#define HBSET_FANOUT       (1 << HBSET_FANOUT_BITS)
+
+typedef struct HBSetNode {
+  uint32_t refs;
+  union {
+    struct HBSetNode * children[HBSET_FANOUT];  // inner nodes
+    uint64_t bits[HBSET_LEAF_WORDS];            // leaves
+  };
+} HBSetNode;
+
+class HBSet {
+  public:
+    HBSet(): root(NULL), height(0) {}
+
+    HBSet(const HBSet & other): root(other.root), height(other.height) {
+      retain(root);
+    }
+
+    HBSet(HBSet && other) noexcept: root(other.root), height(other.height) {
+      other.root = NULL;
+      other.height = 0;
+    }
+
+    HBSet & operator=(const HBSet & other) {
+      retain(other.root);
+      release(root, height);
+      root = other.root;
+      height = other.height;
+      return *this;
+    }
+
+    ~HBSet() { release(root, height); }
+
+    VOID clear() {
+      release(root, height);
+      root = NULL;
+      height = 0;
+    }
+
+    bool empty() const { return root == NULL; }
+
+    bool contains(int taskID) const {
+      assert(taskID >= 0);
+      if (!root || (uint64_t)taskID >> shift(height + 1)) return false;
+
+      const HBSetNode * node = root;
+      for (int level = height; level > 0; level--) {
+        node = node->children[(taskID >> shift(level)) & (HBSET_FANOUT - 1)];
+        if (!node) return false;
+      }
+      return (node->bits[(taskID >> 6) & (HBSET_LEAF_WORDS - 1)]
+              >> (taskID & 63)) & 1;
+    }
+
+    VOID insert(int taskID) {
+      assert(taskID >= 0);
+      grow(levelOf(taskID));
+
+      HBSetNode ** slot = &root;
+      for (int level = height; level > 0; level--) {
+        if (!*slot) *slot = newNode(false);
+        own(slot, level);
+        slot = &(*slot)->children[(taskID >> shift(level)) &
+                                  (HBSET_FANOUT - 1)];
+      }
+      if (!*slot) *slot = newNode(true);
+      own(slot, 0);
+      (*slot)->bits[(taskID >> 6) & (HBSET_LEAF_WORDS - 1)] |=
+          uint64_t(1) << (taskID & 63);
+    }
+
+    // Adds all IDs of other to this set
+    VOID unite(const HBSet & other) {
+      if (!other.root) return;
+      grow(other.height);
+
+      // a lower set lies under child 0 of the higher levels
+      HBSetNode ** slot = &root;
+      for (int level = height; level > other.height; level--) {
+        if (!*slot) *slot = newNode(false);
+        own(slot, level);
+        slot = &(*slot)->children[0];
+      }
+      *slot = unite(*slot, other.root, other.height);
+    }
+
+    // Calls visit for every ID in the set, in increasing order
+    template <typename Visitor>
+    VOID forEach(Visitor visit) const {
+      forEach(root, height, 0, visit);
+    }
+
+    size_t size() const {
+      size_t count = 0;
+      forEach([&count](int) { count++; });
+      return count;
+    }
+
+  private:
+    static int shift(int level) {
+      return HBSET_LEAF_BITS + (level - 1) * HBSET_FANOUT_BITS;
+    }
+
+    // the lowest height of a set that holds taskID
+    static int levelOf(int taskID) {
+      int level = 0;
+      while ((uint64_t)taskID >> shift(level + 1)) level++;
+      return level;
+    }
+
+    static HBSetNode * newNode(bool leaf) {
+      size_t bytes = leaf
+          ? offsetof(HBSetNode, bits) + sizeof(uint64_t) * HBSET_LEAF_WORDS
+          : sizeof(HBSetNode);
+      HBSetNode * node = static_cast<HBSetNode *>(calloc(1, bytes));
+      node->refs = 1;
+      return node;
+    }
+
+    static VOID retain(HBSetNode * node) {
+      if (node) node->refs++;
+    }
+
+    static VOID release(HBSetNode * node, int level) {
+      if (!node || --node->refs) return;
+      if (level > 0) {
+        for (int i = 0; i < HBSET_FANOUT; i++) {
+          release(node->children[i], level - 1);
+        }
+      }
+      free(node);
+    }
+
+    // Makes *slot a node that only this set refers to
+    static VOID own(HBSetNode ** slot, int level) {
+      HBSetNode * node = *slot;
+      if (node->refs == 1) return;
+
+      HBSetNode * copy = newNode(level == 0);
+      if (level > 0) {
+        memcpy(copy->children, node->children, sizeof(node->children));
+        for (int i = 0; i < HBSET_FANOUT; i++) retain(copy->children[i]);
+      } else {
+        memcpy(copy->bits, node->bits, sizeof(uint64_t) * HBSET_LEAF_WORDS);
+      }
+      node->refs--;
+      *slot = copy;
+    }
+
+    // Adds levels on top of the root until it reaches level
+    VOID grow(int level) {
+      while (height < level) {
+        if (root) {
+          HBSetNode * top = newNode(false);
+          top->children[0] = root;
+          root = top;
+        }
+        height++;
+      }
+    }
+
+    // Returns the union of a and b, both at level. Takes over the
+    // reference of the caller to a.
+    static HBSetNode * unite(HBSetNode * a, HBSetNode * b, int level) {
+      if (!b || a == b) return a;
+      if (!a) {
+        retain(b);
+        return b;
+      }
+
+      if (level == 0) {
+        bool aHasAll = true, bHasAll = true;
+        for (int i = 0; i < HBSET_LEAF_WORDS; i++) {
+          uint64_t word = a->bits[i] | b->bits[i];
+          aHasAll &= word == a->bits[i];
+          bHasAll &= word == b->bits[i];
+        }
+        if (aHasAll) return a;
+        if (bHasAll) {
+          release(a, 0);
+          retain(b);
+          return b;
+        }
+        own(&a, 0);
+        for (int i = 0; i < HBSET_LEAF_WORDS; i++) a->bits[i] |= b->bits[i];
+        return a;
+      }
+
+      for (int i = 0; i < HBSET_FANOUT; i++) {
+        HBSetNode * child = a->children[i];
+        if (!b->children[i] || child == b->children[i]) continue;
+
+        if (a->refs > 1) {
+          // leave a intact unless the child changes
+          retain(child);
+          HBSetNode * united = unite(child, b->children[i], level - 1);
+          if (united == child) {
+            release(united, level - 1);
+            continue;
+          }
+          own(&a, level);
+          release(a->children[i], level - 1);
+          a->children[i] = united;
+        } else {
+          a->children[i] = unite(child, b->children[i], level - 1);
+        }
+      }
+
+      // share b if both now hold the same children
+      if (a != b && !memcmp(a->children, b->children, sizeof(a->children))) {
+        release(a, level);
+        retain(b);
+        return b;
+      }
+      return a;
+    }
+
+    template <typename Visitor>
+    static VOID forEach(const HBSetNode * node, int level, int first,
+                        Visitor & visit) {
+      if (!node) return;
+      if (level == 0) {
+        for (int i = 0; i < HBSET_LEAF_WORDS; i++) {
+          for (uint64_t word = node->bits[i]; word; word &= word - 1) {
+            visit(first + i * 64 + __builtin_ctzll(word));
+          }
+        }
+        return;
+      }
+      for (int i = 0; i < HBSET_FANOUT; i++) {
+        forEach(node->children[i], level - 1,
+                first + (i << shift(level)), visit);
+      }
+    }
+
+    HBSetNode * root;
+    int height;   // level of the root, 0 for a leaf
+};
+
+#endif // end hbSet.h
@@ -0,0 +1,86 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// this file implements parsing of the textual event log.
+#include "detector/determinacy/logParser.h"  // header
+#include "common/MemoryActions.h"
+
+// Adds a new task node in the simple happens-before graph
+// @params: logLine, a log entry the contains the task ids
+void LogParser::addTaskNode(std::string & logLine) {
+    std::stringstream ssin(logLine);
+    int sibId;
+    int parId;
+
+    ssin >> sibId;
+    ssin >> parId;
+    checker.saveHappensBeforeEdge(parId, sibId);
+}
+
+// Detects determinacy race on a memory read or write
+void LogParser::detectRaceOnMem(
+    int taskID,
+    std::string operation,
+    std::stringstream & ssin) {
+
+  Action action;
+  action.accessing_task_id = taskID;
+  constructMemoryAction(ssin, operation, action);
+
+  if (action.source_func_id == 0) {
+    std::cout << "Warning function Id 0: " << std::endl;
+    exit(0);
+  }
+  MemoryActions memActions( action ); // save first action
+
+  if ( !ssin.eof() ) { // there are still tokens
+    std::string separator;
+    ssin >> separator;
+    ssin >> taskID;
+    Action lastWAction;
+    lastWAction.accessing_task_id = taskID;
+    ssin >> operation;
+    constructMemoryAction(ssin, operation, lastWAction);
+    memActions.storeAction( lastWAction ); // save second action
+  }
+  checker.saveTaskActions( memActions ); // save the actions
+}
+
+// Constructs action object from the log file
+void LogParser::constructMemoryAction(std::stringstream & ssin,
+                                      std::string & operation,
+                                      Action & action) {
+    std::string tempBuff;
+    ssin >> tempBuff; // address
+    action.destination_address = (ADDRESS)stoul(tempBuff, 0, 16);
+
+    ssin >> tempBuff; // value
+    action.value_written = stol(tempBuff);
+
+    ssin >> tempBuff; // line number
+    action.source_line_num = stol(tempBuff);
+
+    ssin >> action.source_func_id; // get function id
+
+    if (operation == "W") {
+      action.is_write_action = true;
+    } else {
+      action.is_write_action = false;
+    }
+#ifdef DEBUG // check if data correctly set
+    std::cout << "Action constructed: ";
+    std::ostringstream buff;
+    action.printAction(buff);
+    std::cout << buff.str();
+    std::cout << std::endl;
+#endif
+}
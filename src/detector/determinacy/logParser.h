@@ -0,0 +1,46 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// Defines the LogParser class. It reads the textual event log
+// (task nodes and memory actions) and feeds the parsed events
+// to a Checker through its typed interface.
+
+#ifndef _DETECTOR_DETERMINACY_LOGPARSER_H_
+#define _DETECTOR_DETERMINACY_LOGPARSER_H_
+
+// includes and definitions
+#include "common/defs.h"
+#include "common/action.h"
+#include "detector/determinacy/checker.h"
+
+class LogParser {
+  public:
+    explicit LogParser(Checker & checker) : checker(checker) {}
+
+    // Adds a new task node in the simple happens-before graph
+    VOID addTaskNode(std::string & logLine);
+
+    // Detects determinacy race on a memory read or write log entry
+    VOID detectRaceOnMem(int taskID,
+                         std::string operation,
+                         std::stringstream & ssin);
+
+  private:
+    // Constructs action object from the log file
+    VOID constructMemoryAction(std::stringstream & ssin,
+                               std::string & opType,
+                               Action & action);
+
+    Checker & checker;
+};
+
+#endif // end logParser.h
@@ -0,0 +1,144 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// Defines an order-maintenance list: a linked list whose nodes
+// carry integer labels that increase along the list, so that the
+// order of two nodes is a single comparison. A node is inserted
+// in the middle of the gap between its neighbours. When there is
+// no gap, the smallest aligned label range around the insertion
+// point that is sparse enough is relabeled evenly (Bender et al.,
+// "Two simplified algorithms for maintaining order in a list").
+
+#ifndef _DETECTOR_DETERMINACY_ORDERMAINTENANCE_H_
+#define _DETECTOR_DETERMINACY_ORDERMAINTENANCE_H_
+
+#include "common/defs.h"
+#include <cmath>
+#include <cstdint>
+#include <deque>
+
+// largest gap left after a new node, keeps room for appends
+#define OM_DEFAULT_SPACING (uint64_t(1) << 32)
+
+// a range of 2^bits labels may hold up to OM_DENSITY^bits nodes
+#define OM_DENSITY 1.4
+
+typedef struct OMNode {
+  uint64_t label;
+  struct OMNode * prev;
+  struct OMNode * next;
+} OMNode;
+
+class OrderList {
+  public:
+    OrderList() {
+      base = newNode();
+      base->label = 0;
+    }
+
+    // nodes are referenced by address, so lists are not copied
+    OrderList(const OrderList &) = delete;
+    OrderList & operator=(const OrderList &) = delete;
+
+    // Removes all nodes but the base
+    VOID clear() {
+      nodes.clear();
+      tail = NULL;
+      base = newNode();
+      base->label = 0;
+    }
+
+    // the first node of the list, every node comes after it
+    OMNode * getBase() { return base; }
+    OMNode * getTail() { return tail; }
+
+    // Returns true if a comes before b in the list
+    static inline bool precedes(const OMNode * a, const OMNode * b) {
+      return a->label < b->label;
+    }
+
+    // Inserts a new node right after x and returns it
+    OMNode * insertAfter(OMNode * x) {
+      OMNode * y = newNode();
+      y->prev = x;
+      y->next = x->next;
+      if (x->next) {
+        x->next->prev = y;
+      } else {
+        tail = y;
+      }
+      x->next = y;
+
+      uint64_t gap = (y->next ? y->next->label : UINT64_MAX) - x->label;
+      if (gap > 1) {
+        y->label = x->label + std::min(gap / 2, OM_DEFAULT_SPACING);
+      } else {
+        relabel(x, y);
+      }
+      return y;
+    }
+
+    // Inserts a new node right before x, which is not the base
+    OMNode * insertBefore(OMNode * x) {
+      return insertAfter(x->prev);
+    }
+
+    size_t size() { return nodes.size(); }
+
+  private:
+    OMNode * newNode() {
+      nodes.push_back(OMNode{0, NULL, NULL});
+      if (!tail) tail = &nodes.back();
+      return &nodes.back();
+    }
+
+    // Spreads the labels of the smallest sparse enough range
+    // around x, which includes the unlabeled node y after x
+    VOID relabel(OMNode * x, OMNode * y) {
+      OMNode * first = x;
+      OMNode * last = y;
+      uint64_t count = 2;
+
+      for (int bits = 1; bits < 64; bits++) {
+        uint64_t size = uint64_t(1) << bits;
+        uint64_t low = x->label & ~(size - 1);
+        uint64_t high = low + (size - 1);
+
+        while (first->prev && first->prev->label >= low) {
+          first = first->prev;
+          count++;
+        }
+        while (last->next && last->next->label <= high) {
+          last = last->next;
+          count++;
+        }
+        if (count > std::pow(OM_DENSITY, bits)) continue;
+
+        uint64_t step = size / count;
+        uint64_t label = low;
+        for (OMNode * node = first; node != last->next; node = node->next) {
+          node->label = label;
+          label += step;
+        }
+        return;
+      }
+      std::cerr << "TaskSanitizer: order-maintenance labels exhausted"
+                << std::endl;
+      exit(1);
+    }
+
+    std::deque<OMNode> nodes;  // stable addresses
+    OMNode * base = NULL;
+    OMNode * tail = NULL;
+};
+
+#endif // end orderMaintenance.h
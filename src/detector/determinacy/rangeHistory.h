@@ -0,0 +1,181 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// Defines the RangeHistory of the checker. Range accesses, such
+// as those of memcpy and memset, are kept as intervals instead of
+// one history per address. Ranges are grouped in size classes of
+// [2^k, 2^(k+1)) bytes, each sorted by start address. In a class
+// whose longest range has maxLength bytes, the ranges overlapping
+// [start, end) are those starting in [start - maxLength + 1, end),
+// so a few huge ranges do not widen the search among small ones.
+// A strided range, e.g. the elements a loop touches, covers width
+// bytes every stride bytes of [start, end) only.
+
+#ifndef _DETECTOR_DETERMINACY_RANGEHISTORY_H_
+#define _DETECTOR_DETERMINACY_RANGEHISTORY_H_
+
+#include "common/defs.h"
+#include "detector/determinacy/accessHistory.h"
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// ranges kept before the oldest quarter is dropped
+#define RANGE_HISTORY_CAPACITY 4096
+
+// size classes of ranges, one per bit of the length
+#define RANGE_SIZE_CLASSES 64
+
+// One recorded range access; cell.value is not used
+typedef struct RangeCell {
+  uintptr_t start;
+  uintptr_t end;     // one past the last byte
+  uint64_t  stride;  // 0 if contiguous
+  uint32_t  width;   // bytes at each stride
+  uint64_t  age;     // order of insertion
+  HistoryCell cell;
+
+  // Returns true if the range covers a byte of [from, to) and
+  // sets at to the first one.
+  bool overlaps(uintptr_t from, uintptr_t to, uintptr_t & at) const {
+    uintptr_t low = std::max(from, start), high = std::min(to, end);
+    if (low >= high) return false;
+    if (!stride) {
+      at = low;
+      return true;
+    }
+    uintptr_t element = start + (low - start) / stride * stride;
+    if (low < element + width) {
+      at = low;
+      return true;
+    }
+    element += stride;
+    at = element;
+    return element < high;
+  }
+
+  // Returns true if both ranges cover a byte and sets at to one
+  bool overlaps(const RangeCell & other, uintptr_t & at) const {
+    if (!stride) return other.overlaps(start, end, at);
+    if (!other.stride) return overlaps(other.start, other.end, at);
+
+    // walks the elements of the sparser one in the common bytes
+    const RangeCell & sparse = (stride >= other.stride) ? *this : other;
+    const RangeCell & dense = (stride >= other.stride) ? other : *this;
+    uintptr_t low = std::max(start, other.start);
+    uintptr_t high = std::min(end, other.end);
+    uintptr_t element =
+        sparse.start + (low - sparse.start) / sparse.stride * sparse.stride;
+    for (; element < high; element += sparse.stride) {
+      if (dense.overlaps(element, element + sparse.width, at)) return true;
+    }
+    return false;
+  }
+
+  // Returns true if every byte of other is covered by this range
+  bool covers(const RangeCell & other) const {
+    if (other.start < start || other.end > end) return false;
+    if (!stride) return true;
+    uintptr_t offset = (other.start - start) % stride;
+    if (!other.stride) return offset + (other.end - other.start) <= width;
+    return other.stride == stride && offset + other.width <= width;
+  }
+} RangeCell;
+
+class RangeHistory {
+  public:
+    RangeHistory(): count(0), usedClasses(0), nextAge(0) {
+      std::fill(maxLength, maxLength + RANGE_SIZE_CLASSES, 0);
+    }
+
+    size_t size() const { return count; }
+
+    // Calls visit(range) for every range whose bytes from the first
+    // to the last overlap [start, end); strided ones may not cover
+    // any byte of it, see RangeCell::overlaps.
+    // The range is removed if visit returns true, which callers
+    // may do only when they hold the history exclusively.
+    // Returns the number of ranges looked at.
+    template <typename Visitor>
+    size_t forEachOverlap(uintptr_t start, uintptr_t end, Visitor visit) {
+      size_t scanned = 0;
+      for (uint64_t used = usedClasses; used; used &= used - 1) {
+        int sizeClass = __builtin_ctzll(used);
+        std::multimap<uintptr_t, RangeCell> & ranges = classes[sizeClass];
+        uintptr_t longest = maxLength[sizeClass];
+        uintptr_t from = (start >= longest) ? start - longest + 1 : 0;
+        auto it = ranges.lower_bound(from);
+        while (it != ranges.end() && it->first < end) {
+          scanned++;
+          if (it->second.end > start && visit(it->second)) {
+            it = ranges.erase(it);
+            count--;
+          } else {
+            ++it;
+          }
+        }
+        if (ranges.empty()) usedClasses &= ~(1ULL << sizeClass);
+      }
+      return scanned;
+    }
+
+    VOID insert(RangeCell range) {
+      range.age = nextAge++;
+      uintptr_t length = range.end - range.start;
+      int sizeClass = getSizeClass(length);
+      classes[sizeClass].insert(std::make_pair(range.start, range));
+      maxLength[sizeClass] = std::max(maxLength[sizeClass], length);
+      usedClasses |= 1ULL << sizeClass;
+      if (++count > RANGE_HISTORY_CAPACITY) evictOldest();
+    }
+
+  private:
+    // Returns k for lengths of [2^k, 2^(k+1)) bytes, 0 for empty ones
+    static int getSizeClass(uintptr_t length) {
+      return length > 1 ? 63 - __builtin_clzll(length) : 0;
+    }
+
+    // Drops the oldest quarter of the ranges
+    VOID evictOldest() {
+      std::vector<uint64_t> ages;
+      for (auto & ranges : classes)
+        for (auto & entry : ranges) ages.push_back(entry.second.age);
+      auto cut = ages.begin() + ages.size() / 4;
+      std::nth_element(ages.begin(), cut, ages.end());
+
+      for (int sizeClass = 0; sizeClass < RANGE_SIZE_CLASSES; sizeClass++) {
+        std::multimap<uintptr_t, RangeCell> & ranges = classes[sizeClass];
+        maxLength[sizeClass] = 0;
+        for (auto it = ranges.begin(); it != ranges.end(); ) {
+          if (it->second.age < *cut) {
+            it = ranges.erase(it);
+            count--;
+          } else {
+            maxLength[sizeClass] = std::max(maxLength[sizeClass],
+                                            it->second.end - it->second.start);
+            ++it;
+          }
+        }
+        if (ranges.empty()) usedClasses &= ~(1ULL << sizeClass);
+      }
+    }
+
+    // ranges by start address, per size class
+    std::multimap<uintptr_t, RangeCell> classes[RANGE_SIZE_CLASSES];
+    uintptr_t maxLength[RANGE_SIZE_CLASSES];
+    size_t count;
+    uint64_t usedClasses;  // bit k is set if class k has ranges
+    uint64_t nextAge;
+};
+
+#endif // end rangeHistory.h
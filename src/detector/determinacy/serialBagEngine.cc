@@ -0,0 +1,177 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// this file implements the serial-bag happens-before engine.
+#include "detector/determinacy/serialBagEngine.h"  // header
+#include <cassert>
+
+SerialBagEngine::SerialBagEngine(bool retire):
+  retire(retire), totalTasks(0),
+  retiredTasks(0), releasedTasks(0) {}
+
+TaskRecord & SerialBagEngine::getRecord(int taskID) {
+  assert(taskID >= 0);
+  if ((size_t)taskID >= records.size()) {
+    records.resize(std::max((size_t)taskID + 1, 2 * records.size()));
+  }
+  return records[taskID];
+}
+
+// Executed when a new task is created
+VOID SerialBagEngine::onTaskCreate(int taskID) {
+  createTaskBag(taskID);
+}
+
+VOID SerialBagEngine::createTaskBag(int taskID) {
+  TaskRecord & record = getRecord(taskID);
+  if (record.state != TASK_UNKNOWN) return;
+
+  record.bag = new SerialBag();
+  record.state = TASK_LIVE;
+  graph[taskID].taskID = taskID; // put it in the simple HB graph
+  totalTasks++;
+}
+
+VOID SerialBagEngine::mergeBag(int parentID, SerialBag & bag) {
+  const TaskRecord & parent = records[parentID];
+  if (parent.state == TASK_LIVE) {
+    bag.HB.unite(parent.bag->HB);
+  } else if (parent.state == TASK_RETIRED) {
+    bag.HB.unite(parent.retiredHB);
+  }
+  // a released task has no successors left
+}
+
+// Saves a happens edge between predecessor and successor task in
+// dependence edge. The parent's bag is merged into the successor's
+// bag, which only grows.
+VOID SerialBagEngine::saveHappensBeforeEdge(int parentId, int siblingId) {
+  createTaskBag(parentId);
+  createTaskBag(siblingId);
+
+  TaskRecord & sibling = records[siblingId];
+  if (sibling.state != TASK_LIVE) return; // ended tasks get no edges
+
+  if (records[parentId].state == TASK_LIVE) {
+    graph[parentId].outEdges.insert(siblingId);
+    records[parentId].bag->outBufferCount++;
+  }
+  graph[siblingId].inEdges.insert(parentId);
+
+  mergeBag(parentId, *sibling.bag);
+  sibling.bag->HB.insert(parentId); // parents happen-before me
+}
+
+// the child is released once a taskwait of the parent joins it
+VOID SerialBagEngine::onTaskSpawn(int parentID, int childID) {
+  saveHappensBeforeEdge(parentID, childID);
+  getRecord(childID).pendingJoins++;
+}
+
+VOID SerialBagEngine::onTaskContinue(int prevID, int nextID) {
+  saveHappensBeforeEdge(prevID, nextID);
+  retireTask(prevID);
+}
+
+VOID SerialBagEngine::onTaskSync(int prevID, int nextID,
+                                 const std::vector<int> & childIDs) {
+  HBEngine::onTaskSync(prevID, nextID, childIDs);
+  retireTask(prevID);
+
+  for (int childID : childIDs) {
+    TaskRecord & child = getRecord(childID);
+    if (child.pendingJoins) child.pendingJoins--;
+    if (child.state == TASK_RETIRED) releaseTask(childID);
+  }
+}
+
+// Executed when the last segment of a task has finished
+VOID SerialBagEngine::onTaskEnd(int taskID) {
+  retireTask(taskID);
+}
+
+// The task sent a dependence token, so edges from it may
+// arrive at any later time
+VOID SerialBagEngine::keepTask(int taskID) {
+  createTaskBag(taskID);
+  records[taskID].kept = true;
+}
+
+VOID SerialBagEngine::retireTask(int taskID) {
+  if (!retire || (size_t)taskID >= records.size()) return;
+  TaskRecord & record = records[taskID];
+  if (record.state != TASK_LIVE) return;
+
+  if (!record.pendingJoins && !record.kept) {
+    record.state = TASK_RELEASED;
+    releasedTasks++;
+  } else {
+    record.retiredHB = record.bag->HB;  // shares the nodes
+    record.state = TASK_RETIRED;
+    retiredTasks++;
+  }
+  delete record.bag;
+  record.bag = NULL;
+  graph.erase(taskID);
+}
+
+VOID SerialBagEngine::releaseTask(int taskID) {
+  TaskRecord & record = records[taskID];
+  if (record.state != TASK_RETIRED || record.pendingJoins || record.kept) {
+    return;
+  }
+  record.state = TASK_RELEASED;
+  record.retiredHB.clear();
+  retiredTasks--;
+  releasedTasks++;
+}
+
+// Returns the record of a task that has not been released
+const VOID * SerialBagEngine::getTaskView(int taskID) {
+  if (taskID < 0 || (size_t)taskID >= records.size()) return NULL;
+  const TaskRecord & record = records[taskID];
+  if (record.state == TASK_LIVE || record.state == TASK_RETIRED) {
+    return &record;
+  }
+  return NULL;
+}
+
+bool SerialBagEngine::happensBefore(const VOID * view,
+                                    int prevTaskID) const {
+  const TaskRecord * record = static_cast<const TaskRecord *>(view);
+  if (!record) return false;
+
+  if (record->bag) return record->bag->HB.contains(prevTaskID);
+  return record->retiredHB.contains(prevTaskID);
+}
+
+VOID SerialBagEngine::print(std::ostream & os) {
+  for (size_t id = 0; id < records.size(); id++) {
+    const TaskRecord & record = records[id];
+    if (record.state == TASK_LIVE) {
+      os << id << " ("<< record.bag->outBufferCount<< "): {";
+      record.bag->HB.forEach([&os](int x) { os << x << " "; });
+      os << "}" << std::endl;
+    } else if (record.state == TASK_RETIRED) {
+      os << id << " (retired): {";
+      record.retiredHB.forEach([&os](int x) { os << x << " "; });
+      os << "}" << std::endl;
+    }
+  }
+}
+
+// frees the memory dynamically generated for S-bags
+SerialBagEngine::~SerialBagEngine() {
+  for (TaskRecord & record : records) {
+    delete record.bag;
+  }
+}
@@ -0,0 +1,113 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// Defines the serial-bag happens-before engine. Every task has a
+// bag with the IDs of all tasks that happen before it, made by
+// merging the bags of its parents. Bags hold persistent HBSets,
+// so a task shares the HB set of its parents and only adds the
+// nodes of its own delta.
+//
+// A segment that has ended is retired: its bag and edges are
+// freed and only its HB set is kept, from which it can still be
+// merged into successors and queried. A retired segment is
+// released altogether once no taskwait will join it and it has
+// sent no dependence token.
+
+#ifndef _DETECTOR_DETERMINACY_SERIALBAGENGINE_H_
+#define _DETECTOR_DETERMINACY_SERIALBAGENGINE_H_
+
+#include "detector/determinacy/hbEngine.h"
+#include "detector/determinacy/hbSet.h"
+#include <cstdint>
+
+// a bag to hold the tasks that happened-before
+typedef struct SerialBag {
+  int outBufferCount;
+  HBSet HB;  // persistent int set
+
+  SerialBag(): outBufferCount(0){}
+} SerialBag;
+
+// for constructing happans-before between tasks
+typedef struct Task {
+  int taskID;     // identity of the task
+  UNORD_INTSET inEdges;  // incoming data streams
+  UNORD_INTSET outEdges; // outgoing data streams
+} Task;
+
+typedef SerialBag * SerialBagPtr;
+
+enum TaskState { TASK_UNKNOWN, TASK_LIVE, TASK_RETIRED, TASK_RELEASED };
+
+// HB state of a task, indexed by task ID
+typedef struct TaskRecord {
+  SerialBagPtr bag;       // while the task is live
+  HBSet    retiredHB;     // HB set once the task is retired
+  uint16_t pendingJoins;  // taskwaits that will join the task
+  uint8_t  state;
+  bool     kept;          // may be the source of dependence edges
+
+  TaskRecord(): bag(NULL), pendingJoins(0),
+                state(TASK_UNKNOWN), kept(false) {}
+} TaskRecord;
+
+class SerialBagEngine : public HBEngine {
+  public:
+    SerialBagEngine(bool retire = true);
+    VOID onTaskCreate(int taskID);
+    VOID saveHappensBeforeEdge(int parentID, int childID);
+    VOID onTaskSpawn(int parentID, int childID);
+    VOID onTaskContinue(int prevID, int nextID);
+    VOID onTaskSync(int prevID, int nextID,
+                    const std::vector<int> & childIDs);
+    VOID onTaskEnd(int taskID);
+    VOID keepTask(int taskID);
+    const VOID * getTaskView(int taskID);
+    bool happensBefore(const VOID * view, int prevTaskID) const;
+    size_t taskCount() { return totalTasks; }
+    const char * getName() { return "serial-bag"; }
+    VOID print(std::ostream & os);
+    ~SerialBagEngine();
+
+    // numbers of live, retired and released tasks
+    size_t liveTaskCount() { return graph.size(); }
+    size_t retiredTaskCount() { return retiredTasks; }
+    size_t releasedTaskCount() { return releasedTasks; }
+
+  private:
+    // Returns the record of a task, creating it if new
+    TaskRecord & getRecord(int taskID);
+
+    // Creates the serial bag of a task unless it has one
+    VOID createTaskBag(int taskID);
+
+    // Adds the HB set of parentID to bag
+    VOID mergeBag(int parentID, SerialBag & bag);
+
+    // Frees the bag and edges of an ended task
+    VOID retireTask(int taskID);
+
+    // Frees the HB set of a retired task nobody refers to
+    VOID releaseTask(int taskID);
+
+    // live tasks: in and out edges
+    std::unordered_map<INTEGER, Task> graph;
+
+    std::vector<TaskRecord> records;
+
+    bool retire;
+    size_t totalTasks;
+    size_t retiredTasks;
+    size_t releasedTasks;
+};
+
+#endif // end serialBagEngine.h
@@ -0,0 +1,130 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// Defines the ShadowMemory class. It maps application addresses
+// to shadow cells through a two-level page table:
+//
+//   granule = address >> SHADOW_GRANULE_BITS
+//   level 1 = granule >> SHADOW_PAGE_BITS  (array of page pointers)
+//   level 2 = granule & page mask          (array of cells)
+//
+// Both levels are mmap'ed. Level 1 is reserved once with
+// MAP_NORESERVE and level 2 pages are installed on first touch,
+// so memory is only spent on pages the application uses.
+// Level-1 indices wrap around for addresses above the covered
+// range; users of a cell must therefore keep the exact address
+// with whatever they store in it.
+
+#ifndef _DETECTOR_DETERMINACY_SHADOWMEMORY_H_
+#define _DETECTOR_DETERMINACY_SHADOWMEMORY_H_
+
+#include "common/defs.h"
+#include <atomic>
+#include <cassert>
+#include <mutex>
+#include <sys/mman.h>
+#include <vector>
+
+#define SHADOW_GRANULE_BITS 3   // one cell per 8 application bytes
+#define SHADOW_PAGE_BITS    20  // cells per level-2 page
+#define SHADOW_L1_BITS      24  // covers 47-bit user addresses
+
+// Cell must be valid when all its bytes are zero.
+template <typename Cell>
+class ShadowMemory {
+  public:
+    ShadowMemory() {
+      directory = static_cast<std::atomic<Cell *> *>(
+          mapZeroed(sizeof(std::atomic<Cell *>) << SHADOW_L1_BITS));
+    }
+
+    ~ShadowMemory() {
+      for (Cell * page : pages) {
+        munmap(page, PAGE_BYTES);
+      }
+      munmap(directory, sizeof(std::atomic<Cell *>) << SHADOW_L1_BITS);
+    }
+
+    // Returns the cell of the granule containing addr.
+    // Allocates the level-2 page on first touch.
+    inline Cell & getCell(ADDRESS addr) {
+      size_t granule = reinterpret_cast<size_t>(addr) >> SHADOW_GRANULE_BITS;
+      size_t index = (granule >> SHADOW_PAGE_BITS) & L1_MASK;
+
+      Cell * page = directory[index].load(std::memory_order_acquire);
+      if (!page) {
+        page = installPage(index);
+      }
+      return page[granule & PAGE_MASK];
+    }
+
+    // Returns the cell of the granule containing addr, or NULL
+    // if its page was never touched
+    inline Cell * findCell(ADDRESS addr) {
+      size_t granule = reinterpret_cast<size_t>(addr) >> SHADOW_GRANULE_BITS;
+      size_t index = (granule >> SHADOW_PAGE_BITS) & L1_MASK;
+
+      Cell * page = directory[index].load(std::memory_order_acquire);
+      return page ? &page[granule & PAGE_MASK] : NULL;
+    }
+
+    // Visits every cell of every installed page. Not thread safe.
+    template <typename Visitor>
+    VOID forEachCell(Visitor visit) {
+      for (Cell * page : pages) {
+        for (size_t i = 0; i <= PAGE_MASK; i++) {
+          visit(page[i]);
+        }
+      }
+    }
+
+    // Returns the number of level-2 pages installed
+    size_t pageCount() {
+      std::lock_guard<std::mutex> guard(pagesLock);
+      return pages.size();
+    }
+
+  private:
+    static const size_t L1_MASK = (size_t(1) << SHADOW_L1_BITS) - 1;
+    static const size_t PAGE_MASK = (size_t(1) << SHADOW_PAGE_BITS) - 1;
+    static const size_t PAGE_BYTES = sizeof(Cell) << SHADOW_PAGE_BITS;
+
+    static VOID * mapZeroed(size_t bytes) {
+      VOID * mem = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+          MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+      if (mem == MAP_FAILED) {
+        std::cerr << "TaskSanitizer: shadow memory mmap failed" << std::endl;
+        exit(1);
+      }
+      return mem;
+    }
+
+    // Installs a new page unless another thread did it first
+    Cell * installPage(size_t index) {
+      Cell * page = static_cast<Cell *>(mapZeroed(PAGE_BYTES));
+      Cell * expected = NULL;
+      if (!directory[index].compare_exchange_strong(expected, page,
+            std::memory_order_acq_rel)) {
+        munmap(page, PAGE_BYTES);
+        return expected;
+      }
+      std::lock_guard<std::mutex> guard(pagesLock);
+      pages.push_back(page);
+      return page;
+    }
+
+    std::atomic<Cell *> * directory;  // level 1
+    std::vector<Cell *> pages;        // installed level-2 pages
+    std::mutex pagesLock;
+};
+
+#endif // end shadowMemory.h
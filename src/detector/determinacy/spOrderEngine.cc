@@ -0,0 +1,224 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// this file implements the SP-order happens-before engine.
+#include "detector/determinacy/spOrderEngine.h"  // header
+#include "detector/determinacy/vectorClockEngine.h"
+#include <cassert>
+
+SPOrderEngine::SPOrderEngine(): knownTasks(0), fallback(NULL) {}
+
+SPOrderEngine::~SPOrderEngine() {
+  delete fallback;
+}
+
+SPTask & SPOrderEngine::getTask(int taskID) {
+  assert(taskID >= 0);
+  if ((size_t)taskID >= tasks.size()) {
+    tasks.resize(std::max((size_t)taskID + 1, 2 * tasks.size()));
+  }
+  SPTask & task = tasks[taskID];
+  if (!task.known) {
+    task.known = true;
+    knownTasks++;
+  }
+  return task;
+}
+
+int SPOrderEngine::createFrame(OMNode * englishNode, OMNode * hebrewNode) {
+  SPFrame frame;
+  frame.englishEnd = english.insertAfter(englishNode);
+  frame.hebrewEnd = hebrew.insertAfter(hebrewNode);
+  frame.pendingChildren = 0;
+  frames.push_back(frame);
+  return frames.size() - 1;
+}
+
+// Roots go to the end of English order and to the front of
+// Hebrew order, so any two roots are parallel
+VOID SPOrderEngine::placeRoot(int taskID) {
+  SPTask & task = tasks[taskID];
+  task.english = english.insertAfter(english.getTail());
+  task.hebrew = hebrew.insertAfter(hebrew.getBase());
+  task.frame = createFrame(task.english, task.hebrew);
+}
+
+// Executed when a new task is created. The task is placed by
+// the first fork-join event that names it.
+VOID SPOrderEngine::onTaskCreate(int taskID) {
+  if (fallback) return fallback->onTaskCreate(taskID);
+
+  getTask(taskID);
+  events.push_back(SPEvent{CREATE_EVENT, taskID, -1});
+}
+
+// A general edge is not series-parallel
+VOID SPOrderEngine::saveHappensBeforeEdge(int parentID, int childID) {
+  if (!fallback) fallBack();
+  fallback->saveHappensBeforeEdge(parentID, childID);
+}
+
+VOID SPOrderEngine::onTaskSpawn(int parentID, int childID) {
+  if (fallback) return fallback->onTaskSpawn(parentID, childID);
+
+  getTask(parentID);
+  SPTask & child = getTask(childID); // may move tasks
+  SPTask & parent = tasks[parentID];
+  if (child.english) {
+    fallBack();
+    return fallback->onTaskSpawn(parentID, childID);
+  }
+  if (!parent.english) placeRoot(parentID);
+
+  // English: after the children spawned before, Hebrew: before them
+  child.english = english.insertAfter(
+      parent.lastChildEnd ? parent.lastChildEnd : parent.english);
+  child.hebrew = hebrew.insertAfter(parent.hebrew);
+  child.frame = createFrame(child.english, child.hebrew);
+  parent.lastChildEnd = frames[child.frame].englishEnd;
+  frames[parent.frame].pendingChildren++;
+
+  events.push_back(SPEvent{SPAWN_EVENT, parentID, childID});
+}
+
+VOID SPOrderEngine::onTaskContinue(int prevID, int nextID) {
+  if (fallback) return fallback->onTaskContinue(prevID, nextID);
+
+  getTask(prevID);
+  SPTask & next = getTask(nextID); // may move tasks
+  SPTask & prev = tasks[prevID];
+  if (next.english) {
+    fallBack();
+    return fallback->onTaskContinue(prevID, nextID);
+  }
+  if (!prev.english) placeRoot(prevID);
+
+  // English: after the spawned children, Hebrew: before them
+  next.english = english.insertAfter(
+      prev.lastChildEnd ? prev.lastChildEnd : prev.english);
+  next.hebrew = hebrew.insertAfter(prev.hebrew);
+  next.frame = prev.frame;
+
+  events.push_back(SPEvent{CONTINUE_EVENT, prevID, nextID});
+}
+
+VOID SPOrderEngine::onTaskSync(int prevID, int nextID,
+                               const std::vector<int> & childIDs) {
+  if (fallback) return fallback->onTaskSync(prevID, nextID, childIDs);
+
+  for (int childID : childIDs) getTask(childID);
+  getTask(prevID);
+  SPTask & next = getTask(nextID); // may move tasks
+  SPTask & prev = tasks[prevID];
+  if (!prev.english) placeRoot(prevID);
+
+  // every child must be joined along with all its descendants
+  SPFrame & frame = frames[prev.frame];
+  bool seriesParallel = !next.english &&
+      frame.pendingChildren == (int)childIDs.size();
+  for (int childID : childIDs) {
+    if (!seriesParallel) break;
+    const SPTask & child = tasks[childID];
+    seriesParallel = child.english && child.frame != prev.frame &&
+                     frames[child.frame].pendingChildren == 0;
+  }
+  if (!seriesParallel) {
+    fallBack();
+    return fallback->onTaskSync(prevID, nextID, childIDs);
+  }
+
+  // the end of the region comes after everything inside it
+  next.english = english.insertBefore(frame.englishEnd);
+  next.hebrew = hebrew.insertBefore(frame.hebrewEnd);
+  next.frame = prev.frame;
+  frame.pendingChildren = 0;
+
+  events.push_back(SPEvent{EDGE_EVENT, prevID, nextID});
+  for (int childID : childIDs) {
+    events.push_back(SPEvent{EDGE_EVENT, childID, nextID});
+  }
+}
+
+VOID SPOrderEngine::fallBack() {
+  fallback = new VectorClockEngine();
+  for (const SPEvent & event : events) {
+    switch (event.kind) {
+      case CREATE_EVENT:
+        fallback->onTaskCreate(event.first);
+        break;
+      case SPAWN_EVENT:
+        fallback->onTaskSpawn(event.first, event.second);
+        break;
+      case CONTINUE_EVENT:
+        fallback->onTaskContinue(event.first, event.second);
+        break;
+      case EDGE_EVENT:
+        fallback->saveHappensBeforeEdge(event.first, event.second);
+        break;
+    }
+  }
+
+  // labels are not needed anymore
+  std::vector<SPEvent>().swap(events);
+  std::vector<SPTask>().swap(tasks);
+  std::vector<SPFrame>().swap(frames);
+  english.clear();
+  hebrew.clear();
+}
+
+const VOID * SPOrderEngine::getTaskView(int taskID) {
+  if (fallback) return fallback->getTaskView(taskID);
+
+  if (taskID < 0 || (size_t)taskID >= tasks.size()) return NULL;
+  const SPTask & task = tasks[taskID];
+  return task.known ? &task : NULL;
+}
+
+bool SPOrderEngine::happensBefore(const VOID * view,
+                                  int prevTaskID) const {
+  if (fallback) return fallback->happensBefore(view, prevTaskID);
+
+  if (!view || prevTaskID < 0 || (size_t)prevTaskID >= tasks.size()) {
+    return false;
+  }
+  const SPTask * task = static_cast<const SPTask *>(view);
+  const SPTask & prev = tasks[prevTaskID];
+  if (!task->english || !prev.english) return false; // not placed
+
+  return OrderList::precedes(prev.english, task->english) &&
+         OrderList::precedes(prev.hebrew, task->hebrew);
+}
+
+size_t SPOrderEngine::taskCount() {
+  return fallback ? fallback->taskCount() : knownTasks;
+}
+
+const char * SPOrderEngine::getName() {
+  return fallback ? "sp-order (fell back to vector-clock)" : "sp-order";
+}
+
+VOID SPOrderEngine::print(std::ostream & os) {
+  if (fallback) return fallback->print(os);
+
+  for (size_t id = 0; id < tasks.size(); id++) {
+    const SPTask & task = tasks[id];
+    if (!task.known) continue;
+
+    os << id << " (frame " << task.frame << "): ";
+    if (task.english) {
+      os << "{" << task.english->label << " " << task.hebrew->label << "}";
+    } else {
+      os << "{not placed}";
+    }
+    os << std::endl;
+  }
+}
@@ -0,0 +1,105 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// Defines the SP-order happens-before engine for programs whose
+// tasks nest series-parallel, i.e. use only task and taskwait.
+// Every segment has a node in two order-maintenance lists, the
+// English and the Hebrew order, and
+//
+//   prev happens before cur  <=>  prev precedes cur in both orders
+//
+// On a spawn the child comes before the continuation in English
+// order and after it in Hebrew order. Every task owns a region
+// of both lists closed by end nodes; all its segments and its
+// descendants are placed inside, and a taskwait places the next
+// segment at the end of the region. Space is O(1) per segment.
+//
+// Task dependences and children that outlive their parent break
+// the series-parallel structure. The engine then replays the
+// events it has seen into a vector-clock engine and hands all
+// further work over to it.
+
+#ifndef _DETECTOR_DETERMINACY_SPORDERENGINE_H_
+#define _DETECTOR_DETERMINACY_SPORDERENGINE_H_
+
+#include "detector/determinacy/hbEngine.h"
+#include "detector/determinacy/orderMaintenance.h"
+
+// region of a task in both orders
+typedef struct SPFrame {
+  OMNode * englishEnd;
+  OMNode * hebrewEnd;
+  int pendingChildren;  // children not joined by a taskwait yet
+} SPFrame;
+
+typedef struct SPTask {
+  bool     known;
+  OMNode * english;     // NULL until the segment is placed
+  OMNode * hebrew;
+  OMNode * lastChildEnd;  // English end of the last spawned child
+  int      frame;       // index of the region of the task
+
+  SPTask(): known(false), english(NULL), hebrew(NULL),
+            lastChildEnd(NULL), frame(-1) {}
+} SPTask;
+
+class SPOrderEngine : public HBEngine {
+  public:
+    SPOrderEngine();
+    ~SPOrderEngine();
+    VOID onTaskCreate(int taskID);
+    VOID saveHappensBeforeEdge(int parentID, int childID);
+    VOID onTaskSpawn(int parentID, int childID);
+    VOID onTaskContinue(int prevID, int nextID);
+    VOID onTaskSync(int prevID, int nextID,
+                    const std::vector<int> & childIDs);
+    const VOID * getTaskView(int taskID);
+    bool happensBefore(const VOID * view, int prevTaskID) const;
+    size_t taskCount();
+    const char * getName();
+    VOID print(std::ostream & os);
+
+  private:
+    enum EventKind { CREATE_EVENT, SPAWN_EVENT, CONTINUE_EVENT, EDGE_EVENT };
+
+    // one task event, kept for replay in the fallback engine
+    typedef struct SPEvent {
+      EventKind kind;
+      int first;
+      int second;
+    } SPEvent;
+
+    // Returns the task, creating it if new
+    SPTask & getTask(int taskID);
+
+    // Gives a task that is not placed yet a region of its own,
+    // parallel to all other regions
+    VOID placeRoot(int taskID);
+
+    // Creates a region which ends right after the given nodes
+    int createFrame(OMNode * english, OMNode * hebrew);
+
+    // Replays the events into a vector-clock engine, which
+    // answers all further queries
+    VOID fallBack();
+
+    std::vector<SPTask> tasks;  // indexed by task ID
+    std::vector<SPFrame> frames;
+    size_t knownTasks;
+    OrderList english;
+    OrderList hebrew;
+
+    std::vector<SPEvent> events;
+    HBEngine * fallback;
+};
+
+#endif // end spOrderEngine.h
@@ -0,0 +1,78 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// Defines a bounded single-producer/single-consumer queue. One
+// thread pushes and one thread pops, without locks. Each side
+// keeps a private copy of the other side's index and reloads it
+// only when the queue looks full or empty, so the shared indices
+// are rarely read across cores.
+
+#ifndef _DETECTOR_DETERMINACY_SPSCQUEUE_H_
+#define _DETECTOR_DETERMINACY_SPSCQUEUE_H_
+
+#include "common/defs.h"
+#include <atomic>
+#include <cstddef>
+
+#define SPSC_CACHE_LINE_SIZE 64
+
+// Capacity must be a power of two
+template <typename T, size_t Capacity>
+class SPSCQueue {
+  public:
+    SPSCQueue(): head(0), cachedTail(0), tail(0), cachedHead(0) {}
+
+    // Appends item unless the queue is full. Producer only.
+    inline bool push(const T & item) {
+      size_t last = tail.load(std::memory_order_relaxed);
+      if (last - cachedHead == Capacity) {
+        cachedHead = head.load(std::memory_order_acquire);
+        if (last - cachedHead == Capacity) return false;
+      }
+      slots[last & MASK] = item;
+      tail.store(last + 1, std::memory_order_release);
+      return true;
+    }
+
+    // Returns the oldest item or NULL if empty. Consumer only.
+    inline T * front() {
+      size_t first = head.load(std::memory_order_relaxed);
+      if (first == cachedTail) {
+        cachedTail = tail.load(std::memory_order_acquire);
+        if (first == cachedTail) return NULL;
+      }
+      return &slots[first & MASK];
+    }
+
+    // Removes the item returned by front. Consumer only.
+    inline VOID pop() {
+      head.store(head.load(std::memory_order_relaxed) + 1,
+                 std::memory_order_release);
+    }
+
+  private:
+    static_assert((Capacity & (Capacity - 1)) == 0,
+                  "capacity must be a power of two");
+    static const size_t MASK = Capacity - 1;
+
+    // consumer side
+    alignas(SPSC_CACHE_LINE_SIZE) std::atomic<size_t> head;
+    size_t cachedTail;
+
+    // producer side
+    alignas(SPSC_CACHE_LINE_SIZE) std::atomic<size_t> tail;
+    size_t cachedHead;
+
+    alignas(SPSC_CACHE_LINE_SIZE) T slots[Capacity];
+};
+
+#endif // end spscQueue.h
@@ -0,0 +1,124 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// Defines the binary trace of record mode. Layout of a file:
+//
+//   TraceFileHeader
+//   chunks:  TraceChunkHeader, then encoded items
+//   sites:   the source site tables of all modules
+//   index:   one TraceIndexEntry per chunk, in write order
+//   TraceFileFooter
+//
+// Every application thread writes its own stream of chunks. The
+// items of a chunk are encoded relative to the previous item of
+// the same chunk, so any chunk can be decoded alone. An item is
+// a tag byte followed by LEB128 varints; signed values are
+// zigzag encoded deltas:
+//
+//   task event:  tag, seq delta, task ID deltas [, count, IDs]
+//   batch:       tag, seq delta     (starts a run of accesses)
+//   access:      tag|flags, [task delta], [site delta],
+//                address delta [, value of a write],
+//                or for ranges: address delta, size, width [, stride]
+//
+// Task events are numbered across threads. A batch carries the
+// number of events posted before its accesses, like the batches
+// of the AsyncChecker, which tells the replay where they belong.
+
+#ifndef _DETECTOR_DETERMINACY_TRACEFORMAT_H_
+#define _DETECTOR_DETERMINACY_TRACEFORMAT_H_
+
+#include "common/defs.h"
+#include <cstdint>
+
+#define TRACE_MAGIC         "TSANTRC1"
+#define TRACE_VERSION       3
+#define TRACE_CHUNK_SIZE    (1 << 20)  // bytes of a chunk
+#define TRACE_MAX_ITEM_SIZE 64         // largest item but a sync
+
+enum TraceTag {
+  TRACE_READ = 1,
+  TRACE_WRITE,
+  TRACE_BATCH,
+  TRACE_TASK_CREATE,
+  TRACE_EDGE,
+  TRACE_SPAWN,
+  TRACE_CONTINUE,
+  TRACE_SYNC,
+  TRACE_END,
+  TRACE_KEEP
+};
+
+// flags of access tags
+#define TRACE_TAG_MASK   0x0F
+#define TRACE_SAME_TASK  0x10
+#define TRACE_SAME_SITE  0x20
+#define TRACE_RANGE      0x40
+
+typedef struct TraceFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+} TraceFileHeader;
+
+typedef struct TraceChunkHeader {
+  uint32_t stream;  // the writing thread
+  uint32_t size;    // bytes of items after the header
+} TraceChunkHeader;
+
+typedef struct TraceIndexEntry {
+  uint64_t offset;  // of the chunk header
+  uint32_t stream;
+  uint32_t size;
+} TraceIndexEntry;
+
+typedef struct TraceFileFooter {
+  uint64_t sitesOffset;
+  uint64_t sitesSize;
+  uint64_t indexOffset;
+  uint64_t chunkCount;
+  uint32_t streamCount;
+  uint32_t reserved;
+  char magic[8];
+} TraceFileFooter;
+
+// Appends v as LEB128 and returns the end
+static inline uint8_t * putVarint(uint8_t * out, uint64_t v) {
+  while (v >= 0x80) {
+    *out++ = (uint8_t)(v | 0x80);
+    v >>= 7;
+  }
+  *out++ = (uint8_t)v;
+  return out;
+}
+
+// Reads a LEB128 value; returns NULL past end
+static inline const uint8_t * getVarint(const uint8_t * in,
+                                        const uint8_t * end, uint64_t & v) {
+  v = 0;
+  for (int shift = 0; in < end && shift < 64; shift += 7) {
+    uint8_t byte = *in++;
+    v |= (uint64_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) return in;
+  }
+  return NULL;
+}
+
+static inline uint64_t zigzag(int64_t v) {
+  return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t v) {
+  return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+#endif // end traceFormat.h
@@ -0,0 +1,319 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// this file implements the trace reader of tasksan-analyze.
+#include "detector/determinacy/traceReader.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+TraceReader::TraceReader():
+  data(NULL), size(0), events(0), accesses(0) {
+  memset(&footer, 0, sizeof(footer));
+}
+
+TraceReader::~TraceReader() {
+  if (data) munmap(const_cast<uint8_t *>(data), size);
+}
+
+bool TraceReader::open(const char * path, std::string & error) {
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0) {
+    error = std::string("cannot open ") + path + ": " + strerror(errno);
+    return false;
+  }
+  struct stat status;
+  if (fstat(fd, &status) < 0 || status.st_size <
+      (off_t)(sizeof(TraceFileHeader) + sizeof(TraceFileFooter))) {
+    ::close(fd);
+    error = std::string(path) + " is not a trace";
+    return false;
+  }
+  size = status.st_size;
+  void * mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapped == MAP_FAILED) {
+    error = std::string("cannot map ") + path + ": " + strerror(errno);
+    return false;
+  }
+  data = static_cast<const uint8_t *>(mapped);
+
+  TraceFileHeader header;
+  memcpy(&header, data, sizeof(header));
+  memcpy(&footer, data + size - sizeof(footer), sizeof(footer));
+  if (memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) ||
+      memcmp(footer.magic, TRACE_MAGIC, sizeof(footer.magic))) {
+    error = std::string(path) + " is not a complete trace";
+    return false;
+  }
+  if (header.version != TRACE_VERSION) {
+    error = "unsupported trace version " + std::to_string(header.version);
+    return false;
+  }
+
+  uint64_t indexEnd = size - sizeof(footer);
+  if (footer.indexOffset > indexEnd ||
+      footer.chunkCount > (indexEnd - footer.indexOffset) /
+                          sizeof(TraceIndexEntry) ||
+      footer.sitesOffset + footer.sitesSize > footer.indexOffset) {
+    error = "corrupt trace footer";
+    return false;
+  }
+
+  index.resize(footer.chunkCount);
+  memcpy(index.data(), data + footer.indexOffset,
+         index.size() * sizeof(TraceIndexEntry));
+  streams.resize(footer.streamCount);
+  for (size_t i = 0; i < index.size(); i++) {
+    const TraceIndexEntry & entry = index[i];
+    TraceChunkHeader chunk;
+    if (entry.stream >= streams.size() ||
+        entry.offset + sizeof(chunk) + entry.size > footer.sitesOffset) {
+      error = "corrupt trace index";
+      return false;
+    }
+    memcpy(&chunk, data + entry.offset, sizeof(chunk));
+    if (chunk.stream != entry.stream || chunk.size != entry.size) {
+      error = "corrupt trace index";
+      return false;
+    }
+    streams[entry.stream].chunks.push_back(i);
+  }
+  return true;
+}
+
+bool TraceReader::registerSites(std::string & error) {
+  const uint8_t * in = data + footer.sitesOffset;
+  const uint8_t * end = in + footer.sitesSize;
+  bool valid = true;
+  auto getNumber = [&]() -> uint64_t {
+    uint64_t v = 0;
+    if (valid && !(in = getVarint(in, end, v))) valid = false;
+    return v;
+  };
+  auto getString = [&]() -> const char * {
+    uint64_t length = getNumber();
+    if (!valid || length > (uint64_t)(end - in)) {
+      valid = false;
+      return "";
+    }
+    strings.push_back(std::string((const char *)in, length));
+    in += length;
+    return strings.back().c_str();
+  };
+
+  uint64_t modules = getNumber();
+  for (uint64_t m = 0; valid && m < modules; m++) {
+    uint64_t base = getNumber();
+    uint64_t count = getNumber();
+    if (!valid || count > (uint64_t)(end - in)) break;
+
+    sites.push_back(std::vector<SourceSite>(count));
+    std::vector<SourceSite> & table = sites.back();
+    for (uint64_t i = 0; valid && i < count; i++) {
+      table[i].file = getString();
+      table[i].function = getString();
+      table[i].line = getNumber();
+      table[i].column = getNumber();
+    }
+    if (!valid) break;
+
+    if (SiteTable::instance().registerModule(table.data(), count) != base) {
+      error = "source sites of the trace do not get their recorded ids";
+      return false;
+    }
+  }
+  if (!valid) {
+    error = "corrupt source sites in trace";
+    return false;
+  }
+  return true;
+}
+
+bool TraceReader::decode(Cursor & cursor, std::string & error) {
+  while (true) {
+    while (cursor.pos == cursor.end) {
+      if (cursor.next == cursor.chunks.size()) return false;
+      const TraceIndexEntry & entry = index[cursor.chunks[cursor.next++]];
+      cursor.pos = data + entry.offset + sizeof(TraceChunkHeader);
+      cursor.end = cursor.pos + entry.size;
+      cursor.lastSeq = 0;
+      cursor.lastTask = 0;
+      cursor.lastSite = 0;
+      cursor.lastAddress = 0;
+    }
+
+    bool valid = true;
+    auto getNumber = [&]() -> uint64_t {
+      uint64_t v = 0;
+      if (valid && !(cursor.pos = getVarint(cursor.pos, cursor.end, v))) {
+        valid = false;
+      }
+      return v;
+    };
+    auto getTask = [&]() -> int {
+      cursor.lastTask += unzigzag(getNumber());
+      return (int)cursor.lastTask;
+    };
+
+    uint8_t tag = *cursor.pos++;
+    uint8_t kind = tag & TRACE_TAG_MASK;
+    cursor.tag = kind;
+    switch (kind) {
+      case TRACE_READ:
+      case TRACE_WRITE: {
+        AccessRecord & access = cursor.access;
+        if (!(tag & TRACE_SAME_TASK)) getTask();
+        if (!(tag & TRACE_SAME_SITE)) {
+          cursor.lastSite += unzigzag(getNumber());
+        }
+        cursor.lastAddress += unzigzag(getNumber());
+        access.accessing_task_id = cursor.lastTask;
+        access.source_site_id = cursor.lastSite;
+        access.destination_address =
+            reinterpret_cast<ADDRESS>(cursor.lastAddress);
+        access.is_write_action = (kind == TRACE_WRITE);
+        access.range_size = 0;
+        access.range_width = 0;
+        access.value_written = 0;
+        if (tag & TRACE_RANGE) {
+          access.range_size = getNumber();
+          access.range_width = getNumber();
+          if (access.range_width) access.range_stride = getNumber();
+        } else if (access.is_write_action) {
+          access.value_written = unzigzag(getNumber());
+        }
+        cursor.seq = cursor.batchSeq;
+        break;
+      }
+      case TRACE_BATCH:
+        cursor.lastSeq += getNumber();
+        cursor.batchSeq = cursor.lastSeq;
+        if (!valid) break;
+        continue;  // not replayed itself
+      case TRACE_TASK_CREATE:
+      case TRACE_END:
+      case TRACE_KEEP:
+        cursor.lastSeq += getNumber();
+        cursor.seq = cursor.lastSeq;
+        cursor.first = getTask();
+        break;
+      case TRACE_EDGE:
+      case TRACE_SPAWN:
+      case TRACE_CONTINUE:
+        cursor.lastSeq += getNumber();
+        cursor.seq = cursor.lastSeq;
+        cursor.first = getTask();
+        cursor.second = getTask();
+        break;
+      case TRACE_SYNC: {
+        cursor.lastSeq += getNumber();
+        cursor.seq = cursor.lastSeq;
+        cursor.first = getTask();
+        cursor.second = getTask();
+        uint64_t count = getNumber();
+        if (count > (uint64_t)(cursor.end - cursor.pos)) valid = false;
+        cursor.childIDs.clear();
+        for (uint64_t i = 0; valid && i < count; i++) {
+          cursor.childIDs.push_back(getTask());
+        }
+        break;
+      }
+      default:
+        valid = false;
+    }
+    if (!valid) {
+      error = "corrupt trace chunk";
+      return false;
+    }
+    return true;
+  }
+}
+
+VOID TraceReader::applyEvent(EventSink & sink, const Cursor & cursor) {
+  switch (cursor.tag) {
+    case TRACE_TASK_CREATE:
+      sink.onTaskCreate(cursor.first);
+      break;
+    case TRACE_EDGE:
+      sink.saveHappensBeforeEdge(cursor.first, cursor.second);
+      break;
+    case TRACE_SPAWN:
+      sink.onTaskSpawn(cursor.first, cursor.second);
+      break;
+    case TRACE_CONTINUE:
+      sink.onTaskContinue(cursor.first, cursor.second);
+      break;
+    case TRACE_SYNC:
+      sink.onTaskSync(cursor.first, cursor.second, cursor.childIDs);
+      break;
+    case TRACE_END:
+      sink.onTaskEnd(cursor.first);
+      break;
+    case TRACE_KEEP:
+      sink.keepTask(cursor.first);
+      break;
+  }
+}
+
+bool TraceReader::replay(EventSink & sink, std::string & error) {
+  std::vector<AccessRecord> pending;
+  pending.reserve(TRACE_REPLAY_BATCH);
+  auto flush = [&]() {
+    if (pending.empty()) return;
+    sink.saveMemoryAccesses(pending.data(), pending.size());
+    accesses += pending.size();
+    pending.clear();
+  };
+
+  for (Cursor & cursor : streams) {
+    cursor.next = 0;
+    cursor.pos = cursor.end = NULL;
+    cursor.batchSeq = 0;
+    cursor.hasItem = decode(cursor, error);
+    if (!error.empty()) return false;
+  }
+
+  uint64_t applied = 0;
+  while (true) {
+    bool progress = false, remaining = false;
+    for (Cursor & cursor : streams) {
+      while (cursor.hasItem) {
+        if (cursor.tag == TRACE_READ || cursor.tag == TRACE_WRITE) {
+          if (cursor.seq > applied) break;  // edges not replayed yet
+          pending.push_back(cursor.access);
+          if (pending.size() == TRACE_REPLAY_BATCH) flush();
+        } else {
+          if (cursor.seq != applied) break;  // earlier events first
+          flush();
+          applyEvent(sink, cursor);
+          applied++;
+          events++;
+        }
+        progress = true;
+        cursor.hasItem = decode(cursor, error);
+        if (!error.empty()) return false;
+      }
+      remaining |= cursor.hasItem;
+    }
+    if (!remaining) break;
+    if (!progress) {
+      error = "trace misses event " + std::to_string(applied);
+      return false;
+    }
+  }
+  flush();
+  return true;
+}
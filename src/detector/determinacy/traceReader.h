@@ -0,0 +1,97 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// Defines the TraceReader class. It maps a trace written by the
+// TraceWriter and replays its events into an EventSink. The
+// streams of the recording threads are merged by event number:
+// an event is replayed once all events before it are, and a batch
+// of accesses once the events posted before it are. This keeps
+// every access after the edges that ordered it in the recording.
+
+#ifndef _DETECTOR_DETERMINACY_TRACEREADER_H_
+#define _DETECTOR_DETERMINACY_TRACEREADER_H_
+
+#include "common/defs.h"
+#include "common/AccessRecord.h"
+#include "common/SiteTable.h"
+#include "detector/determinacy/eventSink.h"
+#include "detector/determinacy/traceFormat.h"
+#include <deque>
+#include <string>
+#include <vector>
+
+// accesses handed to the sink at once
+#define TRACE_REPLAY_BATCH 1024
+
+class TraceReader {
+  public:
+    TraceReader();
+    ~TraceReader();
+
+    // Maps the trace and checks its header, footer and index
+    bool open(const char * path, std::string & error);
+
+    // Registers the recorded source sites in the SiteTable. They
+    // get their recorded ids only if no module registered before.
+    bool registerSites(std::string & error);
+
+    // Replays all events of the trace into sink
+    bool replay(EventSink & sink, std::string & error);
+
+    size_t getStreamCount() const { return streams.size(); }
+    size_t getChunkCount() const { return index.size(); }
+    uint64_t getEventCount() const { return events; }
+    uint64_t getAccessCount() const { return accesses; }
+    uint64_t getSize() const { return size; }
+
+  private:
+    // position of the replay in the chunks of one stream
+    typedef struct Cursor {
+      std::vector<size_t> chunks;  // into index
+      size_t next;          // chunk to decode after the current
+      const uint8_t * pos;
+      const uint8_t * end;
+
+      uint64_t lastSeq;
+      int64_t lastTask;
+      int64_t lastSite;
+      uint64_t lastAddress;
+      uint64_t batchSeq;
+
+      bool hasItem;         // item below is decoded, not replayed
+      uint8_t tag;
+      uint64_t seq;
+      int first;
+      int second;
+      std::vector<int> childIDs;
+      AccessRecord access;
+    } Cursor;
+
+    // Decodes the next item of a stream; false at its end
+    bool decode(Cursor & cursor, std::string & error);
+
+    VOID applyEvent(EventSink & sink, const Cursor & cursor);
+
+    const uint8_t * data;
+    uint64_t size;
+    TraceFileFooter footer;
+    std::vector<TraceIndexEntry> index;
+    std::vector<Cursor> streams;
+    uint64_t events;
+    uint64_t accesses;
+
+    // recorded sites, kept alive for the SiteTable
+    std::deque<std::string> strings;
+    std::deque<std::vector<SourceSite>> sites;
+};
+
+#endif // end traceReader.h
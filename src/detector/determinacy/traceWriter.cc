@@ -0,0 +1,293 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// this file implements the trace writer of record mode.
+#include "detector/determinacy/traceWriter.h"
+#include "common/SiteTable.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+static std::atomic<uint64_t> nextWriterID(1);
+
+// stream of the calling thread and the writer it belongs to
+static thread_local uint64_t localOwner = 0;
+static thread_local TraceStream * localStream = NULL;
+
+TraceWriter::TraceWriter(const char * path, size_t chunkSize):
+  offset(0), chunkSize(chunkSize), id(nextWriterID++), postedEvents(0) {
+  fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    std::cerr << "TaskSanitizer: cannot open trace " << path << ": "
+              << strerror(errno) << std::endl;
+    return;
+  }
+
+  TraceFileHeader header;
+  memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+  header.version = TRACE_VERSION;
+  header.reserved = 0;
+  writeBytes(&header, sizeof(header));
+}
+
+TraceWriter::~TraceWriter() {
+  close();
+  for (TraceStream * stream : streams) {
+    delete stream;
+  }
+}
+
+const char * TraceWriter::getPathFromEnv() {
+  const char * path = getenv("TASKSAN_RECORD");
+  return (path && *path) ? path : NULL;
+}
+
+TraceStream & TraceWriter::getStream() {
+  if (localOwner == id) return *localStream;
+
+  std::lock_guard<std::mutex> guard(streamsLock);
+  localStream = new TraceStream();
+  localStream->id = streams.size();
+  localStream->buffer.resize(chunkSize + TRACE_MAX_ITEM_SIZE);
+  localStream->inBatch = false;
+  localStream->batchSeq = 0;
+  resetChunk(*localStream);
+  localOwner = id;
+  streams.push_back(localStream);
+  return *localStream;
+}
+
+VOID TraceWriter::resetChunk(TraceStream & stream) {
+  stream.used = 0;
+  stream.lastSeq = 0;
+  stream.lastTask = 0;
+  stream.lastSite = 0;
+  stream.lastAddress = 0;
+}
+
+uint8_t * TraceWriter::reserve(TraceStream & stream, size_t bytes) {
+  if (stream.used + bytes > chunkSize && stream.used > 0) {
+    flushChunk(stream);
+
+    // the accesses that follow still belong to the batch
+    if (stream.inBatch) {
+      uint8_t * out = &stream.buffer[0];
+      *out++ = TRACE_BATCH;
+      out = putVarint(out, stream.batchSeq);
+      stream.lastSeq = stream.batchSeq;
+      stream.used = out - &stream.buffer[0];
+    }
+  }
+  if (stream.used + bytes > stream.buffer.size()) {
+    stream.buffer.resize(stream.used + bytes);
+  }
+  return &stream.buffer[stream.used];
+}
+
+VOID TraceWriter::flushChunk(TraceStream & stream) {
+  if (!stream.used) return;
+
+  std::lock_guard<std::mutex> guard(fileLock);
+  TraceIndexEntry entry;
+  entry.offset = offset;
+  entry.stream = stream.id;
+  entry.size = stream.used;
+  index.push_back(entry);
+
+  TraceChunkHeader header;
+  header.stream = stream.id;
+  header.size = stream.used;
+  writeBytes(&header, sizeof(header));
+  writeBytes(&stream.buffer[0], stream.used);
+  resetChunk(stream);
+}
+
+VOID TraceWriter::writeBytes(const VOID * data, size_t bytes) {
+  const char * next = static_cast<const char *>(data);
+  offset += bytes;
+  while (bytes && fd >= 0) {
+    ssize_t written = ::write(fd, next, bytes);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      std::cerr << "TaskSanitizer: cannot write trace: "
+                << strerror(errno) << std::endl;
+      ::close(fd);
+      fd = -1;
+      return;
+    }
+    next += written;
+    bytes -= written;
+  }
+}
+
+uint8_t * TraceWriter::putTask(TraceStream & stream, uint8_t * out,
+                               int taskID) {
+  out = putVarint(out, zigzag(taskID - stream.lastTask));
+  stream.lastTask = taskID;
+  return out;
+}
+
+VOID TraceWriter::writeEvent(uint8_t tag, int first, int second,
+                             const std::vector<int> * childIDs) {
+  TraceStream & stream = getStream();
+  size_t children = childIDs ? childIDs->size() : 0;
+  uint8_t * start = reserve(stream, TRACE_MAX_ITEM_SIZE + 10 * children);
+  uint8_t * out = start;
+
+  uint64_t seq = postedEvents.fetch_add(1);
+  *out++ = tag;
+  out = putVarint(out, seq - stream.lastSeq);
+  stream.lastSeq = seq;
+  out = putTask(stream, out, first);
+  if (tag != TRACE_TASK_CREATE && tag != TRACE_END && tag != TRACE_KEEP) {
+    out = putTask(stream, out, second);
+  }
+  if (tag == TRACE_SYNC) {
+    out = putVarint(out, children);
+    for (int childID : *childIDs) out = putTask(stream, out, childID);
+  }
+  stream.used += out - start;
+  stream.inBatch = false;
+}
+
+VOID TraceWriter::saveMemoryAccesses(const AccessRecord * accesses,
+                                     size_t count) {
+  if (!count) return;
+  TraceStream & stream = getStream();
+
+  uint8_t * out = reserve(stream, TRACE_MAX_ITEM_SIZE);
+  uint8_t * start = out;
+  stream.batchSeq = postedEvents.load(std::memory_order_acquire);
+  stream.inBatch = true;
+  *out++ = TRACE_BATCH;
+  out = putVarint(out, stream.batchSeq - stream.lastSeq);
+  stream.lastSeq = stream.batchSeq;
+  stream.used += out - start;
+
+  for (size_t i = 0; i < count; i++) {
+    const AccessRecord & access = accesses[i];
+    start = out = reserve(stream, TRACE_MAX_ITEM_SIZE);
+
+    uint8_t tag = access.is_write_action ? TRACE_WRITE : TRACE_READ;
+    bool sameTask = access.accessing_task_id == stream.lastTask;
+    bool sameSite = access.source_site_id == stream.lastSite;
+    if (sameTask) tag |= TRACE_SAME_TASK;
+    if (sameSite) tag |= TRACE_SAME_SITE;
+    if (access.range_size) tag |= TRACE_RANGE;
+    *out++ = tag;
+
+    if (!sameTask) {
+      out = putVarint(out, zigzag(access.accessing_task_id - stream.lastTask));
+      stream.lastTask = access.accessing_task_id;
+    }
+    if (!sameSite) {
+      out = putVarint(out, zigzag(access.source_site_id - stream.lastSite));
+      stream.lastSite = access.source_site_id;
+    }
+    uint64_t address = reinterpret_cast<uint64_t>(access.destination_address);
+    out = putVarint(out, zigzag((int64_t)(address - stream.lastAddress)));
+    stream.lastAddress = address;
+    if (access.range_size) {
+      out = putVarint(out, access.range_size);
+      out = putVarint(out, access.range_width);
+      if (access.range_width) out = putVarint(out, access.range_stride);
+    } else if (access.is_write_action) {
+      out = putVarint(out, zigzag(access.value_written));
+    }
+    stream.used += out - start;
+  }
+}
+
+VOID TraceWriter::onTaskCreate(int taskID) {
+  writeEvent(TRACE_TASK_CREATE, taskID, 0);
+}
+
+VOID TraceWriter::saveHappensBeforeEdge(int parentID, int childID) {
+  writeEvent(TRACE_EDGE, parentID, childID);
+}
+
+VOID TraceWriter::onTaskSpawn(int parentID, int childID) {
+  writeEvent(TRACE_SPAWN, parentID, childID);
+}
+
+VOID TraceWriter::onTaskContinue(int prevID, int nextID) {
+  writeEvent(TRACE_CONTINUE, prevID, nextID);
+}
+
+VOID TraceWriter::onTaskSync(int prevID, int nextID,
+                             const std::vector<int> & childIDs) {
+  writeEvent(TRACE_SYNC, prevID, nextID, &childIDs);
+}
+
+VOID TraceWriter::onTaskEnd(int taskID) {
+  writeEvent(TRACE_END, taskID, 0);
+}
+
+VOID TraceWriter::keepTask(int taskID) {
+  writeEvent(TRACE_KEEP, taskID, 0);
+}
+
+// module count, then per module its base, site count and sites
+VOID TraceWriter::writeSites() {
+  std::vector<uint8_t> sites;
+  uint8_t number[10];
+  auto putNumber = [&](uint64_t v) {
+    sites.insert(sites.end(), number, putVarint(number, v));
+  };
+  auto putString = [&](const char * text) {
+    size_t length = text ? strlen(text) : 0;
+    putNumber(length);
+    sites.insert(sites.end(), text, text + length);
+  };
+
+  size_t modules = 0;
+  SiteTable::instance().forEachModule(
+      [&](uint32_t, const SourceSite *, uint32_t) { modules++; });
+  putNumber(modules);
+  SiteTable::instance().forEachModule(
+      [&](uint32_t base, const SourceSite * table, uint32_t count) {
+    putNumber(base);
+    putNumber(count);
+    for (uint32_t i = 0; i < count; i++) {
+      putString(table[i].file);
+      putString(table[i].function);
+      putNumber(table[i].line);
+      putNumber(table[i].column);
+    }
+  });
+  writeBytes(sites.data(), sites.size());
+}
+
+VOID TraceWriter::close() {
+  if (fd < 0) return;
+  for (TraceStream * stream : streams) {
+    flushChunk(*stream);
+  }
+
+  std::lock_guard<std::mutex> guard(fileLock);
+  TraceFileFooter footer;
+  memset(&footer, 0, sizeof(footer));
+  footer.sitesOffset = offset;
+  writeSites();
+  footer.sitesSize = offset - footer.sitesOffset;
+  footer.indexOffset = offset;
+  writeBytes(index.data(), index.size() * sizeof(TraceIndexEntry));
+  footer.chunkCount = index.size();
+  footer.streamCount = streams.size();
+  memcpy(footer.magic, TRACE_MAGIC, sizeof(footer.magic));
+  writeBytes(&footer, sizeof(footer));
+
+  if (fd >= 0) ::close(fd);
+  fd = -1;
+}
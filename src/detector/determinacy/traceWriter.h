@@ -0,0 +1,108 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// Defines the TraceWriter class of record mode. Instead of
+// checking events it encodes them into the binary trace described
+// in traceFormat.h. Each application thread fills its own chunk
+// buffer without locking; a full chunk is appended to the file
+// with one write under the file lock. Closing the trace writes
+// the buffered chunks, the source sites and the chunk index.
+//
+// Enabled by setting TASKSAN_RECORD to the path of the trace. The
+// trace is analyzed later by tasksan-analyze.
+
+#ifndef _DETECTOR_DETERMINACY_TRACEWRITER_H_
+#define _DETECTOR_DETERMINACY_TRACEWRITER_H_
+
+#include "common/defs.h"
+#include "common/AccessRecord.h"
+#include "detector/determinacy/eventSink.h"
+#include "detector/determinacy/traceFormat.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+// chunk being filled by one application thread
+typedef struct TraceStream {
+  uint32_t id;
+  std::vector<uint8_t> buffer;
+  size_t used;
+
+  // previous values of the chunk, reset for every chunk
+  uint64_t lastSeq;
+  int64_t lastTask;
+  int64_t lastSite;
+  uint64_t lastAddress;
+
+  bool inBatch;        // accesses follow a batch item
+  uint64_t batchSeq;   // events posted before the batch
+} TraceStream;
+
+class TraceWriter : public EventSink {
+  public:
+    TraceWriter(const char * path, size_t chunkSize = TRACE_CHUNK_SIZE);
+    ~TraceWriter();
+
+    // Returns the trace path of TASKSAN_RECORD, NULL when not set
+    static const char * getPathFromEnv();
+
+    bool isOpen() const { return fd >= 0; }
+
+    VOID saveMemoryAccesses(const AccessRecord * accesses, size_t count);
+    VOID onTaskCreate(int taskID);
+    VOID saveHappensBeforeEdge(int parentID, int childID);
+    VOID onTaskSpawn(int parentID, int childID);
+    VOID onTaskContinue(int prevID, int nextID);
+    VOID onTaskSync(int prevID, int nextID,
+                    const std::vector<int> & childIDs);
+    VOID onTaskEnd(int taskID);
+    VOID keepTask(int taskID);
+
+    // Writes the buffered chunks, the sites and the index, and
+    // closes the file. Application threads must not post anymore.
+    VOID close();
+
+    // bytes written to the file so far
+    uint64_t size() const { return offset; }
+
+  private:
+    // Returns the stream of the calling thread
+    TraceStream & getStream();
+
+    // Returns room for bytes more in the chunk of stream,
+    // appending the chunk to the file first if it is full
+    uint8_t * reserve(TraceStream & stream, size_t bytes);
+    VOID flushChunk(TraceStream & stream);
+    VOID resetChunk(TraceStream & stream);
+
+    VOID writeEvent(uint8_t tag, int first, int second,
+                    const std::vector<int> * childIDs = NULL);
+    uint8_t * putTask(TraceStream & stream, uint8_t * out, int taskID);
+    VOID writeSites();
+
+    // Appends bytes to the file. Caller holds fileLock.
+    VOID writeBytes(const VOID * data, size_t bytes);
+
+    int fd;
+    uint64_t offset;
+    size_t chunkSize;
+    uint64_t id;  // tells streams of different writers apart
+    std::mutex fileLock;
+    std::vector<TraceIndexEntry> index;
+
+    std::mutex streamsLock;
+    std::vector<TraceStream *> streams;
+
+    std::atomic<uint64_t> postedEvents;
+};
+
+#endif // end traceWriter.h
@@ -0,0 +1,129 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// this file implements the vector-clock happens-before engine.
+#include "detector/determinacy/vectorClockEngine.h"  // header
+#include <cassert>
+
+VectorClockEngine::VectorClockEngine(): knownTasks(0) {
+  strandTails.push_back(-1);
+}
+
+TaskClock & VectorClockEngine::getTask(int taskID) {
+  assert(taskID >= 0);
+  if ((size_t)taskID >= tasks.size()) {
+    tasks.resize(std::max((size_t)taskID + 1, 2 * tasks.size()));
+  }
+  TaskClock & task = tasks[taskID];
+  if (!task.known) {
+    task.known = true;
+    knownTasks++;
+  }
+  return task;
+}
+
+VOID VectorClockEngine::startStrand(int taskID, TaskClock & task) {
+  task.strand = strandTails.size();
+  task.position = 1;
+  strandTails.push_back(taskID);
+}
+
+VOID VectorClockEngine::join(TaskClock & child, const TaskClock & parent) {
+  if (!child.clock && parent.strand == child.strand) {
+    child.clock = parent.clock;  // a continuation sees what its parent saw
+    return;
+  }
+
+  // entries of both clocks and the parent's position, of which
+  // the larger position per strand is kept
+  StrandPositions entries;
+  if (child.clock) entries = *child.clock;
+  if (parent.clock) {
+    entries.insert(entries.end(), parent.clock->begin(), parent.clock->end());
+  }
+  entries.push_back(std::make_pair(parent.strand, parent.position));
+  std::sort(entries.begin(), entries.end());
+
+  StrandPositions * merged = new StrandPositions();
+  merged->reserve(entries.size());
+  for (auto & entry : entries) {
+    if (entry.first == child.strand) continue;
+    if (!merged->empty() && merged->back().first == entry.first) {
+      merged->back().second = entry.second;  // sorted, so not smaller
+    } else {
+      merged->push_back(entry);
+    }
+  }
+  child.clock.reset(merged);
+}
+
+// Executed when a new task is created. The task is put on a
+// strand by its first incoming edge, so that it can continue
+// the strand of its parent.
+VOID VectorClockEngine::onTaskCreate(int taskID) {
+  getTask(taskID);
+}
+
+// Saves the edge parentID ---happens-before---> childID
+VOID VectorClockEngine::saveHappensBeforeEdge(int parentID, int childID) {
+  getTask(childID);
+  TaskClock & parent = getTask(parentID); // may move tasks
+  TaskClock & child = tasks[childID];
+
+  if (!parent.strand) {
+    startStrand(parentID, parent);
+  }
+  if (!child.strand) {
+    if (strandTails[parent.strand] == parentID) {
+      // the child continues the strand of its parent
+      child.strand = parent.strand;
+      child.position = parent.position + 1;
+      strandTails[child.strand] = childID;
+    } else {
+      startStrand(childID, child);
+    }
+  }
+  join(child, parent);
+}
+
+const VOID * VectorClockEngine::getTaskView(int taskID) {
+  if (taskID < 0 || (size_t)taskID >= tasks.size()) return NULL;
+  const TaskClock & task = tasks[taskID];
+  return task.known ? &task : NULL;
+}
+
+bool VectorClockEngine::happensBefore(const VOID * view,
+                                      int prevTaskID) const {
+  if (!view || prevTaskID < 0 || (size_t)prevTaskID >= tasks.size()) {
+    return false;
+  }
+  const TaskClock * task = static_cast<const TaskClock *>(view);
+  const TaskClock & prev = tasks[prevTaskID];
+  if (&prev == task) return false; // as in serial bags
+
+  return prev.strand && task->at(prev.strand) >= prev.position;
+}
+
+VOID VectorClockEngine::print(std::ostream & os) {
+  for (size_t id = 0; id < tasks.size(); id++) {
+    const TaskClock & task = tasks[id];
+    if (!task.known) continue;
+
+    os << id << " (" << task.strand << ":" << task.position << "): {";
+    if (task.clock) {
+      for (auto & entry : *task.clock) {
+        os << entry.first << ":" << entry.second << " ";
+      }
+    }
+    os << "}" << std::endl;
+  }
+}
@@ -0,0 +1,93 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// Defines the vector-clock happens-before engine. The task graph
+// is split into strands, chains of tasks where each task is the
+// first successor of the one before it. A task is identified by
+// its strand and its position on the strand, and its clock holds,
+// per strand, the last position ordered before or at the task:
+//
+//   prev happens before cur  <=>  cur.clock[prev.strand] >= prev.position
+//
+// An edge joins the parent clock into the child by element-wise
+// max, and the check is a binary search in the child's clock.
+//
+// Clocks are sparse: they list only the strands ordered before
+// the task, so a spawn copies the strands of the ancestors, not one
+// entry per strand of the program. The own strand of a task is
+// kept in its position, which lets a task that continues the
+// strand of its parent share the parent's clock without a copy.
+
+#ifndef _DETECTOR_DETERMINACY_VECTORCLOCKENGINE_H_
+#define _DETECTOR_DETERMINACY_VECTORCLOCKENGINE_H_
+
+#include "detector/determinacy/hbEngine.h"
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// (strand, position) entries of a clock, sorted by strand
+typedef std::vector<std::pair<uint32_t, uint32_t>> StrandPositions;
+
+// clock and strand position of a task
+typedef struct TaskClock {
+  bool     known;
+  uint32_t strand;    // 0 until the task is put on a strand
+  uint32_t position;
+  // the other strands, shared by tasks with the same entries
+  std::shared_ptr<const StrandPositions> clock;
+
+  TaskClock(): known(false), strand(0), position(0) {}
+
+  // Returns the last position of a strand ordered before or at
+  // the task, 0 if none
+  uint32_t at(uint32_t s) const {
+    if (s == strand) return position;
+    if (!clock) return 0;
+    auto it = std::lower_bound(clock->begin(), clock->end(),
+                               std::make_pair(s, 0u));
+    return (it != clock->end() && it->first == s) ? it->second : 0;
+  }
+} TaskClock;
+
+class VectorClockEngine : public HBEngine {
+  public:
+    VectorClockEngine();
+    VOID onTaskCreate(int taskID);
+    VOID saveHappensBeforeEdge(int parentID, int childID);
+    const VOID * getTaskView(int taskID);
+    bool happensBefore(const VOID * view, int prevTaskID) const;
+    size_t taskCount() { return knownTasks; }
+    const char * getName() { return "vector-clock"; }
+    VOID print(std::ostream & os);
+
+  private:
+    // Returns the clock of a task, creating it if new
+    TaskClock & getTask(int taskID);
+
+    // Puts a task at the end of a new strand
+    VOID startStrand(int taskID, TaskClock & task);
+
+    // Joins the clock of parent and its own position into child
+    static VOID join(TaskClock & child, const TaskClock & parent);
+
+    // task IDs are dense, so clocks are indexed by task ID
+    std::vector<TaskClock> tasks;
+    size_t knownTasks;
+
+    // last task of each strand, strand 0 is unused
+    std::vector<int> strandTails;
+};
+
+#endif // end vectorClockEngine.h
@@ -13,24 +13,88 @@
 //////////////////////////////////////////////////////////////
 //
 //  This implements a class which manages a stack of function calls
-//  as performed by a task
+//  as performed by a task. Each frame is the site id of the called
+//  function (see common/SiteTable.h), so pushing and popping a
+//  frame costs a store and an increment. Frames deeper than
+//  CALLSTACK_CAPACITY are counted but not kept.
+//
+//  The stack also remembers the frames it had when it was last
+//  saved in the stack depot (see FunctionEngine.h), so that the
+//  accesses under an unchanged stack reuse its id, and those after
+//  returning to it compare the frames instead of locking the depot.
 //
 
 #ifndef _FUNCTIONENGINE_CALLSTACK_H_
 #define _FUNCTIONENGINE_CALLSTACK_H_
 
-#include <stack>
-#include <string>
+#include <algorithm>
+#include <cstdint>
+
+// frames kept per task
+#define CALLSTACK_CAPACITY 32
 
 class CallStack {
+  public:
+    // Pushes the frame of a function entered by the task
+    inline void push(uint32_t siteID) {
+      if (depth < CALLSTACK_CAPACITY) frames[depth] = siteID;
+      depth++;
+      changed = true;
+    }
+
+    // Pops the frame of a function the task returns from
+    inline void pop() {
+      if (depth) depth--;
+      changed = true;
+    }
+
+    // Number of frames kept
+    inline uint32_t size() const {
+      return depth < CALLSTACK_CAPACITY ? depth : CALLSTACK_CAPACITY;
+    }
+
+    // Frames from the outermost, size() of them
+    inline const uint32_t * getFrames() const { return frames; }
+
+    // Hash of the frames kept, 0 for the empty stack
+    uint64_t hash() const {
+      uint64_t value = 0;
+      for (uint32_t i = 0; i < size(); i++) {
+        value = (value ^ ((uint64_t)frames[i] + 1)) * 0x9E3779B97F4A7C15ull;
+      }
+      return value;
+    }
+
+    // Returns true if the frames are those last saved, see setSaved
+    inline bool isSaved() {
+      if (!changed) return true;
+      if (size() != savedSize ||
+          !std::equal(frames, frames + savedSize, savedFrames)) {
+        return false;
+      }
+      changed = false;
+      return true;
+    }
+
+    // Records the id the stack depot gave to the current frames
+    void setSaved(uint32_t stackID) {
+      savedID = stackID;
+      savedSize = size();
+      std::copy(frames, frames + savedSize, savedFrames);
+      changed = false;
+    }
+
+    // Id of the frames last saved, 0 for the empty stack
+    inline uint32_t getSavedID() const { return savedID; }
+
   private:
-    std::stack funcStack;
+    uint32_t depth = 0;
+    uint32_t frames[CALLSTACK_CAPACITY];
 
-  public:
-    void printStack();
-    void getTopUserCode();
-    void pushFunction(std::string name);
-    void popFunction(std::string name);
+    bool     changed = false;  // pushed or popped since setSaved
+    uint32_t savedID = 0;
+    uint32_t savedSize = 0;
+    uint32_t savedFrames[CALLSTACK_CAPACITY];
 };
 
 #endif
@@ -12,21 +12,70 @@
 //
 //////////////////////////////////////////////////////////////
 //
-//  This implements a class for managing function call stacks
-//  of active tasks in the OpenMP tasking application.
+//  This implements the stack depot of the call stacks of tasks.
+//  Each distinct stack is saved once and named by a 32-bit id,
+//  which accesses carry to the checker in place of the stack.
+//  Id 0 is the empty stack. Stacks are decoded only when a
+//  determinacy race is reported.
 //
 
 #ifndef _FUNCTIONENGINE_FUNCTIONENGINE_H_
 #define _FUNCTIONENGINE_FUNCTIONENGINE_H_
 
-#include "function_engine/CallStack.h"
+#include "functionengine/CallStack.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 class FunctionEngine {
   public:
-    void pushFunction(std::string name, unsigned taskID, int source_line_num);
-    void popFunction(std::string name, unsigned taskID);
-    CallStack &getStack(unsigned taskID);
-    void removeStack(unsigned taskID);
+    // The process-wide depot
+    static FunctionEngine & instance() {
+      static FunctionEngine engine;
+      return engine;
+    }
+
+    // Saves the stack, if not saved before, and returns its id.
+    // Stacks are looked up by hash and told apart by their frames.
+    uint32_t saveStack(const CallStack & stack) {
+      if (!stack.size()) return 0;
+      const uint32_t * frames = stack.getFrames();
+      uint64_t hash = stack.hash();
+
+      std::lock_guard<std::mutex> guard(lock);
+      auto range = ids.equal_range(hash);
+      for (auto found = range.first; found != range.second; ++found) {
+        const std::vector<uint32_t> & saved = stacks[found->second];
+        if (saved.size() == stack.size() &&
+            std::equal(saved.begin(), saved.end(), frames)) {
+          return found->second;
+        }
+      }
+
+      stacks.emplace_back(frames, frames + stack.size());
+      uint32_t stackID = stacks.size() - 1;
+      ids.insert(std::make_pair(hash, stackID));
+      return stackID;
+    }
+
+    // Sets frames to those of the stack with the given id, from
+    // the innermost. Returns false if the id is unknown.
+    bool getStack(uint32_t stackID, std::vector<uint32_t> & frames) {
+      std::lock_guard<std::mutex> guard(lock);
+      if (stackID >= stacks.size()) return false;
+      frames.assign(stacks[stackID].rbegin(), stacks[stackID].rend());
+      return true;
+    }
+
+  private:
+    FunctionEngine(): stacks(1) {}
+
+    std::mutex lock;
+    std::unordered_multimap<uint64_t, uint32_t> ids;  // by hash of frames
+    std::vector<std::vector<uint32_t>> stacks;   // by id
 };
 
 #endif
@@ -0,0 +1,140 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// Implements the callbacks of plain reads and writes and of
+// function entry and exit, the hot path of the runtime. Besides
+// being part of libLogger, this file is built as bitcode
+// (libLoggerFast.bc) which tasksan links into programs built with
+// TASKSAN_LTO, so that the task lookup and the filter checks
+// inline into the instrumented code. Buffer drains
+// and sampling adaptation stay out of line in Logger.cc.
+
+#include "instrumentor/callbacks/InstrumentationCallbacks.h"
+#include "instrumentor/callbacks/CurrentTask.h"
+#include "instrumentor/eventlogger/Logger.h"
+#include <cstring>
+
+// Callbacks for load operations
+inline void INS_MemRead(
+    address addr,
+    ulong /* size */,
+    int site_id) {
+
+  TaskInfo * taskInfo = getTaskInfo();
+  //lint value = getMemoryValue( addr, size );
+
+  if ( taskInfo && taskInfo->active ) {
+    INS::Read(*taskInfo, addr, site_id);
+#ifdef DEBUG
+    std::stringstream ss;
+    ss << std::hex << addr;
+    PRINT_DEBUG("READ: addr: " + ss.str() +
+        " taskID: " + std::to_string(taskInfo->taskID) +
+        " site id: " + std::to_string(site_id));
+#endif
+  }
+}
+
+// Callbacks for store operations
+inline void INS_MemWrite(
+    address addr,
+    lint value,
+    int site_id) {
+
+  TaskInfo * taskInfo = getTaskInfo();
+
+  if ( taskInfo && taskInfo->active ) {
+    INS::Write(*taskInfo, addr, (lint)value, site_id);
+#ifdef DEBUG
+    std::stringstream ss;
+    ss << std::hex << addr;
+    PRINT_DEBUG("= WRITE: addr: " + ss.str() +
+        ", value: " + std::to_string((lint)value) +
+        ", taskID: " + std::to_string(taskInfo->taskID) +
+        ", site id: " + std::to_string(site_id));
+#endif
+  }
+}
+
+// A callback for memory writes of floats
+void __tasksan_write_float(address addr, float value, int site_id) {
+  uint32_t bits;  // compared by bits, as in batched writes
+  memcpy(&bits, &value, sizeof(bits));
+  INS_MemWrite(addr, (lint)bits, site_id);
+}
+
+// A callback for memory writes of doubles
+void __tasksan_write_double(address addr, double value, int site_id) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  INS_MemWrite(addr, (lint)bits, site_id);
+}
+
+void __tasksan_read1(void *addr, int site_id) {
+  INS_MemRead(addr, 1, site_id);
+}
+void __tasksan_read2(void *addr, int site_id) {
+  INS_MemRead(addr, 2, site_id);
+}
+
+void __tasksan_read4(void *addr, int site_id) {
+  INS_MemRead(addr, 4, site_id);
+}
+
+void __tasksan_read8(void *addr, int site_id) {
+  INS_MemRead( addr, 8, site_id );
+}
+
+void __tasksan_read16(void *addr, int site_id) {
+  INS_MemRead( addr, 16, site_id );
+}
+
+void __tasksan_write1(void *addr, lint value, int site_id) {
+  INS_MemWrite((address)addr, value, site_id);
+}
+
+void __tasksan_write2(void *addr, lint value, int site_id) {
+  INS_MemWrite((address)addr, value, site_id);
+}
+
+void __tasksan_write4(void *addr, lint value, int site_id) {
+  INS_MemWrite((address)addr, value, site_id);
+}
+
+void __tasksan_write8(void *addr, lint value, int site_id) {
+  INS_MemWrite((address)addr, value, site_id);
+}
+
+void __tasksan_write16(void *addr, lint value, int site_id) {
+  INS_MemWrite((address)addr, value, site_id);
+}
+
+// A callback for the accesses of straight-line code, see
+// common/AccessBatch.h
+void __tasksan_access_batch(void *accesses, unsigned count) {
+  TaskInfo * taskInfo = getTaskInfo();
+  if ( taskInfo && taskInfo->active ) {
+    INS::AccessBatch(*taskInfo, (const BatchedAccess *)accesses, count);
+  }
+}
+
+// Callbacks of function entry and exit in task code, which keep
+// the call stack of the task (see functionengine/CallStack.h)
+void __tasksan_func_entry(int site_id) {
+  TaskInfo * taskInfo = getTaskInfo();
+  if ( taskInfo ) taskInfo->callStack.push(site_id);
+}
+
+void __tasksan_func_exit() {
+  TaskInfo * taskInfo = getTaskInfo();
+  if ( taskInfo ) taskInfo->callStack.pop();
+}
@@ -0,0 +1,39 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// Looks up the task executing on the calling thread. The OMPT
+// callbacks keep currentTaskData up to date (see setCurrentTask
+// in OMPTCallbacks.h) and every access callback reads it.
+
+#ifndef _INSTRUMENTOR_CALLBACKS_CURRENTTASK_H_
+#define _INSTRUMENTOR_CALLBACKS_CURRENTTASK_H_
+
+#include "instrumentor/eventlogger/TaskInfo.h"
+#include <ompt.h>
+
+// OMPT data of the task currently executing on this thread.
+// The data object stays the same for the whole life of a task,
+// while its ptr is replaced with a new TaskInfo at every new
+// task segment, so the object rather than the TaskInfo is cached.
+extern thread_local ompt_data_t * currentTaskData;
+
+// Returns the metadata of the task executing on this thread
+static inline TaskInfo * getTaskInfo() {
+  ompt_data_t * task_data = currentTaskData;
+  if (task_data) {
+    return (TaskInfo*)task_data->ptr;
+  } else {
+    return NULL;
+  }
+}
+
+#endif // CurrentTask.h
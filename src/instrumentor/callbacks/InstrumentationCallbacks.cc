@@ -18,6 +18,7 @@
 #include <stdlib.h>
 #include "instrumentor/callbacks/OMPTCallbacks.h"
 #include "instrumentor/callbacks/InstrumentationCallbacks.h"
+#include "instrumentor/callbacks/CurrentTask.h"
 
 lint getMemoryValue( address addr, ulong size ) {
   if ( size == sizeof(char)   ) return *(static_cast<char *>(addr));
@@ -39,147 +40,19 @@ void __tasksan_init() {
   PRINT_DEBUG("TaskSanitizer: init");
 }
 
-//////////////////////////////////////////////////
-static TaskInfo * getTaskInfo(int * _type = NULL) {
-
-  if (!INS::isOMPTinitialized) return NULL;
-
-  int ancestor_level = 0;
-  int type;
-  ompt_data_t *task_data;
-  ompt_frame_t *task_frame;
-  ompt_data_t *parallel_data;
-  int thread_num;
-
-  int success = ompt_get_task_info(
-      ancestor_level, &type, &task_data,
-      &task_frame, &parallel_data, &thread_num);
-  if (_type) {
-    *_type = type;
-  }
-  if (success && task_data) {
-    return (TaskInfo*)task_data->ptr;
-  } else {
-    return NULL;
-  }
-}
-
-// Callbacks for store operations
-inline void INS_MemRead(
-  address addr,
-    ulong size,
-    int source_line_num,
-    address funcName) {
-
-  if (!source_line_num) return;
-
-  TaskInfo * taskInfo = getTaskInfo();
-  //lint value = getMemoryValue( addr, size );
-  //uint threadID = (uint)pthread_self();
-
-  if ( taskInfo && taskInfo->active ) {
-    INS::Read(*taskInfo, addr, source_line_num, (char*)funcName);
-#ifdef DEBUG
-    std::stringstream ss;
-    ss << std::hex << addr;
-    PRINT_DEBUG("READ: addr: " + ss.str() +
-        " taskID: " + std::to_string(taskInfo->taskID) +
-        " line no: " + std::to_string(source_line_num));
-#endif
-  }
-}
-
-// Callbacks for store operations
-inline void INS_MemWrite(
-    address addr,
-    lint value,
-    int source_line_num,
-    address funcName ) {
-
-  if (!source_line_num) return;
-
-  TaskInfo * taskInfo = getTaskInfo();
-  //uint threadID = (uint)pthread_self();
-
-  if ( taskInfo && taskInfo->active ) {
-    INS::Write(*taskInfo, addr, (lint)value, source_line_num, (char*)funcName );
-#ifdef DEBUG
-    std::stringstream ss;
-    ss << std::hex << addr;
-    PRINT_DEBUG("= WRITE: addr: " + ss.str() +
-        ", value: " + std::to_string((lint)value) +
-        ", taskID: " + std::to_string(taskInfo->taskID) +
-        ", line number: " + std::to_string(source_line_num) +
-        ", func name: " + std::string((char*)funcName));
-#endif
-  }
-}
-
-// A callback for memory writes of floats
-void __tasksan_write_float(
-    address addr,
-    float value,
-    int source_line_num,
-    address funcName) {
-  INS_MemWrite(addr, (lint)value, source_line_num, funcName);
-}
-
 void __tasksan_register_iir_file(void * fileName) {
   INS::initCommutativityChecker( (char *)fileName );
 }
 
-// A callback for memory writes of doubles
-void __tasksan_write_double(
-    address addr,
-    double value,
-    int source_line_num,
-    address funcName) {
-  INS_MemWrite(addr, (lint)value, source_line_num, funcName);
+// Registers the site table of an instrumented module
+unsigned __tasksan_register_sites(void * sites, unsigned count) {
+  return INS::RegisterSites((const SourceSite *)sites, count);
 }
 
 void __tasksan_flush_memory() {
   PRINT_DEBUG("  TaskSanitizer: flush memory");
 }
 
-void __tasksan_read1(void *addr, int source_line_num, address funcName) {
-  INS_MemRead(addr, 1, source_line_num, funcName);
-}
-void __tasksan_read2(void *addr, int source_line_num, address funcName) {
-  INS_MemRead(addr, 2, source_line_num, funcName);
-}
-
-void __tasksan_read4(void *addr, int source_line_num, address funcName) {
-  INS_MemRead(addr, 4, source_line_num, funcName);
-}
-
-void __tasksan_read8(void *addr, int source_line_num, address funcName) {
-  INS_MemRead( addr, 8, source_line_num, funcName );
-}
-
-void __tasksan_read16(void *addr, int source_line_num, address funcName) {
-  INS_MemRead( addr, 16, source_line_num, funcName );
-}
-
-void __tasksan_write1(void *addr, lint value, int source_line_num, address funcName) {
-  INS_MemWrite((address)addr, value, source_line_num, funcName);
-}
-
-void __tasksan_write2(void *addr, lint value, int source_line_num, address funcName) {
-  INS_MemWrite((address)addr, value, source_line_num, funcName);
-}
-
-void __tasksan_write4(void *addr, lint value, int source_line_num, address funcName) {
-  INS_MemWrite((address)addr, value, source_line_num, funcName);
-}
-
-void __tasksan_write8(void *addr, lint value, int source_line_num, address funcName) {
-  INS_MemWrite((address)addr, value, source_line_num, funcName);
-}
-
-void __tasksan_write16(void *addr, lint value, int source_line_num, address funcName) {
-  INS_MemWrite((address)addr, value, source_line_num, funcName);
-}
-
 void __tasksan_unaligned_read2(const void *addr) {
   PRINT_DEBUG("  TaskSanitizer: unaligned read2");
 }
@@ -247,18 +120,6 @@ void __tasksan_vptr_update(void **vptr_p, void *new_val) {
   PRINT_DEBUG("  TaskSanitizer: vptr update");
 }
 
-void __tasksan_func_entry(void *call_pc) {
-//  PRINT_DEBUG("  TaskSanitizer: __tasksan_func_entry ");
-}
-
-void __tasksan_func_exit(void * funcPtr) {
-  if (funcPtr && std::string((char*) funcPtr) == "main") {
-    INS::Finalize();
-  }
-  PRINT_DEBUG("TaskSanitizer: __tasksan_func_exit: "
-      + std::string((char *)funcPtr));
-}
-
 void __tasksan_ignore_thread_begin() {
   PRINT_DEBUG("  TaskSanitizer: __tasksan_ignore_thread_begin");
 }
@@ -284,13 +145,32 @@ void __tasksan_external_write(void *addr, void *caller_pc, void *tag) {
 }
 
 
-void __tasksan_read_range(void *addr, unsigned long size) {
-  PRINT_DEBUG("  TaskSanitizer: __tasksan_read_range");
-}  // NOLINT
+// Callbacks for ranges read or written at once, e.g. by memcpy
+void __tasksan_read_range(void *addr, unsigned long size,  // NOLINT
+                          int site_id) {
+  TaskInfo * taskInfo = getTaskInfo();
+  if ( taskInfo && taskInfo->active ) {
+    INS::AccessRange(*taskInfo, addr, size, site_id, false);
+  }
+}
+
+void __tasksan_write_range(void *addr, unsigned long size,  // NOLINT
+                           int site_id) {
+  TaskInfo * taskInfo = getTaskInfo();
+  if ( taskInfo && taskInfo->active ) {
+    INS::AccessRange(*taskInfo, addr, size, site_id, true);
+  }
+}
 
-void __tasksan_write_range(void *addr, unsigned long size) {
-  PRINT_DEBUG("  TaskSanitizer: __tasksan_write_range");
-}  // NOLINT
+// Callback for the loads of a loop summarized by the pass:
+// count reads of size bytes, stride bytes apart from addr
+void __tasksan_read_strided(void *addr, long stride,  // NOLINT
+                            unsigned long count, int size, int site_id) {
+  TaskInfo * taskInfo = getTaskInfo();
+  if ( taskInfo && taskInfo->active ) {
+    INS::ReadStrided(*taskInfo, addr, stride, count, size, site_id);
+  }
+}
 
 a8 __tasksan_atomic8_load(const volatile a8 *a, morder mo) {
   PRINT_DEBUG("  TaskSanitizer: __tasksan_atomic8_load");
@@ -49,8 +49,8 @@ extern "C" {
   void INS_MemWrite4(void *addr, long int v, int lnNo, void *fName);
   void INS_MemWrite1(void *addr, long int v, int lnNo, void *fName);
 
-  void __tasksan_write_float(void *addr, float v, int lnNo, void *fName);
-  void __tasksan_write_double(void *addr, double v, int lnNo, void *fName);
+  void __tasksan_write_float(void *addr, float v, int site_id);
+  void __tasksan_write_double(void *addr, double v, int site_id);
 
   // task begin and end callbacks
   void INS_TaskBeginFunc(void *addr);
@@ -72,19 +72,22 @@ extern "C" {
 
   void __tasksan_register_iir_file(void *);
 
+  // Registers the site table of a module, returns id of its first site
+  unsigned __tasksan_register_sites(void *sites, unsigned count);
+
   void __tasksan_flush_memory();
 
-  void __tasksan_read1(void *addr, int source_line_num, address funcName);
-  void __tasksan_read2(void *addr, int source_line_num, address funcName);
-  void __tasksan_read4(void *addr, int source_line_num, address funcName);
-  void __tasksan_read8(void *addr, int source_line_num, address funcName);
-  void __tasksan_read16(void *addr, int source_line_num, address funcName);
+  void __tasksan_read1(void *addr, int site_id);
+  void __tasksan_read2(void *addr, int site_id);
+  void __tasksan_read4(void *addr, int site_id);
+  void __tasksan_read8(void *addr, int site_id);
+  void __tasksan_read16(void *addr, int site_id);
 
-  void __tasksan_write1(void *addr, long int value, int source_line_num, address funcName);
-  void __tasksan_write2(void *addr, long int value, int source_line_num, address funcName);
-  void __tasksan_write4(void *addr, long int value, int source_line_num, address funcName);
-  void __tasksan_write8(void *addr, long int value, int source_line_num, address funcName);
-  void __tasksan_write16(void *addr, long int value, int source_line_num, address funcName);
+  void __tasksan_write1(void *addr, long int value, int site_id);
+  void __tasksan_write2(void *addr, long int value, int site_id);
+  void __tasksan_write4(void *addr, long int value, int site_id);
+  void __tasksan_write8(void *addr, long int value, int site_id);
+  void __tasksan_write16(void *addr, long int value, int site_id);
 
   void __tasksan_unaligned_read2(const void *addr);
   void __tasksan_unaligned_read4(const void *addr);
@@ -111,8 +114,8 @@ extern "C" {
   void __tasksan_vptr_read(void **vptr_p);
   void __tasksan_vptr_update(void **vptr_p, void *new_val);
 
-  void __tasksan_func_entry(void *call_pc);
-  void __tasksan_func_exit(void * funcPtr);
+  void __tasksan_func_entry(int site_id);
+  void __tasksan_func_exit();
 
   void __tasksan_ignore_thread_begin();
   void __tasksan_ignore_thread_end();
@@ -122,8 +125,14 @@ extern "C" {
   void __tasksan_external_read(void *addr, void *caller_pc, void *tag);
   void __tasksan_external_write(void *addr, void *caller_pc, void *tag);
 
-  void __tasksan_read_range(void *addr, unsigned long size);  // NOLINT
-  void __tasksan_write_range(void *addr, unsigned long size);  // NOLINT
+  void __tasksan_read_range(void *addr, unsigned long size,  // NOLINT
+                            int site_id);
+  void __tasksan_write_range(void *addr, unsigned long size,  // NOLINT
+                             int site_id);
+  void __tasksan_read_strided(void *addr, long stride,  // NOLINT
+                              unsigned long count, int size, int site_id);
+
+  void __tasksan_access_batch(void *accesses, unsigned count);
 
   #ifdef __cplusplus
   }  // extern "C"
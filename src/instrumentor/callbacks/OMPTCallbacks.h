@@ -24,6 +24,15 @@
 //////////////////////////////////////////////////
 //// Helper functions
 //////////////////////////////////////////////////
+
+// see CurrentTask.h
+thread_local ompt_data_t * currentTaskData = NULL;
+
+// Called at every point where a thread starts or resumes a task
+static inline void setCurrentTask(ompt_data_t *task_data) {
+  currentTaskData = task_data;
+}
+
 void TaskSanitizer_TaskBeginFunc(ompt_data_t *task_data) {
   UTIL::createNewTaskMetadata(task_data);
 }
@@ -63,10 +72,12 @@ on_ompt_callback_implicit_task(
       if (task_data->ptr == NULL) {
         TaskSanitizer_TaskBeginFunc(task_data);
       }
+      setCurrentTask(task_data);
       break;
     case ompt_scope_end:
       // this is called when the task has ended.
       INS_TaskFinishFunc(task_data);
+      setCurrentTask(NULL);
       break;
   }
 }
@@ -96,14 +107,9 @@ on_ompt_callback_task_create( // called in the context of the creator
       if (new_task_data->ptr == NULL) {
         TaskSanitizer_TaskBeginFunc(new_task_data);
       }
-      void * depAddr = parent_task_data->ptr;
-      if (depAddr) { // valid parent task
-        // send and receive token
-        INTEGER value = reinterpret_cast<INTEGER>(depAddr);
-        INS::TaskSendTokenLog(
-            *((TaskInfo *)parent_task_data->ptr), depAddr,  value);
-        INS::TaskReceiveTokenLog(
-            *((TaskInfo *)new_task_data->ptr), depAddr, value);
+      if (parent_task_data->ptr) { // valid parent task
+        INS::TaskSpawnLog(*((TaskInfo *)parent_task_data->ptr),
+                          *((TaskInfo *)new_task_data->ptr));
 
         // store child ID
         int childID = ((TaskInfo*)new_task_data->ptr)->taskID;
@@ -131,6 +137,9 @@ on_ompt_callback_task_create( // called in the context of the creator
 
   UTIL::endThisTask(parent_task_data);
   UTIL::disguiseToTewTask(parent_task_data);
+
+  // the creator goes on executing after the task is created
+  setCurrentTask(parent_task_data);
 }
 
 static void
@@ -142,6 +151,14 @@ on_ompt_callback_task_schedule( // called in the context of the task
   if (next_task_data->ptr == NULL) {
     TaskSanitizer_TaskBeginFunc(next_task_data);
   }
+  // accesses of a finished task must reach the checker
+  // before those of the segment that waited for it
+  if (prior_task_status == ompt_task_complete && prior_task_data->ptr) {
+    INS::TaskCompleteLog(*((TaskInfo *)prior_task_data->ptr));
+  }
+
+  // covers task switches and untied tasks resuming on this thread
+  setCurrentTask(next_task_data);
   PRINT_DEBUG("Task is being scheduled (p:" +
       std::to_string(next_task_data->value) + " t:" +
       std::to_string(prior_task_data->value) +  ")" );
@@ -226,11 +243,10 @@ static void on_ompt_callback_sync_region(
           PRINT_DEBUG("Taskwait end scope, task id: "
               + std::to_string(taskInfo->taskID) );
 
-          taskInfo->addChild(taskInfo->taskID);
           UTIL::endThisTask(task_data);
-          UTIL::disguiseToTewTask(task_data);
+          UTIL::disguiseToTewTask(task_data, true);
           taskInfo = (TaskInfo*)task_data->ptr;
-          INS::saveChildHBs(*taskInfo);
+          setCurrentTask(task_data);
           PRINT_DEBUG("Taskwait (after) end scope, task id: "
               + std::to_string(taskInfo->taskID) );
           break;
@@ -269,6 +285,10 @@ static int dfinspec_initialize(
   register_callback(ompt_callback_sync_region);
 
   INS::InitTaskSanitizerRuntime();
+
+  // Reports at exit, before the static objects of the runtime
+  // are destroyed since they are built before OMPT initializes
+  atexit(INS::Finalize);
   PRINT_DEBUG("TaskSanitizer: init");
 
   return 1;
@@ -0,0 +1,55 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// Defines a per-thread buffer of memory access records. Each
+// worker thread fills its own buffer without taking any lock;
+// the buffer is drained into the checker in one batch when it
+// gets full or when the thread reaches a task end or taskwait.
+
+#ifndef _INSTRUMENTOR_EVENTLOGGER_ACCESSBUFFER_H_
+#define _INSTRUMENTOR_EVENTLOGGER_ACCESSBUFFER_H_
+
+#include "common/defs.h"
+#include "common/AccessRecord.h"
+
+// number of records a thread buffers before draining them
+#define ACCESS_BUFFER_CAPACITY 1024
+
+typedef struct AccessBuffer {
+  size_t count;
+  AccessRecord records[ACCESS_BUFFER_CAPACITY];
+
+  // accesses seen and skipped in sampling mode
+  uint64_t sampledAccesses;
+  uint64_t skippedAccesses;
+
+  AccessBuffer(): count(0), sampledAccesses(0), skippedAccesses(0) {}
+
+  inline bool isFull() const {
+    return count == ACCESS_BUFFER_CAPACITY;
+  }
+
+  inline bool isEmpty() const {
+    return count == 0;
+  }
+
+  // Appends a record. Caller drains the buffer when it is full.
+  inline void append(const AccessRecord & access) {
+    records[count++] = access;
+  }
+
+  inline void clear() {
+    count = 0;
+  }
+} AccessBuffer;
+
+#endif // AccessBuffer.h
@@ -0,0 +1,74 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// Defines a small direct-mapped filter of the accesses of one
+// task segment. It drops accesses which add nothing to what the
+// segment already handed to the checker:
+//   - a read of an address the segment read or wrote before
+//   - a write of the same value the segment last wrote there
+// A write of a different value is passed on, since the checker
+// compares written values of parallel writes.
+
+#ifndef _INSTRUMENTOR_EVENTLOGGER_ACCESSFILTER_H_
+#define _INSTRUMENTOR_EVENTLOGGER_ACCESSFILTER_H_
+
+#include "common/defs.h"
+#include <cstdint>
+#include <cstring>
+
+#define ACCESS_FILTER_BITS  8
+#define ACCESS_FILTER_SLOTS (1 << ACCESS_FILTER_BITS)
+
+typedef struct AccessFilter {
+  typedef struct Slot {
+    ADDRESS address;   // NULL if slot is empty
+    VALUE   value;     // last value written, if hasWrite
+    bool    hasWrite;
+  } Slot;
+
+  Slot slots[ACCESS_FILTER_SLOTS];
+
+  AccessFilter() {
+    memset(slots, 0, sizeof(slots));
+  }
+
+  // Returns true if the read need not reach the checker
+  inline bool isRedundantRead(ADDRESS addr) {
+    Slot & slot = getSlot(addr);
+    if (slot.address == addr) return true;
+
+    slot.address  = addr;
+    slot.hasWrite = false;
+    return false;
+  }
+
+  // Returns true if the write need not reach the checker
+  inline bool isRedundantWrite(ADDRESS addr, VALUE value) {
+    Slot & slot = getSlot(addr);
+    if (slot.address == addr && slot.hasWrite && slot.value == value) {
+      return true;
+    }
+    slot.address  = addr;
+    slot.value    = value;
+    slot.hasWrite = true;
+    return false;
+  }
+
+  // Consecutive words map to consecutive slots, so a loop over
+  // up to ACCESS_FILTER_SLOTS words does not evict itself
+  inline Slot & getSlot(ADDRESS addr) {
+    uintptr_t word = reinterpret_cast<uintptr_t>(addr) >> 3;
+    return slots[word & (ACCESS_FILTER_SLOTS - 1)];
+  }
+} AccessFilter;
+
+#endif // AccessFilter.h
@@ -0,0 +1,181 @@
+/////////////////////////////////////////////////////////////////
+//  TaskSanitizer: a lightweight determinacy race checking
+//          tool for OpenMP task applications
+//
+//    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+//      Copying or using this code by any means whatsoever
+//      without consent of the owner is strictly prohibited.
+//
+//   Contact: hassansalehe-at-gmail-dot-com
+//
+/////////////////////////////////////////////////////////////////
+
+// Defines the AccessSampler of sampling mode. It checks only a
+// part of the accesses, chosen by hashing instead of at random:
+//   task:     all accesses of a sampled task segment
+//   site:     all accesses of a sampled source site
+//   address:  all accesses to a sampled 8-byte word
+// An access is checked if it passes all three; a range access,
+// e.g. of a memcpy, covers many words and passes the first two
+// only. Only address sampling keeps or drops both accesses of a
+// race together. The two accesses come from different tasks and
+// often from different sites, so task and site sampling may keep
+// one and drop the other.
+// With a budget the address rate is adapted so that the time
+// threads spend checking accesses stays under that fraction of
+// their time. This needs the checking to run on those threads, so
+// the budget is dropped with detector threads or a trace.
+//
+// Enabled by TASKSAN_SAMPLING, a comma separated list such as
+//   TASKSAN_SAMPLING=task=0.5,address=0.25,budget=0.1
+
+#ifndef _INSTRUMENTOR_EVENTLOGGER_ACCESSSAMPLER_H_
+#define _INSTRUMENTOR_EVENTLOGGER_ACCESSSAMPLER_H_
+
+#include "common/defs.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+
+#define SAMPLING_ONE       (1ull << 32)      // threshold of rate 1
+#define SAMPLING_WINDOW_NS 10000000ull       // 10 ms between adaptations
+#define SAMPLING_MIN_RATE  (1.0 / 1024)      // adaptation keeps this much
+
+class AccessSampler {
+  public:
+    AccessSampler(): enabled(false), taskThreshold(SAMPLING_ONE),
+      siteThreshold(SAMPLING_ONE), addressThreshold(SAMPLING_ONE),
+      maxAddressThreshold(SAMPLING_ONE), budget(0), threads(0),
+      detectorNanos(0), windowStart(0) {}
+
+    // Returns the specification of TASKSAN_SAMPLING, NULL when not set
+    static const char * getSpecFromEnv() {
+      const char * spec = getenv("TASKSAN_SAMPLING");
+      return (spec && *spec) ? spec : NULL;
+    }
+
+    // Parses a specification and turns sampling on. Leaves
+    // sampling off and returns false if it is invalid.
+    bool configure(const char * spec) {
+      double rates[3] = {1, 1, 1};  // task, site, address
+      double newBudget = 0;
+      std::string text(spec);
+      std::stringstream items(text);
+      std::string item;
+      while (std::getline(items, item, ',')) {
+        size_t equals = item.find('=');
+        if (equals == std::string::npos) return false;
+        std::string key = item.substr(0, equals);
+        char * end;
+        double value = strtod(item.c_str() + equals + 1, &end);
+        if (*end || value <= 0 || value > 1) return false;
+
+        if (key == "task") rates[0] = value;
+        else if (key == "site") rates[1] = value;
+        else if (key == "address") rates[2] = value;
+        else if (key == "budget") newBudget = value;
+        else return false;
+      }
+
+      taskThreshold = toThreshold(rates[0]);
+      siteThreshold = toThreshold(rates[1]);
+      maxAddressThreshold = toThreshold(rates[2]);
+      addressThreshold.store(maxAddressThreshold);
+      budget = newBudget;
+      windowStart.store(now());
+      enabled = true;
+      return true;
+    }
+
+    inline bool isEnabled() const { return enabled; }
+    inline bool hasBudget() const { return budget > 0; }
+
+    // Returns true if the access is to be checked
+    inline bool keep(INTEGER taskID, ADDRESS addr, INTEGER siteID) const {
+      uintptr_t word = reinterpret_cast<uintptr_t>(addr) >> 3;
+      return hash(taskID) < taskThreshold &&
+             hash(siteID) < siteThreshold &&
+             hash(word) < addressThreshold.load(std::memory_order_relaxed);
+    }
+
+    // Returns true if the range access is to be checked
+    inline bool keepRange(INTEGER taskID, INTEGER siteID) const {
+      return hash(taskID) < taskThreshold && hash(siteID) < siteThreshold;
+    }
+
+    // Keeps the address rate as configured
+    inline VOID clearBudget() { budget = 0; }
+
+    // Counts a thread whose checking time is accounted
+    inline VOID addThread() { threads++; }
+
+    // Accounts time a thread spent checking accesses. Once per
+    // window the address rate is scaled by budget / measured
+    // fraction, at most halved or raised by a quarter.
+    VOID addDetectorTime(uint64_t nanos) {
+      detectorNanos.fetch_add(nanos, std::memory_order_relaxed);
+      uint64_t end = now();
+      uint64_t start = windowStart.load(std::memory_order_relaxed);
+      if (end - start < SAMPLING_WINDOW_NS) return;
+      if (!windowStart.compare_exchange_strong(start, end)) return;
+
+      double busy = detectorNanos.exchange(0);
+      double fraction = busy / ((double)(end - start) * std::max(1u,
+                                                        threads.load()));
+      double scale = (fraction > 0) ? budget / fraction : 2;
+      scale = std::min(1.25, std::max(0.5, scale));
+      double rate = getAddressRate() * scale;
+      rate = std::min(rate, (double)maxAddressThreshold / SAMPLING_ONE);
+      rate = std::max(rate, SAMPLING_MIN_RATE);
+      addressThreshold.store(toThreshold(rate));
+    }
+
+    double getAddressRate() const {
+      return (double)addressThreshold.load() / SAMPLING_ONE;
+    }
+
+    // Describes the configured rates for reports
+    std::string describe() const {
+      std::stringstream text;
+      text << "task " << (double)taskThreshold / SAMPLING_ONE
+           << ", site " << (double)siteThreshold / SAMPLING_ONE
+           << ", address " << getAddressRate();
+      if (hasBudget()) {
+        text << " (adapted to a budget of " << budget * 100 << "%)";
+      }
+      return text.str();
+    }
+
+    static inline uint64_t now() {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+  private:
+    // upper 32 bits of a multiplicative hash
+    static inline uint64_t hash(uint64_t v) {
+      return (v * 0x9E3779B97F4A7C15ull) >> 32;
+    }
+
+    static inline uint64_t toThreshold(double rate) {
+      return (uint64_t)(rate * SAMPLING_ONE);
+    }
+
+    bool enabled;
+    uint64_t taskThreshold;
+    uint64_t siteThreshold;
+    std::atomic<uint64_t> addressThreshold;
+    uint64_t maxAddressThreshold;  // the configured address rate
+
+    double budget;  // fraction of thread time, 0 if rates are fixed
+    std::atomic<unsigned> threads;
+    std::atomic<uint64_t> detectorNanos;
+    std::atomic<uint64_t> windowStart;
+};
+
+#endif // AccessSampler.h
@@ -18,12 +18,40 @@
 std::mutex INS::guardLock;
 
 std::atomic<INTEGER> INS::taskIDSeed{ 0 };
-std::unordered_map<STRING, INTEGER> INS::funcNames;
-INTEGER INS::funcIDSeed = 1;
 std::unordered_map<std::pair<ADDRESS,INTEGER>, INTEGER, hash_function> INS::idMap;
-std::unordered_map<INTEGER, INTSET> INS::HB;
 std::unordered_map<ADDRESS, INTEGER> INS::lastWriter;
 std::unordered_map<ADDRESS, INTEGER> INS::lastReader;
 
 bool INS::isOMPTinitialized = false;
+bool INS::isFinalized = false;
 Checker INS::onlineChecker;
+EventSink * INS::eventSink = &INS::onlineChecker;
+const char * INS::tracePath = NULL;
+AccessSampler INS::sampler;
+thread_local AccessBuffer * INS::localBuffer = nullptr;
+std::vector<AccessBuffer *> INS::accessBuffers;
+
+AccessBuffer & INS::createAccessBuffer() {
+  localBuffer = new AccessBuffer();
+  guardLock.lock();
+  accessBuffers.push_back(localBuffer);
+  guardLock.unlock();
+  sampler.addThread();
+  return *localBuffer;
+}
+
+VOID INS::drainAccessBuffer(AccessBuffer & buffer) {
+  if (sampler.hasBudget()) {
+    uint64_t start = AccessSampler::now();
+    eventSink->saveMemoryAccesses(buffer.records, buffer.count);
+    sampler.addDetectorTime(AccessSampler::now() - start);
+  } else {
+    eventSink->saveMemoryAccesses(buffer.records, buffer.count);
+  }
+  buffer.clear();
+}
+
+uint32_t INS::saveStack(CallStack & stack) {
+  stack.setSaved(FunctionEngine::instance().saveStack(stack));
+  return stack.getSavedID();
+}
@@ -17,8 +17,16 @@
 #define _INSTRUMENTOR_EVENLOGGER_LOGGER_H_
 
 #include "common/defs.h"
+#include "common/AccessRecord.h"
+#include "common/AccessBatch.h"
+#include "common/SiteTable.h"
+#include "functionengine/FunctionEngine.h"
 #include "instrumentor/eventlogger/TaskInfo.h"
+#include "instrumentor/eventlogger/AccessBuffer.h"
+#include "instrumentor/eventlogger/AccessSampler.h"
 #include "detector/determinacy/checker.h"
+#include "detector/determinacy/asyncChecker.h"
+#include "detector/determinacy/traceWriter.h"
 #include "detector/commutativity/CommutativityChecker.h"
 #include <atomic>
 
@@ -36,22 +44,12 @@ struct hash_function {
 class INS {
 
   private:
-    // a function to tell whether there is a happens-before relation between two tasks
-    static inline bool hasHB( INTEGER tID, INTEGER parentID );
-
     // a strictly increasing value, used as tasks unique id generator
     static std::atomic<INTEGER> taskIDSeed;
 
-    // storing function name pointers
-    static std::unordered_map<STRING, INTEGER>funcNames;
-    static INTEGER funcIDSeed;
-
     // mapping buffer location, value with task id
     static std::unordered_map<std::pair<ADDRESS,INTEGER>, INTEGER, hash_function> idMap;
 
-    // keeping the happens-before relation between tasks
-    static std::unordered_map<INTEGER, INTSET> HB;
-
     // keeping track of the last writer to a memory location
     static std::unordered_map<ADDRESS, INTEGER> lastWriter;
 
@@ -61,6 +59,78 @@ class INS {
     // checker instance for detecting determinacy race online
     static Checker onlineChecker;
 
+    // receives all events: the online checker, an AsyncChecker
+    // when TASKSAN_DETECTOR_THREADS is set or a TraceWriter when
+    // TASKSAN_RECORD is set
+    static EventSink * eventSink;
+
+    // trace being recorded, NULL when checking online
+    static const char * tracePath;
+
+    // chooses the accesses to check when TASKSAN_SAMPLING is set
+    static AccessSampler sampler;
+
+    // access buffer of the calling thread, filled without locking
+    static thread_local AccessBuffer * localBuffer;
+
+    // buffers of all threads, drained at finalization
+    static std::vector<AccessBuffer *> accessBuffers;
+
+    // The functions below inline into the access callbacks, also
+    // into instrumented code when it is linked with the bitcode of
+    // the callbacks (see AccessCallbacks.cc). The rarely taken
+    // paths they call are defined out of line in Logger.cc.
+
+    // Returns the access buffer of the calling thread
+    static inline AccessBuffer & getAccessBuffer() {
+      if (!localBuffer) return createAccessBuffer();
+      return *localBuffer;
+    }
+
+    // Creates the access buffer of the calling thread
+    static AccessBuffer & createAccessBuffer();
+
+    // Hands buffered accesses to the checker, which synchronizes
+    // them internally per address shard.
+    static VOID drainAccessBuffer(AccessBuffer & buffer);
+
+    // Returns the id of the call stack of the task. The stack is
+    // saved in the stack depot the first time an access is
+    // recorded under it; the id is kept until the stack changes.
+    static inline uint32_t getStackID(TaskInfo & task) {
+      CallStack & stack = task.callStack;
+      if (stack.isSaved()) return stack.getSavedID();
+      return saveStack(stack);
+    }
+
+    // Saves the stack in the stack depot and returns its id
+    static uint32_t saveStack(CallStack & stack);
+
+    // Returns true if sampling mode checks the access
+    static inline bool isSampled(TaskInfo & task, ADDRESS addr,
+        INTEGER siteID, bool isRange = false) {
+      AccessBuffer & buffer = getAccessBuffer();
+      buffer.sampledAccesses++;
+      if (isRange ? sampler.keepRange(task.taskID, siteID) :
+                    sampler.keep(task.taskID, addr, siteID)) return true;
+      buffer.skippedAccesses++;
+      return false;
+    }
+
+    // Describes how many accesses sampling mode checked
+    static inline std::string getSamplingSummary() {
+      uint64_t sampled = 0, skipped = 0;
+      for (AccessBuffer * buffer : accessBuffers) {
+        sampled += buffer->sampledAccesses;
+        skipped += buffer->skippedAccesses;
+      }
+      double rate = sampled ? 100.0 * (sampled - skipped) / sampled : 100;
+      std::stringstream text;
+      text << rate << "% of " << sampled << " accesses checked; rates: "
+           << sampler.describe();
+      return text.str();
+    }
+
   public:
     // global lock to protect metadata, use this lock
     // when you call any function of this class
@@ -69,15 +139,51 @@ class INS {
     // checks if OPMT is initialized
     static bool isOMPTinitialized;
 
+    // set once the conflicts are reported, see Finalize
+    static bool isFinalized;
+
     // open file for logging.
     static inline VOID InitTaskSanitizerRuntime() {
 
       // reset attributes used
-      idMap.clear(); HB.clear();
+      idMap.clear();
       lastReader.clear(); lastWriter.clear();
 
       taskIDSeed = 0;
       isOMPTinitialized = true;
+
+      const char * samplingSpec = AccessSampler::getSpecFromEnv();
+      if (samplingSpec && !sampler.isEnabled() &&
+          !sampler.configure(samplingSpec)) {
+        std::cerr << "TaskSanitizer: ignoring invalid TASKSAN_SAMPLING="
+                  << samplingSpec << std::endl;
+      }
+
+      if (eventSink != &onlineChecker) return;
+      unsigned detectorThreads = AsyncChecker::getThreadCountFromEnv();
+
+      // recording takes precedence over detector threads
+      tracePath = TraceWriter::getPathFromEnv();
+      if (tracePath) {
+        TraceWriter * writer = new TraceWriter(tracePath);
+        if (writer->isOpen()) {
+          eventSink = writer;
+        } else {
+          delete writer;
+          tracePath = NULL;
+        }
+      } else if (detectorThreads) {
+        eventSink = new AsyncChecker(onlineChecker, detectorThreads);
+      }
+
+      // threads only hand accesses on then, so their checking
+      // time does not tell what the accesses cost
+      if (eventSink != &onlineChecker && sampler.hasBudget()) {
+        std::cerr << "TaskSanitizer: the sampling budget needs checking "
+                  << "on the program threads; keeping the rates fixed"
+                  << std::endl;
+        sampler.clearBudget();
+      }
     }
 
     // Generates a unique ID for each new task
@@ -90,42 +196,52 @@ class INS {
        onlineChecker.initializeCommutativityChecker(fname);
     }
 
-    // registers the function if not registered yet.
-    // Also prints the function to standard output.
-    static inline INTEGER RegisterFunction(const STRING funcName) {
-
+    // Reports the conflicts found. Registered with atexit when
+    // OMPT initializes (see OMPTCallbacks.h); later calls do nothing.
+    static inline VOID Finalize() {
       guardLock.lock();
-      int funcID = 0;
-      auto fd = funcNames.find(funcName);
-      if ( fd == funcNames.end() ) { // new function
-        funcID = funcIDSeed++;
-        funcNames[funcName] = funcID;
-        onlineChecker.registerFuncSignature(
-            std::string(funcName), funcID);
-      } else {
-         funcID = fd->second;
+      if (isFinalized) {
+        guardLock.unlock();
+        return;
       }
+      isFinalized = true;
 
-      guardLock.unlock();
-      return funcID;
-    }
+      // other threads are done with their tasks at this point
+      for (AccessBuffer * buffer : accessBuffers) {
+        drainAccessBuffer(*buffer);
+      }
 
-    // close file used in logging
-    static inline VOID Finalize() {
-      guardLock.lock();
+      // checks what is still queued to the detector threads,
+      // or completes the trace
+      if (eventSink != &onlineChecker) {
+        delete eventSink;
+        eventSink = &onlineChecker;
+      }
 
-      idMap.clear(); HB.clear();
+      idMap.clear();
       lastReader.clear();
       lastWriter.clear();
       //DuplicateManager::removeDuplicates( onlineChecker.getConflicts() );
-      onlineChecker.reportConflicts();
+      if (sampler.isEnabled()) {
+        onlineChecker.setSamplingSummary(getSamplingSummary());
+      }
+      if (tracePath) {
+        std::cout << "TaskSanitizer: trace recorded in " << tracePath
+                  << ", analyze it with tasksan-analyze" << std::endl;
+        if (sampler.isEnabled()) {
+          std::cout << "TaskSanitizer: sampling: " << getSamplingSummary()
+                    << std::endl;
+        }
+      } else {
+        onlineChecker.reportConflicts();
+      }
       guardLock.unlock();
     }
 
     // called when a task begins execution and retrieves parent task id
     static inline VOID TaskBeginLog(TaskInfo& task) {
       guardLock.lock();
-      onlineChecker.onTaskCreate(task.taskID);
+      eventSink->onTaskCreate(task.taskID);
       guardLock.unlock();
     }
 
@@ -144,29 +260,45 @@ class INS {
 
         if (parentID != tid) {
           // there was a bug where a task could send token to itself
-          onlineChecker.saveHappensBeforeEdge(parentID, tid);
-
-          // there is a happens before between taskID and parentID:
-          //parentID ---happens-before---> taskID
-          if (HB.find( tid ) == HB.end()) {
-            HB[tid] = INTSET();
-          }
-          HB[tid].insert( parentID );
-
-          // take the happens-before of the parentID
-          if (HB.find( parentID ) != HB.end()) {
-            HB[tid].insert(HB[parentID].begin(), HB[parentID].end());
-          }
+          eventSink->saveHappensBeforeEdge(parentID, tid);
         }
       }
       guardLock.unlock();
     }
 
+    // called when segment parent creates the task child
+    static inline VOID TaskSpawnLog(TaskInfo & parent, TaskInfo & child) {
+      guardLock.lock();
+      eventSink->onTaskSpawn(parent.taskID, child.taskID);
+      guardLock.unlock();
+    }
+
+    // called when a task goes on in a new segment after a spawn
+    static inline VOID TaskContinueLog(TaskInfo & prev, TaskInfo & next) {
+      flushAccesses(); // prev may be retired by the event
+      guardLock.lock();
+      eventSink->onTaskContinue(prev.taskID, next.taskID);
+      guardLock.unlock();
+    }
+
+    // called when the last segment of a task has finished
+    static inline VOID TaskCompleteLog(TaskInfo & task) {
+      flushAccesses();
+      guardLock.lock();
+      eventSink->onTaskEnd(task.taskID);
+      guardLock.unlock();
+    }
+
     // called before the task terminates.
-    static inline VOID TaskEndLog( TaskInfo& task ) {
-      //guardLock.lock(); // protect file descriptor
-      // do something
-      //guardLock.unlock();
+    static inline VOID TaskEndLog( TaskInfo& /* task */ ) {
+      flushAccesses();
+    }
+
+    // Drains accesses buffered by the calling thread into the checker
+    static inline VOID flushAccesses() {
+      AccessBuffer & buffer = getAccessBuffer();
+      if ( buffer.isEmpty() ) return;
+      drainAccessBuffer(buffer);
     }
 
     // stores the buffer address of the token and the
@@ -177,58 +309,165 @@ class INS {
       auto key = std::make_pair(bufLocAddr, value );
       guardLock.lock(); //  protect idMap
       idMap[key] = task.taskID;
+      eventSink->keepTask(task.taskID);
       guardLock.unlock();
     }
 
     // provides the address of memory a task reads from
     static inline VOID Read( TaskInfo & task,
-        ADDRESS addr, INTEGER source_line_num, STRING funcName ) {
-      INTEGER funcID = task.getFunctionId( funcName );
-
-      // register function if not registered yet
-      if (funcID == 0) {
-        funcID = RegisterFunction( funcName );
-        task.registerFunction( funcName, funcID );
-      }
-
-      //task.saveReadAction(addr, source_line_num, funcID);
-      std::stringstream ssin(std::to_string((VALUE)addr) + " 0 " +
-          std::to_string(source_line_num) + " " + std::to_string(funcID));
-
-      guardLock.lock();
-      onlineChecker.detectRaceOnMem(task.taskID, "R", ssin);
-      guardLock.unlock();
+        ADDRESS addr, INTEGER siteID ) {
+      if ( sampler.isEnabled() && !isSampled(task, addr, siteID) ) return;
+      if ( task.accessFilter.isRedundantRead(addr) ) return;
+
+      AccessRecord access;
+      access.accessing_task_id = task.taskID;
+      access.destination_address = addr;
+      access.value_written = 0;
+      access.source_site_id = siteID;
+      access.stack_id = getStackID(task);
+      access.is_write_action = false;
+
+      AccessBuffer & buffer = getAccessBuffer();
+      buffer.append(access);
+      if ( buffer.isFull() ) flushAccesses();
     }
 
     // stores a write action
     static inline VOID Write(TaskInfo & task, ADDRESS addr,
-        INTEGER value, INTEGER source_line_num, STRING funcName) {
+        INTEGER value, INTEGER siteID) {
+      if ( sampler.isEnabled() && !isSampled(task, addr, siteID) ) return;
+      if ( task.accessFilter.isRedundantWrite(addr, value) ) return;
+
+      AccessRecord access;
+      access.accessing_task_id = task.taskID;
+      access.destination_address = addr;
+      access.value_written = value;
+      access.source_site_id = siteID;
+      access.stack_id = getStackID(task);
+      access.is_write_action = true;
+
+      AccessBuffer & buffer = getAccessBuffer();
+      buffer.append(access);
+      if ( buffer.isFull() ) flushAccesses();
+    }
 
-      INTEGER funcID = task.getFunctionId( funcName );
+    // stores the accesses of a batch, which the compiler collects
+    // from straight-line code of one task
+    static inline VOID AccessBatch(TaskInfo & task,
+        const BatchedAccess * accesses, size_t count) {
+      AccessBuffer & buffer = getAccessBuffer();
+      for (size_t i = 0; i < count; i++) {
+        const BatchedAccess & batched = accesses[i];
+        ADDRESS addr = batched.address;
+        if ( sampler.isEnabled() &&
+             !isSampled(task, addr, batched.site_id) ) continue;
+        if ( batched.is_write
+             ? task.accessFilter.isRedundantWrite(addr, batched.value)
+             : task.accessFilter.isRedundantRead(addr) ) continue;
+
+        AccessRecord access;
+        access.accessing_task_id = task.taskID;
+        access.destination_address = addr;
+        access.value_written = batched.is_write ? batched.value : 0;
+        access.source_site_id = batched.site_id;
+        access.stack_id = getStackID(task);
+        access.is_write_action = batched.is_write;
+
+        buffer.append(access);
+        if ( buffer.isFull() ) flushAccesses();
+      }
+    }
 
-      // register function if not registered yet
-      if (funcID == 0) {
-        funcID = RegisterFunction( funcName );
-        task.registerFunction( funcName, funcID );
+    // stores an access to size bytes from addr, e.g. of a memcpy,
+    // as one range instead of one access per word
+    static inline VOID AccessRange(TaskInfo & task, ADDRESS addr,
+        size_t size, INTEGER siteID, bool isWrite) {
+      if ( !size ) return;
+      if ( sampler.isEnabled() && !isSampled(task, addr, siteID, true) ) {
+        return;
       }
 
-      //task.saveWriteAction(addr, value, source_line_num, funcID);
-      std::stringstream ssin(std::to_string((VALUE)addr) + " " +
-          std::to_string(value) + " " + std::to_string(source_line_num) +
-          " " + std::to_string(funcID));
+      AccessRecord access;
+      access.accessing_task_id = task.taskID;
+      access.value_written = 0;
+      access.source_site_id = siteID;
+      access.stack_id = getStackID(task);
+      access.is_write_action = isWrite;
+
+      AccessBuffer & buffer = getAccessBuffer();
+      while (size) {  // a record holds at most UINT32_MAX bytes
+        access.destination_address = addr;
+        access.range_size = std::min(size, (size_t)UINT32_MAX);
+        addr = static_cast<char *>(addr) + access.range_size;
+        size -= access.range_size;
+
+        buffer.append(access);
+        if ( buffer.isFull() ) flushAccesses();
+      }
+    }
 
-      guardLock.lock();
-      onlineChecker.detectRaceOnMem(task.taskID, "W", ssin);
-      guardLock.unlock();
+    // stores count reads of size bytes each, stride bytes apart
+    // from addr, e.g. those of a loop, as strided ranges. Writes
+    // are not summarized: ranges carry no value to compare.
+    static inline VOID ReadStrided(TaskInfo & task, ADDRESS addr,
+        long stride, size_t count, unsigned size, INTEGER siteID) {
+      if ( !count || !size ) return;
+      char * first = static_cast<char *>(addr);
+      if ( stride < 0 ) {  // walk up from the lowest element
+        stride = -stride;
+        first -= (count - 1) * stride;
+      }
+      if ( (size_t)stride <= size ) {  // the elements touch
+        AccessRange(task, first, (count - 1) * stride + size, siteID, false);
+        return;
+      }
+      if ( size > UINT8_MAX ) {  // too wide for a record: one per element
+        for (size_t i = 0; i < count; i++) {
+          AccessRange(task, first + i * stride, size, siteID, false);
+        }
+        return;
+      }
+      if ( sampler.isEnabled() && !isSampled(task, addr, siteID, true) ) {
+        return;
+      }
+
+      AccessRecord access;
+      access.accessing_task_id = task.taskID;
+      access.range_stride = stride;
+      access.range_width = size;
+      access.source_site_id = siteID;
+      access.stack_id = getStackID(task);
+      access.is_write_action = false;
+
+      // a record spans at most UINT32_MAX bytes
+      size_t perRecord = (UINT32_MAX - size) / stride + 1;
+      AccessBuffer & buffer = getAccessBuffer();
+      while (count) {
+        size_t elements = std::min(count, perRecord);
+        access.destination_address = first;
+        access.range_size = (elements - 1) * stride + size;
+        first += elements * stride;
+        count -= elements;
+
+        buffer.append(access);
+        if ( buffer.isFull() ) flushAccesses();
+      }
+    }
+
+    // Registers the source sites of an instrumented module
+    // and returns the id of its first site
+    static inline uint32_t RegisterSites(const SourceSite * sites,
+        uint32_t count) {
+      return SiteTable::instance().registerModule(sites, count);
     }
 
-    // Saves IDs of child tasks at a barrier
-    static inline VOID saveChildHBs(TaskInfo & task) {
+    // Joins the children created since the last taskwait
+    // into the segment that follows the taskwait
+    static inline VOID TaskSyncLog(TaskInfo & prev, TaskInfo & next) {
+      flushAccesses();
       guardLock.lock();
-      for (int uncleID : task.childrenIDs) {
-        onlineChecker.saveHappensBeforeEdge(uncleID, task.taskID);
-      }
-      task.childrenIDs.clear();
+      eventSink->onTaskSync(prev.taskID, next.taskID, next.childrenIDs);
+      next.childrenIDs.clear();
       guardLock.unlock();
     }
 };
@@ -17,21 +17,19 @@
 
 #include "common/defs.h"
 #include "common/MemoryActions.h"
+#include "instrumentor/eventlogger/AccessFilter.h"
+#include "functionengine/CallStack.h"
 
 typedef struct TaskInfo {
   uint threadID = 0;
   uint taskID   = 0;
   bool active   = false;
 
-  // stores pointers of signatures of functions executed by task
-  // for faster acces
-  std::unordered_map<STRING, INTEGER> functions;
+  // drops repeated accesses of this task segment
+  AccessFilter accessFilter;
 
-  // stores memory actions performed by task.
-  std::unordered_map<address, MemoryActions> memoryLocations;
-
-  // improve performance by buffering actions and write only once.
-  std::ostringstream actionBuffer;
+  // functions the task is in, kept across its segments
+  CallStack callStack;
 
   // stores the IDs of child tasks created by this task
   std::vector<int> childrenIDs;
@@ -41,73 +39,6 @@ typedef struct TaskInfo {
     childrenIDs.push_back(childID);
   }
 
-  // Stores the action info as performed by task. The rules for
-  // storing this information are explained in MemoryActions.h
-  inline void saveMemoryAction(Action & action) {
-    MemoryActions &loc = memoryLocations[action.destination_address];
-    loc.storeAction( action );
-  }
-
-  inline void saveReadAction(ADDRESS & addr,
-      INTEGER & source_line_num,
-      const INTEGER funcID) {
-
-    MemoryActions & loc = memoryLocations[addr];
-    if ( !loc.hasWrite() ) {
-      Action action( taskID, addr, 0, source_line_num, funcID );
-      action.is_write_action = false;
-      loc.storeAction( action );
-    }
-  }
-
-  inline void saveWriteAction(
-      ADDRESS addr,
-      INTEGER value,
-      INTEGER source_line_num,
-      INTEGER funcID) {
-
-     MemoryActions & loc = memoryLocations[addr];
-     bool is_write_action = true;
-     loc.storeAction(taskID, addr, value, source_line_num, funcID, is_write_action);
-  }
-
-  // Prints to ostringstream all memory access actions recorded.
-  void printMemoryActions() {
-    for (auto it = memoryLocations.begin();
-         it != memoryLocations.end(); ++it) {
-      it->second.printActions( actionBuffer );
-    }
-  }
-
-  //////////////////////////////////////////////////////
-  /// HELPER FUNCTIONS                                //
-  //////////////////////////////////////////////////////
-
-  // returns ID if function registered before, otherwise 0.
-   inline INTEGER getFunctionId( const STRING funcName ) {
-     auto fd = functions.find( funcName );
-     if ( fd == functions.end() ) {
-       return 0;
-     } else {
-       return fd->second;
-     }
-   }
-
-   // Registers function for faster access.
-   void registerFunction(STRING funcName, INTEGER funcId ) {
-     functions[funcName] = funcId;
-   }
-
-   // Clears all stored memory actions.
-   // Can executed once the actions are written to log file.
-   void flushLogs() {
-     memoryLocations.clear();
-     actionBuffer.str(""); // clear buffer
-   }
-
 } TaskInfo;
 
-// holder of task identification information
-static std::unordered_map<uint, TaskInfo> taskInfos;
-
 #endif // TaskInfo.h
@@ -23,8 +23,11 @@
 // used in task action logging callbacks.
 namespace UTIL {
 
-// Creates and initializes action logging metadata
-void createNewTaskMetadata(ompt_data_t *task_data) {
+// Creates and initializes action logging metadata. If the task
+// already has metadata, the new segment continues the old one,
+// after a taskwait if afterTaskwait is set.
+void createNewTaskMetadata(ompt_data_t *task_data,
+                           bool afterTaskwait = false) {
 
   // Null if this task created before OMPT initialization
   if (task_data == nullptr) return;
@@ -38,13 +41,17 @@ void createNewTaskMetadata(ompt_data_t *task_data) {
 
   if (oldTaskInfo) {
     newTaskInfo->childrenIDs = oldTaskInfo->childrenIDs;
+    newTaskInfo->callStack = oldTaskInfo->callStack;
   }
 
   INS::TaskBeginLog(*newTaskInfo);
 
   if (oldTaskInfo) {
-    INTEGER value = reinterpret_cast<INTEGER>(oldTaskInfo);
-    INS::TaskReceiveTokenLog(*newTaskInfo, oldTaskInfo, value);
+    if (afterTaskwait) {
+      INS::TaskSyncLog(*oldTaskInfo, *newTaskInfo);
+    } else {
+      INS::TaskContinueLog(*oldTaskInfo, *newTaskInfo);
+    }
     delete oldTaskInfo;
   }
   PRINT_DEBUG("Task_Began, (threadID: " +
@@ -77,8 +84,8 @@ void endThisTask(ompt_data_t *task_data) {
 
 // Changes identifer of the current task to
 // new ID and thus make it look like a new task.
-void disguiseToTewTask(ompt_data_t *task_data) {
-  UTIL::createNewTaskMetadata(task_data);
+void disguiseToTewTask(ompt_data_t *task_data, bool afterTaskwait = false) {
+  UTIL::createNewTaskMetadata(task_data, afterTaskwait);
 }
 
 } // namespace
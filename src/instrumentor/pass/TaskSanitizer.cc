@@ -67,9 +67,37 @@ static llvm::cl::opt<bool>  ClInstrumentAtomics(
 static llvm::cl::opt<bool>  ClInstrumentMemIntrinsics(
     "tasksan-instrument-memintrinsics", llvm::cl::init(true),
     llvm::cl::desc("Instrument memintrinsics (memset/memcpy/memmove)"), llvm::cl::Hidden);
+static llvm::cl::opt<bool>  ClLatePlacement(
+    "tasksan-late-placement", llvm::cl::init(false),
+    llvm::cl::desc("Instrument after the optimizations (EP_OptimizerLast)"),
+    llvm::cl::Hidden);
+static llvm::cl::opt<bool>  ClTaskContextOnly(
+    "tasksan-task-context-only", llvm::cl::init(true),
+    llvm::cl::desc("Instrument only functions that may run in tasks"),
+    llvm::cl::Hidden);
+static llvm::cl::opt<bool>  ClEliminateRedundant(
+    "tasksan-eliminate-redundant", llvm::cl::init(true),
+    llvm::cl::desc("Skip checks repeated in the same task segment"),
+    llvm::cl::Hidden);
+static llvm::cl::opt<bool>  ClReportEliminated(
+    "tasksan-report-eliminated", llvm::cl::init(false),
+    llvm::cl::desc("Print the checks removed per function and why"),
+    llvm::cl::Hidden);
+static llvm::cl::opt<bool>  ClSummarizeLoops(
+    "tasksan-summarize-loops", llvm::cl::init(true),
+    llvm::cl::desc("Report affine loads of loops as strided ranges"),
+    llvm::cl::Hidden);
+static llvm::cl::opt<bool>  ClBatchAccesses(
+    "tasksan-batch-accesses", llvm::cl::init(true),
+    llvm::cl::desc("Report the accesses of straight-line code by one call"),
+    llvm::cl::Hidden);
+
+// entries of the stack array of an access batch
+static const unsigned kMaxBatchSize = 64;
 
 static const char *const kTsanModuleCtorName = "tasksan.module_ctor";
 static const char *const kTsanInitName = "__tasksan_init";
+static const char *const kTsanRegisterSitesName = "__tasksan_register_sites";
 
 namespace {
 
@@ -85,34 +113,119 @@ struct TaskSanitizer : public llvm::FunctionPass {
 
   void getAnalysisUsage(llvm::AnalysisUsage &AU) const override {
     AU.addRequired<llvm::TargetLibraryInfoWrapperPass>();
+    AU.addRequired<llvm::LoopInfoWrapperPass>();
+    AU.addRequired<llvm::ScalarEvolutionWrapperPass>();
+    AU.addRequired<llvm::DominatorTreeWrapperPass>();
+    AU.addRequired<llvm::MemorySSAWrapperPass>();
   }
 
   bool doInitialization(llvm::Module &M) override {
 
     const llvm::DataLayout &DL = M.getDataLayout();
     IntptrTy = DL.getIntPtrType(M.getContext());
+    TsanCtorFunction = nullptr;
+
+    // id of the first site of this module, set by the module
+    // constructor when the site table is registered
+    llvm::Type *Int32Ty = llvm::Type::getInt32Ty(M.getContext());
+    SiteBase = new llvm::GlobalVariable(M, Int32Ty, false,
+        llvm::GlobalValue::InternalLinkage,
+        llvm::ConstantInt::get(Int32Ty, 0), "tasksan.site_base");
+    Sites.clear();
+    SiteIds.clear();
+    SiteStrings.clear();
+    NumChecks = 0;
+
+    TaskFunctions.clear();
+    CloneOrigins.clear();
+    if (ClTaskContextOnly)
+      findTaskContext(M);
     return true;
   }
 
+  bool doFinalization(llvm::Module &M) override;
+
   bool runOnFunction(llvm::Function &F) override;
 
  private:
   void initializeCallbacks(llvm::Module &M);
+  void findTaskContext(llvm::Module &M);
   bool instrumentLoadOrStore(llvm::Instruction *I, const llvm::DataLayout &DL);
   bool instrumentAtomic(llvm::Instruction *I, const llvm::DataLayout &DL);
   bool instrumentMemIntrinsic(llvm::Instruction *I);
+  void eliminateRedundantAccesses(llvm::Function &F,
+      llvm::SmallVectorImpl<llvm::Instruction *> &All,
+      const llvm::DataLayout &DL);
+  bool summarizeLoopAccesses(llvm::SmallVectorImpl<llvm::Instruction *> &All,
+                             const llvm::DataLayout &DL);
+  bool isSummarizableLoop(llvm::Loop *L, llvm::ScalarEvolution &SE,
+                          const llvm::DataLayout &DL);
+  bool batchAccesses(llvm::Function &F,
+                     llvm::SmallVectorImpl<llvm::Instruction *> &All,
+                     const llvm::DataLayout &DL);
   void chooseInstructionsToInstrument(llvm::SmallVectorImpl<llvm::Instruction *> &Local,
                                       llvm::SmallVectorImpl<llvm::Instruction *> &All,
                                       const llvm::DataLayout &DL);
   bool addrPointsToConstantData(llvm::Value *Addr);
+  void findTaskPrivateData(llvm::Function &F);
+  bool isTaskPrivatePointer(llvm::Value *V);
+  bool isLocalAllocation(llvm::Value *V);
   int getMemoryAccessFuncIndex(llvm::Value *Addr, const llvm::DataLayout &DL);
   void InsertRuntimeIgnores(llvm::Function &F);
+  llvm::Value *getSiteId(llvm::Instruction *I,
+                         llvm::Instruction *InsertBefore = nullptr);
+  llvm::Value *getFunctionSiteId(llvm::Function &F);
+  llvm::Instruction *getSiteBase(llvm::Function &F);
+  llvm::Constant *getSiteString(llvm::Module &M, llvm::StringRef Str);
 
   llvm::Type *IntptrTy;
   llvm::IntegerType *OrdTy;
 
-  // register every new instrumented function
-  llvm::Value *funcNamePtr = NULL;
+  // Source sites of instrumented accesses and functions in this
+  // module. Each access passes (site base + index of its site) to
+  // the runtime, as does each function entry.
+  struct SourceSite {
+    std::string File;
+    std::string Function;
+    unsigned Line;
+    unsigned Column;
+  };
+  unsigned getSiteIndex(const SourceSite &Site);
+  std::vector<SourceSite> Sites;
+  std::map<std::tuple<std::string, std::string, unsigned, unsigned>,
+           unsigned> SiteIds;
+  llvm::StringMap<llvm::Constant *> SiteStrings;
+  llvm::GlobalVariable *SiteBase;
+  llvm::Value *SiteBaseValue = nullptr;  // loaded once per function
+  unsigned NumChecks = 0;                // callbacks of the module
+
+  // Memory no other task can access, whose accesses are not
+  // checked. Counted per function for -tasksan-report-eliminated.
+  enum PrivateKind {
+    NotPrivate,
+    PrivateStack,        // allocas not captured
+    PrivateTaskData,     // the task descriptor and its privates
+    PrivateHeap,         // allocations not escaping the function
+    NumPrivateKinds
+  };
+  PrivateKind getPrivateKind(llvm::Value *Addr, const llvm::DataLayout &DL);
+  unsigned PrivateCounts[NumPrivateKinds];
+
+  // Pointers to the task data of the function, and allocas which
+  // only ever hold such pointers, found by findTaskPrivateData
+  llvm::SmallPtrSet<llvm::Value *, 8> TaskPrivateValues;
+  llvm::SmallPtrSet<llvm::Value *, 8> TaskPrivateSlots;
+  const llvm::TargetLibraryInfo *TLI = nullptr;
+
+  // Functions that may run in task context, the only ones checked
+  // with -tasksan-task-context-only, and the originals of the
+  // functions cloned for task context.
+  llvm::SmallPtrSet<llvm::Function *, 32> TaskFunctions;
+  llvm::DenseMap<llvm::Function *, llvm::Function *> CloneOrigins;
+
+  // accesses whose check is moved in front of their loop, with
+  // the preheader terminator the check goes before
+  llvm::DenseMap<llvm::Instruction *, llvm::Instruction *> HoistedChecks;
 
   // Data for registering IIR file name
   llvm::Value *IIRfile;
@@ -146,6 +259,10 @@ struct TaskSanitizer : public llvm::FunctionPass {
   llvm::Function *TsanVptrUpdate;
   llvm::Function *TsanVptrLoad;
   llvm::Function *MemmoveFn, *MemcpyFn, *MemsetFn;
+  llvm::Function *TsanReadRange, *TsanWriteRange;
+  llvm::Function *TsanReadStrided;
+  llvm::Function *TsanAccessBatch;
+  llvm::StructType *BatchEntryTy;  // see common/AccessBatch.h
   llvm::Function *TsanCtorFunction;
 
 }; // end of TaskSanitizer
@@ -153,13 +270,31 @@ struct TaskSanitizer : public llvm::FunctionPass {
 
 char TaskSanitizer::ID = 1;
 
+// The pass runs before the optimizations by default. With
+// -tasksan-late-placement it runs after them, where mem2reg, SROA
+// and LICM have removed most stack spills and reloads; at -O0 the
+// optimizer does not run, so it is added there as well.
 static void registerTaskSanitizer(
   const llvm::PassManagerBuilder &,
-  llvm::legacy::PassManagerBase &PM) { PM.add(new TaskSanitizer()); }
+  llvm::legacy::PassManagerBase &PM) {
+  if (!ClLatePlacement) PM.add(new TaskSanitizer());
+}
+
+static void registerTaskSanitizerLate(
+  const llvm::PassManagerBuilder &,
+  llvm::legacy::PassManagerBase &PM) {
+  if (ClLatePlacement) PM.add(new TaskSanitizer());
+}
 
 static llvm::RegisterStandardPasses regPass(
    llvm::PassManagerBuilder::EP_EarlyAsPossible,
    registerTaskSanitizer);
+static llvm::RegisterStandardPasses regPassLate(
+   llvm::PassManagerBuilder::EP_OptimizerLast,
+   registerTaskSanitizerLate);
+static llvm::RegisterStandardPasses regPassLateO0(
+   llvm::PassManagerBuilder::EP_EnabledOnOptLevel0,
+   registerTaskSanitizerLate);
 
 void TaskSanitizer::initializeCallbacks(llvm::Module &M) {
   llvm::IRBuilder<> IRB(M.getContext());
@@ -171,9 +306,9 @@ void TaskSanitizer::initializeCallbacks(llvm::Module &M) {
       "__tasksan_register_iir_file", Attr, IRB.getVoidTy(), IRB.getInt8PtrTy()));
 
   TsanFuncEntry = checkSanitizerInterfaceFunction(M.getOrInsertFunction(
-      "__tasksan_func_entry", Attr, IRB.getVoidTy(), IRB.getInt8PtrTy()));
+      "__tasksan_func_entry", Attr, IRB.getVoidTy(), IRB.getInt32Ty()));
   TsanFuncExit = checkSanitizerInterfaceFunction(M.getOrInsertFunction(
-      "__tasksan_func_exit", Attr, IRB.getVoidTy(), IRB.getInt8PtrTy()));
+      "__tasksan_func_exit", Attr, IRB.getVoidTy()));
 
   TsanIgnoreBegin = checkSanitizerInterfaceFunction(M.getOrInsertFunction(
       "__tasksan_ignore_thread_begin", Attr, IRB.getVoidTy()));
@@ -187,12 +322,12 @@ void TaskSanitizer::initializeCallbacks(llvm::Module &M) {
   // functions to instrument floats and doubles
   llvm::LLVMContext &Ctx = M.getContext();
   TaskSanitizer_MemWriteFloat = M.getOrInsertFunction("__tasksan_write_float",
-      llvm::Type::getVoidTy(Ctx), llvm::Type::getFloatPtrTy(Ctx),
-      llvm::Type::getFloatTy(Ctx), llvm::Type::getInt8Ty(Ctx));
+      llvm::Type::getVoidTy(Ctx), llvm::Type::getInt8PtrTy(Ctx),
+      llvm::Type::getFloatTy(Ctx), llvm::Type::getInt32Ty(Ctx));
 
   TaskSanitizer_MemWriteDouble = M.getOrInsertFunction("__tasksan_write_double",
-      llvm::Type::getVoidTy(Ctx), llvm::Type::getDoublePtrTy(Ctx),
-      llvm::Type::getDoubleTy(Ctx), llvm::Type::getInt8Ty(Ctx));
+      llvm::Type::getVoidTy(Ctx), llvm::Type::getInt8PtrTy(Ctx),
+      llvm::Type::getDoubleTy(Ctx), llvm::Type::getInt32Ty(Ctx));
 
   OrdTy = IRB.getInt32Ty();
   for (size_t i = 0; i < kNumberOfAccessSizes; ++i) {
@@ -203,12 +338,12 @@ void TaskSanitizer::initializeCallbacks(llvm::Module &M) {
     llvm::SmallString<32> ReadName("__tasksan_read" + ByteSizeStr);
     TsanRead[i] = checkSanitizerInterfaceFunction(M.getOrInsertFunction(
         ReadName, Attr, IRB.getVoidTy(), IRB.getInt8PtrTy(),
-        IRB.getInt64Ty()));
+        IRB.getInt32Ty()));
 
     llvm::SmallString<32> WriteName("__tasksan_write" + ByteSizeStr);
     TsanWrite[i] = checkSanitizerInterfaceFunction(M.getOrInsertFunction(
         WriteName, Attr, IRB.getVoidTy(), IRB.getInt8PtrTy(),
-        IRB.getInt64Ty(), IRB.getInt8Ty()));
+        IRB.getInt64Ty(), IRB.getInt32Ty()));
 
     llvm::SmallString<64> UnalignedReadName("__tasksan_unaligned_read" + ByteSizeStr);
     TsanUnalignedRead[i] =
@@ -270,6 +405,25 @@ void TaskSanitizer::initializeCallbacks(llvm::Module &M) {
   TsanAtomicSignalFence = checkSanitizerInterfaceFunction(M.getOrInsertFunction(
       "__tasksan_atomic_signal_fence", Attr, IRB.getVoidTy(), OrdTy));
 
+  TsanReadRange = checkSanitizerInterfaceFunction(M.getOrInsertFunction(
+      "__tasksan_read_range", Attr, IRB.getVoidTy(), IRB.getInt8PtrTy(),
+      IntptrTy, IRB.getInt32Ty()));
+  TsanWriteRange = checkSanitizerInterfaceFunction(M.getOrInsertFunction(
+      "__tasksan_write_range", Attr, IRB.getVoidTy(), IRB.getInt8PtrTy(),
+      IntptrTy, IRB.getInt32Ty()));
+
+  TsanReadStrided = checkSanitizerInterfaceFunction(M.getOrInsertFunction(
+      "__tasksan_read_strided", Attr, IRB.getVoidTy(), IRB.getInt8PtrTy(),
+      IntptrTy, IntptrTy, IRB.getInt32Ty(), IRB.getInt32Ty()));
+
+  // address, value, site id, size, is write
+  BatchEntryTy = llvm::StructType::get(M.getContext(),
+      {IRB.getInt8PtrTy(), IRB.getInt64Ty(), IRB.getInt32Ty(),
+       IRB.getInt8Ty(), IRB.getInt8Ty()});
+  TsanAccessBatch = checkSanitizerInterfaceFunction(M.getOrInsertFunction(
+      "__tasksan_access_batch", Attr, IRB.getVoidTy(), IRB.getInt8PtrTy(),
+      IRB.getInt32Ty()));
+
   MemmoveFn = checkSanitizerInterfaceFunction(
       M.getOrInsertFunction("memmove", Attr, IRB.getInt8PtrTy(), IRB.getInt8PtrTy(),
                             IRB.getInt8PtrTy(), IntptrTy));
@@ -281,6 +435,102 @@ void TaskSanitizer::initializeCallbacks(llvm::Module &M) {
                             IRB.getInt32Ty(), IntptrTy));
 }
 
+// Finds the functions that may run in task context: the outlined
+// bodies of parallel regions and tasks, the task entries passed to
+// __kmpc_omp_task_alloc, external functions no code of this module
+// calls, and every function these call or pass on, e.g. as callback.
+// If one of them calls through a pointer, all functions whose
+// address is taken are added. A function called directly both from
+// there and from serial code gets a clone, which the calls from
+// task context are redirected to, so serial code keeps running the
+// original at native speed.
+void TaskSanitizer::findTaskContext(llvm::Module &M) {
+  std::vector<llvm::Function *> Worklist;
+  auto addTaskFunction = [&](llvm::Value *V) {
+    auto *F = llvm::dyn_cast<llvm::Function>(V->stripPointerCasts());
+    if (F && !F->isDeclaration() && TaskFunctions.insert(F).second)
+      Worklist.push_back(F);
+  };
+
+  for (llvm::Function &F : M) {
+    if (tasksan::util::isOutlinedFunction(F.getName()) ||
+        (!F.hasLocalLinkage() && F.use_empty() &&
+         !tasksan::util::isMainFunction(F)))
+      addTaskFunction(&F);
+    if (F.getName() == "__kmpc_omp_task_alloc")
+      for (llvm::User *U : F.users())
+        if (llvm::CallSite CS = llvm::CallSite(U))
+          for (llvm::Value *Arg : CS.args())
+            addTaskFunction(Arg);
+  }
+
+  bool AddressTakenAdded = false;
+  while (!Worklist.empty()) {
+    llvm::Function *F = Worklist.back();
+    Worklist.pop_back();
+    for (llvm::BasicBlock &BB : *F)
+      for (llvm::Instruction &I : BB) {
+        for (llvm::Value *Op : I.operands())
+          addTaskFunction(Op);
+        llvm::CallSite CS(&I);
+        if (CS && !CS.isInlineAsm() && !AddressTakenAdded &&
+            !llvm::isa<llvm::Function>(
+                CS.getCalledValue()->stripPointerCasts())) {
+          AddressTakenAdded = true;
+          for (llvm::Function &G : M)
+            if (G.hasAddressTaken())
+              addTaskFunction(&G);
+        }
+      }
+  }
+
+  // clones functions whose uses are all direct calls, from task
+  // context and from serial code; those whose address is taken
+  // stay as they are. Visited in module order for stable output.
+  std::vector<llvm::Function *> Candidates;
+  for (llvm::Function &F : M)
+    if (TaskFunctions.count(&F))
+      Candidates.push_back(&F);
+  std::vector<std::pair<llvm::Function *, llvm::Function *>> Clones;
+  for (llvm::Function *F : Candidates) {
+    bool Serial = !F->hasLocalLinkage(), FromTask = false, OnlyCalls = true;
+    for (llvm::User *U : F->users()) {
+      llvm::CallSite CS(U);
+      if (!CS || CS.getCalledValue() != F) {
+        OnlyCalls = false;
+        break;
+      }
+      bool InTask = TaskFunctions.count(CS.getInstruction()->getFunction());
+      FromTask |= InTask;
+      Serial |= !InTask;
+    }
+    if (!Serial || !FromTask || !OnlyCalls)
+      continue;
+
+    llvm::ValueToValueMapTy VMap;
+    llvm::Function *Clone = llvm::CloneFunction(F, VMap);
+    Clone->setName(F->getName() + ".tasksan");
+    Clone->setLinkage(llvm::GlobalValue::InternalLinkage);
+    Clone->setComdat(nullptr);
+    Clones.push_back({F, Clone});
+    CloneOrigins[Clone] = F;
+  }
+  for (auto &Pair : Clones) {
+    TaskFunctions.erase(Pair.first);
+    TaskFunctions.insert(Pair.second);
+  }
+  for (auto &Pair : Clones) {
+    std::vector<llvm::CallSite> Calls;
+    for (llvm::User *U : Pair.first->users()) {
+      llvm::CallSite CS(U);
+      if (CS && TaskFunctions.count(CS.getInstruction()->getFunction()))
+        Calls.push_back(CS);
+    }
+    for (llvm::CallSite &CS : Calls)
+      CS.setCalledFunction(Pair.second);
+  }
+}
+
 static bool isVtableAccess(llvm::Instruction *I) {
   if (llvm::MDNode *Tag = I->getMetadata(llvm::LLVMContext::MD_tbaa))
     return Tag->isTBAAVtableAccess();
@@ -380,11 +630,11 @@ void TaskSanitizer::chooseInstructionsToInstrument(
     llvm::Value *Addr = llvm::isa<llvm::StoreInst>(*I)
         ? llvm::cast<llvm::StoreInst>(I)->getPointerOperand()
         : llvm::cast<llvm::LoadInst>(I)->getPointerOperand();
-    if (llvm::isa<llvm::AllocaInst>(GetUnderlyingObject(Addr, DL)) &&
-        !PointerMayBeCaptured(Addr, true, true)) {
-      // The variable is addressable but not captured, so it cannot be
-      // referenced from a different thread and participate in a data race
-      // (see llvm/Analysis/CaptureTracking.h for details).
+    PrivateKind Kind = getPrivateKind(Addr, DL);
+    if (Kind != NotPrivate) {
+      // No other task can access the location, so it cannot
+      // participate in a determinacy race.
+      PrivateCounts[Kind]++;
       continue;
     }
     All.push_back(I);
@@ -392,6 +642,224 @@ void TaskSanitizer::chooseInstructionsToInstrument(
   Local.clear();
 }
 
+// Returns the argument a value was passed in, looking through an
+// alloca it was spilled to, or nullptr
+static llvm::Argument *getPassedArgument(llvm::Value *V) {
+  V = V->stripPointerCasts();
+  if (auto *Arg = llvm::dyn_cast<llvm::Argument>(V))
+    return Arg;
+  auto *Load = llvm::dyn_cast<llvm::LoadInst>(V);
+  if (!Load)
+    return nullptr;
+  auto *Slot = llvm::dyn_cast<llvm::AllocaInst>(
+      Load->getPointerOperand()->stripPointerCasts());
+  if (!Slot)
+    return nullptr;
+  llvm::Argument *Stored = nullptr;
+  for (llvm::User *U : Slot->users()) {
+    if (auto *Store = llvm::dyn_cast<llvm::StoreInst>(U)) {
+      auto *Arg = llvm::dyn_cast<llvm::Argument>(
+          Store->getValueOperand()->stripPointerCasts());
+      if (!Arg || (Stored && Stored != Arg) ||
+          Store->getPointerOperand() != Slot)
+        return nullptr;
+      Stored = Arg;
+    } else if (!llvm::isa<llvm::LoadInst>(U)) {
+      return nullptr;
+    }
+  }
+  return Stored;
+}
+
+// Finds the task data clang passes to outlined task bodies: the
+// kmp_task_t_with_privates argument of a .omp_task_entry. function,
+// and in the .omp_outlined. body the privates struct and the private
+// copies the .omp_task_privates_map. function hands out through
+// pointers to allocas. Each task has its own copy of all of them.
+void TaskSanitizer::findTaskPrivateData(llvm::Function &F) {
+  TaskPrivateValues.clear();
+  TaskPrivateSlots.clear();
+  auto addPrivate = [&](llvm::Value *V) {
+    V = V->stripPointerCasts();
+    TaskPrivateValues.insert(V);
+    if (auto *Load = llvm::dyn_cast<llvm::LoadInst>(V)) {
+      if (getPassedArgument(Load))
+        TaskPrivateSlots.insert(Load->getPointerOperand()->stripPointerCasts());
+      return;
+    }
+    for (llvm::User *U : V->users())  // spilled to an alloca at -O0
+      if (auto *Store = llvm::dyn_cast<llvm::StoreInst>(U))
+        if (Store->getValueOperand() == V) {
+          llvm::Value *Slot = Store->getPointerOperand()->stripPointerCasts();
+          if (llvm::isa<llvm::AllocaInst>(Slot))
+            TaskPrivateSlots.insert(Slot);
+        }
+  };
+
+  if (F.getName().find(".omp_task_entry.") != llvm::StringRef::npos &&
+      F.arg_size() > 1)
+    addPrivate(&*std::next(F.arg_begin()));
+  if (F.getName().find(".omp_outlined.") == llvm::StringRef::npos)
+    return;
+
+  // the parameter the task entries pass the privates map in
+  int MapIndex = -1;
+  for (llvm::User *U : F.users()) {
+    llvm::CallSite CS(U);
+    if (!CS || CS.getCalledValue() != &F)
+      continue;
+    for (unsigned i = 0; i < CS.arg_size(); i++) {
+      auto *Map = llvm::dyn_cast<llvm::Function>(
+          CS.getArgument(i)->stripPointerCasts());
+      if (Map && Map->getName().find(".omp_task_privates_map.") !=
+                     llvm::StringRef::npos)
+        MapIndex = i;
+    }
+  }
+  if (MapIndex < 0)
+    return;
+
+  for (llvm::BasicBlock &BB : F)
+    for (llvm::Instruction &I : BB) {
+      llvm::CallSite CS(&I);
+      if (!CS || CS.arg_size() == 0)
+        continue;
+      llvm::Argument *Callee = getPassedArgument(CS.getCalledValue());
+      if (!Callee || (int)Callee->getArgNo() != MapIndex)
+        continue;
+      addPrivate(CS.getArgument(0));  // the privates struct
+      for (unsigned i = 1; i < CS.arg_size(); i++) {
+        llvm::Value *Slot = CS.getArgument(i)->stripPointerCasts();
+        if (llvm::isa<llvm::AllocaInst>(Slot))
+          TaskPrivateSlots.insert(Slot);
+      }
+    }
+}
+
+// Returns true if V points to the task data of the function
+bool TaskSanitizer::isTaskPrivatePointer(llvm::Value *V) {
+  if (TaskPrivateValues.count(V))
+    return true;
+  auto *Load = llvm::dyn_cast<llvm::LoadInst>(V);
+  return Load &&
+      TaskPrivateSlots.count(Load->getPointerOperand()->stripPointerCasts());
+}
+
+// Returns the value stored to an alloca that only holds one value,
+// as clang spills pointers at -O0: all its users are loads and
+// stores of that value to it. nullptr otherwise.
+static llvm::Value *getSpilledValue(llvm::Value *Slot) {
+  if (!llvm::isa<llvm::AllocaInst>(Slot))
+    return nullptr;
+  llvm::Value *Stored = nullptr;
+  for (llvm::User *U : Slot->users()) {
+    if (auto *Store = llvm::dyn_cast<llvm::StoreInst>(U)) {
+      llvm::Value *Val = Store->getValueOperand()->stripPointerCasts();
+      if ((Stored && Stored != Val) || Store->getPointerOperand() != Slot)
+        return nullptr;
+      Stored = Val;
+    } else if (!llvm::isa<llvm::LoadInst>(U)) {
+      return nullptr;
+    }
+  }
+  return Stored;
+}
+
+// Returns true if V is an allocation whose pointer does not leave
+// the function: it is only the address of loads, stores and memory
+// intrinsics, compared or freed. A load of the pointer from the
+// alloca it was spilled to counts as the allocation.
+bool TaskSanitizer::isLocalAllocation(llvm::Value *V) {
+  if (auto *Load = llvm::dyn_cast<llvm::LoadInst>(V))
+    if (llvm::Value *Spilled =
+            getSpilledValue(Load->getPointerOperand()->stripPointerCasts()))
+      V = Spilled;
+  if (!llvm::isAllocationFn(V, TLI))
+    return false;
+  llvm::SmallVector<llvm::Value *, 8> Worklist;
+  llvm::SmallPtrSet<llvm::Value *, 8> Visited;
+  Worklist.push_back(V);
+  while (!Worklist.empty()) {
+    llvm::Value *Ptr = Worklist.pop_back_val();
+    for (llvm::User *U : Ptr->users()) {
+      if (auto *Store = llvm::dyn_cast<llvm::StoreInst>(U)) {
+        if (Store->getValueOperand() != Ptr)
+          continue;
+        // a spill: follow the reloads of the pointer
+        llvm::Value *Slot = Store->getPointerOperand()->stripPointerCasts();
+        if (getSpilledValue(Slot) != V)
+          return false;
+        for (llvm::User *SlotUser : Slot->users())
+          if (llvm::isa<llvm::LoadInst>(SlotUser) &&
+              Visited.insert(SlotUser).second)
+            Worklist.push_back(SlotUser);
+      } else if (llvm::isa<llvm::GetElementPtrInst>(U) ||
+                 llvm::isa<llvm::BitCastInst>(U)) {
+        if (Visited.insert(U).second)
+          Worklist.push_back(U);
+      } else if (!llvm::isa<llvm::LoadInst>(U) &&
+                 !llvm::isa<llvm::MemIntrinsic>(U) &&
+                 !llvm::isa<llvm::DbgInfoIntrinsic>(U) &&
+                 !llvm::isa<llvm::ICmpInst>(U) &&
+                 !llvm::isFreeCall(U, TLI)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Tells which kind of task-private memory an address points to
+TaskSanitizer::PrivateKind
+TaskSanitizer::getPrivateKind(llvm::Value *Addr, const llvm::DataLayout &DL) {
+  llvm::Value *Object = GetUnderlyingObject(Addr, DL);
+  if (llvm::isa<llvm::AllocaInst>(Object) &&
+      !PointerMayBeCaptured(Addr, true, true)) {
+    // The variable is addressable but not captured, so it cannot be
+    // referenced from a different thread and participate in a data race
+    // (see llvm/Analysis/CaptureTracking.h for details).
+    return PrivateStack;
+  }
+  // thread_local and threadprivate variables are not private to a
+  // task: the tasks run by one thread share them.
+  if (isTaskPrivatePointer(Object))
+    return PrivateTaskData;
+  if (isLocalAllocation(Object))
+    return PrivateHeap;
+  return NotPrivate;
+}
+
+// Returns the number of bytes an access through Addr touches
+static uint64_t getAccessSize(llvm::Value *Addr, const llvm::DataLayout &DL) {
+  llvm::Type *Ty =
+      llvm::cast<llvm::PointerType>(Addr->getType())->getElementType();
+  return DL.getTypeStoreSize(Ty);
+}
+
+// Returns true if the checker can compare written values of the
+// type, i.e. for scalars of at most 64 bits. Other writes, such as
+// those of vectors and aggregates, are reported as ranges.
+static bool hasComparedValue(llvm::Type *Ty, const llvm::DataLayout &DL) {
+  return (Ty->isIntegerTy() || Ty->isFloatingPointTy() ||
+          Ty->isPointerTy()) && DL.getTypeSizeInBits(Ty) <= 64;
+}
+
+// Returns the written value as the checker compares it: the bits
+// of floating point values, as __tasksan_write_float does
+static llvm::Value *getComparedValue(llvm::IRBuilder<> &IRB,
+                                     llvm::Value *Val) {
+  llvm::Type *Ty = Val->getType();
+  if (Ty->isFloatingPointTy())
+    return IRB.CreateZExt(
+        IRB.CreateBitCast(Val, IRB.getIntNTy(Ty->getPrimitiveSizeInBits())),
+        IRB.getInt64Ty());
+  if (Ty->isIntegerTy())
+    return IRB.CreateIntCast(Val, IRB.getInt64Ty(), true);
+  if (Ty->isPointerTy())
+    return IRB.CreatePtrToInt(Val, IRB.getInt64Ty());
+  llvm_unreachable("value the checker cannot compare");
+}
+
 static bool isAtomic(llvm::Instruction *I) {
   // TODO: Ask TTI whether synchronization scope is between threads.
   if (llvm::LoadInst *LI = llvm::dyn_cast<llvm::LoadInst>(I))
@@ -426,10 +894,7 @@ bool TaskSanitizer::runOnFunction(llvm::Function &F) {
 
   tasksan::IIRlog::logTaskBody(F, tasksan::util::getPlainFuncName(F));
 
-  // Register function name
-  llvm::StringRef funcName = tasksan::util::demangleName(F.getName());
-  llvm::IRBuilder<> IRB(F.getEntryBlock().getFirstNonPHI());
-  funcNamePtr = IRB.CreateGlobalStringPtr(funcName, "functionName");
+  SiteBaseValue = nullptr;
 
   initializeCallbacks(*F.getParent());
   llvm::SmallVector<llvm::Instruction*, 8> AllLoadsAndStores;
@@ -438,10 +903,13 @@ bool TaskSanitizer::runOnFunction(llvm::Function &F) {
   llvm::SmallVector<llvm::Instruction*, 8> MemIntrinCalls;
 
   bool HasCalls = false;
-  bool SanitizeFunction = true; //HASSAN F.hasFnAttribute(Attribute::SanitizeThread);
+  // code only serial parts of the program run is not checked
+  bool TaskContext = !ClTaskContextOnly || TaskFunctions.count(&F);
+  bool SanitizeFunction = TaskContext; //HASSAN F.hasFnAttribute(Attribute::SanitizeThread);
   const llvm::DataLayout &DL = F.getParent()->getDataLayout();
-  const llvm::TargetLibraryInfo *TLI =
-      &getAnalysis<llvm::TargetLibraryInfoWrapperPass>().getTLI();
+  TLI = &getAnalysis<llvm::TargetLibraryInfoWrapperPass>().getTLI();
+  std::fill(PrivateCounts, PrivateCounts + NumPrivateKinds, 0);
+  findTaskPrivateData(F);
 
   // Traverse all instructions, collect loads/stores/returns, check for calls.
   for (auto &BB : F) {
@@ -467,10 +935,33 @@ bool TaskSanitizer::runOnFunction(llvm::Function &F) {
   // FIXME: many of these accesses do not need to be checked for races
   // (e.g. variables that do not escape, etc).
 
+  if (ClReportEliminated && SanitizeFunction)
+    llvm::errs() << "TaskSanitizer: " << tasksan::util::getPlainFuncName(F)
+                 << ": skipped task-private accesses: "
+                 << PrivateCounts[PrivateStack] << " stack, "
+                 << PrivateCounts[PrivateTaskData] << " task data, "
+                 << PrivateCounts[PrivateHeap] << " task-local heap\n";
+
+  HoistedChecks.clear();
+  if (ClInstrumentMemoryAccesses && ClEliminateRedundant && SanitizeFunction)
+    eliminateRedundantAccesses(F, AllLoadsAndStores, DL);
+
+  // Accesses of loops reported once per loop as strided ranges
+  // are not instrumented one by one.
+  if (ClInstrumentMemoryAccesses && ClSummarizeLoops && SanitizeFunction)
+    Res |= summarizeLoopAccesses(AllLoadsAndStores, DL);
+
+  // Accesses of straight-line code are reported by one call
+  if (ClInstrumentMemoryAccesses && ClBatchAccesses && SanitizeFunction)
+    Res |= batchAccesses(F, AllLoadsAndStores, DL);
+
   // Instrument memory accesses only if we want to report bugs in the function.
   if (ClInstrumentMemoryAccesses && SanitizeFunction)
     for (auto Inst : AllLoadsAndStores) {
-      Res |= instrumentLoadOrStore(Inst, DL);
+      if (instrumentLoadOrStore(Inst, DL)) {
+        NumChecks++;
+        Res = true;
+      }
     }
 
   // Instrument atomic memory accesses in any case (they can be used to
@@ -502,17 +993,19 @@ bool TaskSanitizer::runOnFunction(llvm::Function &F) {
                    IRB.CreatePointerCast(IIRfile, IRB.getInt8PtrTy()));
   }
 
-  // Instrument function entry/exit points if there were instrumented accesses.
-  if ((Res || HasCalls) && ClInstrumentFuncEntryExit) {
-    llvm::IRBuilder<> IRB(F.getEntryBlock().getFirstNonPHI());
-    llvm::Value *ReturnAddress = IRB.CreateCall(
-        llvm::Intrinsic::getDeclaration(F.getParent(), llvm::Intrinsic::returnaddress),
-        IRB.getInt32(0));
-    IRB.CreateCall(TsanFuncEntry, ReturnAddress);
+  // Instrument function entry/exit points if there were instrumented
+  // accesses. They push and pop the frame of the function on the
+  // call stack of the task, which race reports print.
+  if ((Res || HasCalls) && ClInstrumentFuncEntryExit && TaskContext) {
+    llvm::Value *SiteId = getFunctionSiteId(F);
+    auto *SiteIdInst = llvm::dyn_cast<llvm::Instruction>(SiteId);
+    llvm::IRBuilder<> IRB(SiteIdInst ? SiteIdInst->getNextNode()
+                                     : F.getEntryBlock().getFirstNonPHI());
+    IRB.CreateCall(TsanFuncEntry, SiteId);
 
     llvm::EscapeEnumerator EE(F, "tasksan_cleanup", ClHandleCxxExceptions);
     while (llvm::IRBuilder<> *AtExit = EE.Next()) {
-      AtExit->CreateCall(TsanFuncExit, {funcNamePtr});
+      AtExit->CreateCall(TsanFuncExit, {});
     }
     Res = true;
   }
@@ -521,7 +1014,8 @@ bool TaskSanitizer::runOnFunction(llvm::Function &F) {
 
 bool TaskSanitizer::instrumentLoadOrStore(llvm::Instruction *I,
                                             const llvm::DataLayout &DL) {
-  llvm::IRBuilder<> IRB(I);
+  llvm::Instruction *InsertPt = HoistedChecks.lookup(I);
+  llvm::IRBuilder<> IRB(InsertPt ? InsertPt : I);
   bool is_write_action = llvm::isa<llvm::StoreInst>(*I);
   llvm::Value *Addr = is_write_action
       ? llvm::cast<llvm::StoreInst>(I)->getPointerOperand()
@@ -533,9 +1027,25 @@ bool TaskSanitizer::instrumentLoadOrStore(llvm::Instruction *I,
   if (Addr->isSwiftError())
     return false;
 
-  int Idx = getMemoryAccessFuncIndex(Addr, DL);
-  if (Idx < 0)
+  // accesses without a source location are not reported
+  if (!I->getDebugLoc())
     return false;
+
+  int Idx = getMemoryAccessFuncIndex(Addr, DL);
+  bool Compared = !is_write_action || isVtableAccess(I) ||
+      hasComparedValue(
+          llvm::cast<llvm::StoreInst>(I)->getValueOperand()->getType(), DL);
+  if (Idx < 0 || !Compared) {
+    // vectors and other sizes without a callback, which are common
+    // after the optimizations, are reported as ranges, as are writes
+    // of values the checker cannot compare
+    IRB.CreateCall(is_write_action ? TsanWriteRange : TsanReadRange,
+        {IRB.CreatePointerCast(Addr, IRB.getInt8PtrTy()),
+         llvm::ConstantInt::get(IntptrTy, getAccessSize(Addr, DL)),
+         getSiteId(I, InsertPt)});
+    return true;
+  }
+
   if (is_write_action && isVtableAccess(I)) {
     llvm::dbgs() << "  VPTR : " << *I << "\n";
     llvm::Value *StoredValue = llvm::cast<llvm::StoreInst>(I)->getValueOperand();
@@ -569,31 +1079,527 @@ bool TaskSanitizer::instrumentLoadOrStore(llvm::Instruction *I,
   else
     OnAccessFunc = is_write_action ? TsanUnalignedWrite[Idx] : TsanUnalignedRead[Idx];
 
+  llvm::Value *SiteId = getSiteId(I, InsertPt);
   if (is_write_action) {
       llvm::Value *Val = llvm::cast<llvm::StoreInst>(I)->getValueOperand();
       if ( Val->getType()->isFloatTy() )
           OnAccessFunc = TaskSanitizer_MemWriteFloat;
       else if ( Val->getType()->isDoubleTy() )
           OnAccessFunc = TaskSanitizer_MemWriteDouble;
+      else
+          Val = getComparedValue(IRB, Val);
 
       IRB.CreateCall(OnAccessFunc,
-          {IRB.CreatePointerCast(Addr, IRB.getInt8PtrTy()), Val,
-           IRB.CreateIntCast(tasksan::debug::getLineNumber(I),
-                             IRB.getInt8Ty(),
-                             false),
-           IRB.CreatePointerCast(funcNamePtr, IRB.getInt8PtrTy())});
+          {IRB.CreatePointerCast(Addr, IRB.getInt8PtrTy()), Val, SiteId});
   } else {
     IRB.CreateCall(OnAccessFunc,
-        {IRB.CreatePointerCast(Addr, IRB.getInt8PtrTy()),
-         IRB.CreateIntCast(tasksan::debug::getLineNumber(I),
-                           IRB.getInt8Ty(),
-                           false),
-         IRB.CreatePointerCast(funcNamePtr, IRB.getInt8PtrTy())});
+        {IRB.CreatePointerCast(Addr, IRB.getInt8PtrTy()), SiteId});
   }
 
   return true;
 }
 
+// Returns true if an instruction may start, end or wait for a
+// task, which ends the task segment of the accesses before it.
+// These are calls that may write memory, among them all calls of
+// the OpenMP runtime such as __kmpc_omp_task and taskwait.
+static bool isTaskBoundary(llvm::Instruction *I) {
+  if (!llvm::isa<llvm::CallInst>(I) && !llvm::isa<llvm::InvokeInst>(I))
+    return false;
+  if (llvm::isa<llvm::IntrinsicInst>(I))
+    return false;
+  return !llvm::CallSite(I).onlyReadsMemory();
+}
+
+// Returns the memory state an instruction starts from: the last
+// MemoryDef before it, or the MemoryPhi of a block it joins at.
+// MemorySSA optimizes MemoryUses past the defs that do not clobber
+// their location, task boundaries among them, so the state is found
+// from the instructions before I and the blocks that dominate it.
+static llvm::MemoryAccess *getStateBefore(llvm::MemorySSA &MSSA,
+                                          llvm::DominatorTree &DT,
+                                          llvm::Instruction *I) {
+  llvm::BasicBlock *BB = I->getParent();
+  llvm::BasicBlock::iterator It = I->getIterator();
+  while (true) {
+    while (It != BB->begin()) {
+      --It;
+      if (auto *Def = llvm::dyn_cast_or_null<llvm::MemoryDef>(
+              MSSA.getMemoryAccess(&*It)))
+        return Def;
+    }
+    if (llvm::MemoryPhi *Phi = MSSA.getMemoryAccess(BB))
+      return Phi;
+    llvm::DomTreeNode *IDom = DT.getNode(BB)->getIDom();
+    if (!IDom)
+      return MSSA.getLiveOnEntryDef();
+    BB = IDom->getBlock();
+    It = BB->end();
+  }
+}
+
+// Returns true if no task boundary lies between J and I, which J
+// dominates. The MemoryDefs before I are followed back to the
+// memory state after J; a MemoryPhi means paths joined in between,
+// which is given up on.
+static bool isSameTaskSegment(llvm::MemorySSA &MSSA, llvm::DominatorTree &DT,
+                              llvm::Instruction *J, llvm::Instruction *I) {
+  llvm::MemoryUseOrDef *JAccess = MSSA.getMemoryAccess(J);
+  if (!JAccess || !MSSA.getMemoryAccess(I))
+    return false;
+  llvm::MemoryAccess *AfterJ = llvm::isa<llvm::MemoryDef>(JAccess)
+      ? JAccess : getStateBefore(MSSA, DT, J);
+  llvm::MemoryAccess *Access = getStateBefore(MSSA, DT, I);
+  while (Access != AfterJ) {
+    auto *Def = llvm::dyn_cast<llvm::MemoryDef>(Access);
+    if (!Def || MSSA.isLiveOnEntryDef(Def) ||
+        isTaskBoundary(Def->getMemoryInst()))
+      return false;
+    Access = Def->getDefiningAccess();
+  }
+  return true;
+}
+
+// Removes the checks that cannot report anything new and moves
+// checks of loop invariant addresses in front of their loop:
+//  - an access is dropped if a dominating access of the same kind,
+//    size and address, storing the same value if a write, runs in
+//    the same task segment before it on every path;
+//  - an access of a loop invariant address run on every iteration
+//    of a loop without task boundaries is checked once before it.
+void TaskSanitizer::eliminateRedundantAccesses(llvm::Function &F,
+    llvm::SmallVectorImpl<llvm::Instruction *> &All,
+    const llvm::DataLayout &DL) {
+  llvm::DominatorTree &DT =
+      getAnalysis<llvm::DominatorTreeWrapperPass>().getDomTree();
+  llvm::LoopInfo &LI = getAnalysis<llvm::LoopInfoWrapperPass>().getLoopInfo();
+  llvm::MemorySSA &MSSA = getAnalysis<llvm::MemorySSAWrapperPass>().getMSSA();
+
+  auto getAddr = [](llvm::Instruction *I) {
+    return llvm::isa<llvm::StoreInst>(*I)
+        ? llvm::cast<llvm::StoreInst>(I)->getPointerOperand()
+        : llvm::cast<llvm::LoadInst>(I)->getPointerOperand();
+  };
+  // the stored value of writes, nullptr for reads
+  auto getStored = [](llvm::Instruction *I) -> llvm::Value * {
+    auto *Store = llvm::dyn_cast<llvm::StoreInst>(I);
+    return Store ? Store->getValueOperand() : nullptr;
+  };
+
+  llvm::DenseMap<llvm::Value *, llvm::SmallVector<llvm::Instruction *, 4>>
+      ByAddress;
+  for (llvm::Instruction *I : All)
+    ByAddress[getAddr(I)->stripPointerCasts()].push_back(I);
+
+  // A dropped access was dominated by a check too, which then
+  // dominates the accesses it dominates, so comparing against all
+  // accesses of the address, kept or not, is enough.
+  size_t Removed = 0, Hoisted = 0;
+  llvm::SmallVector<llvm::Instruction *, 8> Rest;
+  for (llvm::Instruction *I : All) {
+    bool Redundant = false;
+    for (llvm::Instruction *J : ByAddress[getAddr(I)->stripPointerCasts()]) {
+      if (J != I && getStored(J) == getStored(I) &&
+          getAccessSize(getAddr(J), DL) == getAccessSize(getAddr(I), DL) &&
+          DT.dominates(J, I) && isSameTaskSegment(MSSA, DT, J, I)) {
+        Redundant = true;
+        break;
+      }
+    }
+    if (Redundant)
+      Removed++;
+    else
+      Rest.push_back(I);
+  }
+  All.swap(Rest);
+
+  llvm::DenseMap<llvm::Loop *, bool> HasBoundary;
+  for (llvm::Instruction *I : All) {
+    llvm::Loop *L = LI.getLoopFor(I->getParent());
+    if (!L || !L->getLoopPreheader() || !L->getLoopLatch() ||
+        L->getExitingBlock() != L->getLoopLatch() ||
+        !DT.dominates(I->getParent(), L->getLoopLatch()) ||
+        !L->isLoopInvariant(getAddr(I)) ||
+        (getStored(I) && !L->isLoopInvariant(getStored(I))) ||
+        isVtableAccess(I))
+      continue;
+
+    auto Known = HasBoundary.find(L);
+    if (Known == HasBoundary.end()) {
+      bool Boundary = false;
+      for (llvm::BasicBlock *BB : L->blocks())
+        for (llvm::Instruction &Inst : *BB)
+          Boundary |= isTaskBoundary(&Inst) || isAtomic(&Inst);
+      Known = HasBoundary.insert({L, Boundary}).first;
+    }
+    if (Known->second)
+      continue;
+    HoistedChecks[I] = L->getLoopPreheader()->getTerminator();
+    Hoisted++;
+  }
+
+  if (ClReportEliminated)
+    llvm::errs() << "TaskSanitizer: " << tasksan::util::getPlainFuncName(F)
+                 << ": removed " << Removed << " of " << Removed + All.size()
+                 << " access checks, hoisted " << Hoisted
+                 << " out of loops\n";
+}
+
+// Returns true if the trip count of a loop is known on entry and
+// every iteration of it runs the same task segment: it has one exit,
+// at its latch, and no calls, which could start or wait for tasks.
+bool TaskSanitizer::isSummarizableLoop(llvm::Loop *L,
+                                       llvm::ScalarEvolution &SE,
+                                       const llvm::DataLayout &DL) {
+  llvm::BasicBlock *Latch = L->getLoopLatch();
+  if (!L->getLoopPreheader() || !Latch || L->getExitingBlock() != Latch)
+    return false;
+
+  const llvm::SCEV *BackedgeCount = SE.getBackedgeTakenCount(L);
+  if (llvm::isa<llvm::SCEVCouldNotCompute>(BackedgeCount) ||
+      !llvm::isSafeToExpand(BackedgeCount, SE) ||
+      SE.getTypeSizeInBits(BackedgeCount->getType()) >
+          DL.getTypeSizeInBits(IntptrTy))
+    return false;
+
+  for (llvm::BasicBlock *BB : L->blocks())
+    for (llvm::Instruction &Inst : *BB) {
+      if (isAtomic(&Inst))
+        return false;
+      if ((llvm::isa<llvm::CallInst>(Inst) || llvm::isa<llvm::InvokeInst>(Inst))
+          && !llvm::isa<llvm::IntrinsicInst>(Inst))
+        return false;
+    }
+  return true;
+}
+
+// Reports the loads of a loop whose addresses ScalarEvolution
+// sees as {start,+,stride} of the loop, such as those of array
+// loops, by one __tasksan_read_strided call in the loop preheader
+// instead of one callback per iteration. Only loads run on every
+// iteration are summarized, so the call reports exactly the reads
+// of the loop. Stores keep their per-element checks: a strided
+// range carries no values, so parallel writes of equal values,
+// which are not races, could not be told apart from racy ones.
+// Summarized accesses are removed from All.
+bool TaskSanitizer::summarizeLoopAccesses(
+    llvm::SmallVectorImpl<llvm::Instruction *> &All,
+    const llvm::DataLayout &DL) {
+  llvm::LoopInfo &LI = getAnalysis<llvm::LoopInfoWrapperPass>().getLoopInfo();
+  llvm::ScalarEvolution &SE =
+      getAnalysis<llvm::ScalarEvolutionWrapperPass>().getSE();
+  llvm::DominatorTree &DT =
+      getAnalysis<llvm::DominatorTreeWrapperPass>().getDomTree();
+  llvm::SCEVExpander Expander(SE, DL, "tasksan");
+  llvm::DenseMap<llvm::Loop *, bool> Summarizable;
+
+  bool Res = false;
+  llvm::SmallVector<llvm::Instruction *, 8> Rest;
+  for (llvm::Instruction *I : All) {
+    auto *Load = llvm::dyn_cast<llvm::LoadInst>(I);
+    if (!Load) {
+      Rest.push_back(I);
+      continue;
+    }
+    llvm::Value *Addr = Load->getPointerOperand();
+    llvm::Loop *L = LI.getLoopFor(I->getParent());
+    int Idx = getMemoryAccessFuncIndex(Addr, DL);
+    if (!L || Idx < 0 || !I->getDebugLoc() || Addr->isSwiftError()) {
+      Rest.push_back(I);
+      continue;
+    }
+
+    auto Known = Summarizable.find(L);
+    if (Known == Summarizable.end())
+      Known = Summarizable.insert({L, isSummarizableLoop(L, SE, DL)}).first;
+    auto *AddRec = llvm::dyn_cast<llvm::SCEVAddRecExpr>(SE.getSCEV(Addr));
+    if (!Known->second || !DT.dominates(I->getParent(), L->getLoopLatch()) ||
+        !AddRec || AddRec->getLoop() != L || !AddRec->isAffine() ||
+        !llvm::isa<llvm::SCEVConstant>(AddRec->getStepRecurrence(SE)) ||
+        !llvm::isSafeToExpand(AddRec->getStart(), SE)) {
+      Rest.push_back(I);
+      continue;
+    }
+
+    llvm::Instruction *InsertPt = L->getLoopPreheader()->getTerminator();
+    llvm::IRBuilder<> IRB(InsertPt);
+    llvm::Value *Base = Expander.expandCodeFor(AddRec->getStart(),
+                                               IRB.getInt8PtrTy(), InsertPt);
+    const llvm::SCEV *Trips = SE.getAddExpr(
+        SE.getNoopOrZeroExtend(SE.getBackedgeTakenCount(L), IntptrTy),
+        SE.getOne(IntptrTy));
+    llvm::Value *Count = Expander.expandCodeFor(Trips, IntptrTy, InsertPt);
+    auto *Step = llvm::cast<llvm::SCEVConstant>(AddRec->getStepRecurrence(SE));
+    IRB.CreateCall(TsanReadStrided,
+        {Base,
+         llvm::ConstantInt::get(IntptrTy, Step->getAPInt().getSExtValue()),
+         Count, IRB.getInt32(1U << Idx), getSiteId(I, InsertPt)});
+    NumChecks++;
+    Res = true;
+  }
+  All.swap(Rest);
+  return Res;
+}
+
+// Returns true if accesses before I and after it may belong to
+// different task segments or the batch must be reported by then
+static bool isBatchBoundary(llvm::Instruction *I) {
+  if ((llvm::isa<llvm::CallInst>(I) || llvm::isa<llvm::InvokeInst>(I)) &&
+      !llvm::isa<llvm::IntrinsicInst>(I))
+    return true;
+  return isAtomic(I) || llvm::isa<llvm::TerminatorInst>(I);
+}
+
+// Collects the accesses of straight-line code, from the start of
+// a basic block or a call up to the next call, atomic or the end
+// of the block, in a stack array of entries (see
+// common/AccessBatch.h) and reports them by one
+// __tasksan_access_batch call at that point, so that the runtime
+// looks up the task once for all of them. Regions of a single
+// access keep their callback. Batched accesses are removed from All.
+bool TaskSanitizer::batchAccesses(llvm::Function &F,
+    llvm::SmallVectorImpl<llvm::Instruction *> &All,
+    const llvm::DataLayout &DL) {
+  llvm::SmallPtrSet<llvm::Instruction *, 16> Batchable;
+  for (llvm::Instruction *I : All) {
+    bool IsWrite = llvm::isa<llvm::StoreInst>(*I);
+    llvm::Value *Addr = IsWrite
+        ? llvm::cast<llvm::StoreInst>(I)->getPointerOperand()
+        : llvm::cast<llvm::LoadInst>(I)->getPointerOperand();
+    unsigned Alignment = IsWrite
+        ? llvm::cast<llvm::StoreInst>(I)->getAlignment()
+        : llvm::cast<llvm::LoadInst>(I)->getAlignment();
+    uint64_t Size = getAccessSize(Addr, DL);
+    // hoisted, vtable, odd-sized and unaligned accesses keep theirs,
+    // as do writes of values the checker cannot compare
+    if (HoistedChecks.count(I) || !I->getDebugLoc() ||
+        Addr->isSwiftError() || isVtableAccess(I) ||
+        getMemoryAccessFuncIndex(Addr, DL) < 0 ||
+        (IsWrite && !hasComparedValue(
+             llvm::cast<llvm::StoreInst>(I)->getValueOperand()->getType(),
+             DL)) ||
+        (Alignment != 0 && Alignment < 8 && Alignment % Size != 0))
+      continue;
+    Batchable.insert(I);
+  }
+
+  // the regions, each reported before its end instruction
+  typedef std::pair<llvm::SmallVector<llvm::Instruction *, 8>,
+                    llvm::Instruction *> Region;
+  llvm::SmallVector<Region, 8> Regions;
+  unsigned MaxSize = 0;
+  for (llvm::BasicBlock &BB : F) {
+    Region Current;
+    for (llvm::Instruction &Inst : BB) {
+      bool Full = Current.first.size() == kMaxBatchSize;
+      if (!Full && !isBatchBoundary(&Inst)) {
+        if (Batchable.count(&Inst))
+          Current.first.push_back(&Inst);
+        continue;
+      }
+      if (Current.first.size() > 1) {
+        Current.second = &Inst;
+        MaxSize = std::max<unsigned>(MaxSize, Current.first.size());
+        Regions.push_back(Current);
+      }
+      Current.first.clear();
+      if (Full && Batchable.count(&Inst))
+        Current.first.push_back(&Inst);
+    }
+  }
+  if (Regions.empty())
+    return false;
+
+  llvm::IRBuilder<> EntryIRB(F.getEntryBlock().getFirstNonPHI());
+  llvm::Value *Batch = EntryIRB.CreateAlloca(
+      llvm::ArrayType::get(BatchEntryTy, MaxSize), nullptr, "tasksan.batch");
+  llvm::Type *BatchTy = llvm::cast<llvm::AllocaInst>(Batch)->getAllocatedType();
+
+  llvm::SmallPtrSet<llvm::Instruction *, 16> Batched;
+  for (Region &R : Regions) {
+    for (unsigned K = 0; K < R.first.size(); K++) {
+      llvm::Instruction *I = R.first[K];
+      bool IsWrite = llvm::isa<llvm::StoreInst>(*I);
+      llvm::Value *Addr = IsWrite
+          ? llvm::cast<llvm::StoreInst>(I)->getPointerOperand()
+          : llvm::cast<llvm::LoadInst>(I)->getPointerOperand();
+      llvm::IRBuilder<> IRB(I);
+      llvm::Value *Entry = IRB.CreateConstGEP2_32(BatchTy, Batch, 0, K);
+      llvm::Value *Fields[] = {
+          IRB.CreatePointerCast(Addr, IRB.getInt8PtrTy()),
+          IsWrite ? getComparedValue(IRB,
+                        llvm::cast<llvm::StoreInst>(I)->getValueOperand())
+                  : IRB.getInt64(0),
+          getSiteId(I),
+          IRB.getInt8(getAccessSize(Addr, DL)),
+          IRB.getInt8(IsWrite)};
+      for (unsigned Field = 0; Field < 5; Field++)
+        IRB.CreateStore(Fields[Field],
+                        IRB.CreateStructGEP(BatchEntryTy, Entry, Field));
+      Batched.insert(I);
+    }
+    llvm::IRBuilder<> IRB(R.second);
+    IRB.CreateCall(TsanAccessBatch,
+        {IRB.CreatePointerCast(Batch, IRB.getInt8PtrTy()),
+         IRB.getInt32(R.first.size())});
+    NumChecks++;
+  }
+
+  if (ClReportEliminated)
+    llvm::errs() << "TaskSanitizer: " << tasksan::util::getPlainFuncName(F)
+                 << ": batched " << Batched.size() << " access checks into "
+                 << Regions.size() << " calls\n";
+
+  llvm::SmallVector<llvm::Instruction *, 8> Rest;
+  for (llvm::Instruction *I : All)
+    if (!Batched.count(I))
+      Rest.push_back(I);
+  All.swap(Rest);
+  return true;
+}
+
+// Returns the site id of an instrumented access as
+// (site base of the module + index of the site in the table),
+// computed before InsertBefore if given, else before the access.
+llvm::Value *TaskSanitizer::getSiteId(llvm::Instruction *I,
+                                      llvm::Instruction *InsertBefore) {
+  llvm::DebugLoc Loc = I->getDebugLoc();
+  llvm::Function *Origin = CloneOrigins.lookup(I->getFunction());
+  llvm::Function &F = Origin ? *Origin : *I->getFunction();
+
+  // Optimizations leave line 0 on code they merge or move; the
+  // closest earlier line of the block is reported instead.
+  for (llvm::Instruction *Prev = I->getPrevNode();
+       Loc.getLine() == 0 && Prev; Prev = Prev->getPrevNode())
+    if (Prev->getDebugLoc() && Prev->getDebugLoc().getLine())
+      Loc = Prev->getDebugLoc();
+
+  SourceSite Site;
+  Site.Function = tasksan::util::getPlainFuncName(F).str();
+  // inlined code is reported in the function it came from
+  if (Loc.getInlinedAt())
+    if (auto *Scope = llvm::dyn_cast<llvm::DILocalScope>(Loc.getScope()))
+      Site.Function = Scope->getSubprogram()->getName().str();
+  Site.Line = Loc.getLine();
+  Site.Column = Loc.getCol();
+  Site.File = "Unknown";
+  if (auto *Scope = llvm::dyn_cast<llvm::DIScope>(Loc.getScope())) {
+    std::string Dir = Scope->getDirectory().str();
+    std::string File = Scope->getFilename().str();
+    Site.File = tasksan::debug::createAbsoluteFileName(Dir, File);
+  }
+
+  unsigned Index = getSiteIndex(Site);
+  getSiteBase(*I->getFunction());
+  llvm::IRBuilder<> IRB(InsertBefore ? InsertBefore : I);
+  return IRB.CreateAdd(SiteBaseValue, IRB.getInt32(Index));
+}
+
+// Returns the site id of a function, the line of its definition,
+// which its frames on the call stacks of tasks carry. It is
+// computed right after the site base is loaded; 0 (unknown site)
+// if the function has no debug info.
+llvm::Value *TaskSanitizer::getFunctionSiteId(llvm::Function &F) {
+  llvm::DISubprogram *SP = F.getSubprogram();
+  if (!SP)
+    return llvm::ConstantInt::get(llvm::Type::getInt32Ty(F.getContext()), 0);
+
+  llvm::Function *Origin = CloneOrigins.lookup(&F);
+  SourceSite Site;
+  Site.Function = tasksan::util::getPlainFuncName(Origin ? *Origin : F).str();
+  Site.Line = SP->getLine();
+  Site.Column = 0;
+  Site.File = tasksan::debug::createAbsoluteFileName(
+      SP->getDirectory().str(), SP->getFilename().str());
+
+  unsigned Index = getSiteIndex(Site);
+  llvm::IRBuilder<> IRB(getSiteBase(F)->getNextNode());
+  return IRB.CreateAdd(SiteBaseValue, IRB.getInt32(Index));
+}
+
+// Returns the index of a site in the table of the module,
+// adding the site if it is new
+unsigned TaskSanitizer::getSiteIndex(const SourceSite &Site) {
+  auto Key = std::make_tuple(Site.File, Site.Function, Site.Line, Site.Column);
+  auto Found = SiteIds.find(Key);
+  if (Found != SiteIds.end())
+    return Found->second;
+  unsigned Index = Sites.size();
+  Sites.push_back(Site);
+  SiteIds[Key] = Index;
+  return Index;
+}
+
+// Returns the load of the site base of the module, emitted once
+// at the entry of the function
+llvm::Instruction *TaskSanitizer::getSiteBase(llvm::Function &F) {
+  if (!SiteBaseValue) {
+    llvm::IRBuilder<> IRB(F.getEntryBlock().getFirstNonPHI());
+    SiteBaseValue = IRB.CreateLoad(SiteBase, "siteBase");
+  }
+  return llvm::cast<llvm::Instruction>(SiteBaseValue);
+}
+
+// Returns a private constant C string shared by all sites
+llvm::Constant *TaskSanitizer::getSiteString(llvm::Module &M,
+                                             llvm::StringRef Str) {
+  llvm::Constant *&Entry = SiteStrings[Str];
+  if (!Entry) {
+    llvm::Constant *Data =
+        llvm::ConstantDataArray::getString(M.getContext(), Str);
+    auto *GV = new llvm::GlobalVariable(M, Data->getType(), true,
+        llvm::GlobalValue::PrivateLinkage, Data, "tasksan.site_str");
+    GV->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+    Entry = llvm::ConstantExpr::getPointerCast(
+        GV, llvm::Type::getInt8PtrTy(M.getContext()));
+  }
+  return Entry;
+}
+
+// Emits the site table of the module (see common/SiteTable.h for
+// the layout) and a constructor which registers it at startup.
+bool TaskSanitizer::doFinalization(llvm::Module &M) {
+  if (ClReportEliminated)
+    llvm::errs() << "TaskSanitizer: " << M.getModuleIdentifier() << ": "
+                 << NumChecks << " access checks at " << Sites.size()
+                 << " source sites\n";
+  if (Sites.empty())
+    return false;
+
+  llvm::LLVMContext &Ctx = M.getContext();
+  llvm::IRBuilder<> IRB(Ctx);
+  llvm::StructType *SiteTy = llvm::StructType::get(Ctx,
+      {IRB.getInt8PtrTy(), IRB.getInt8PtrTy(),
+       IRB.getInt32Ty(), IRB.getInt32Ty()});
+
+  std::vector<llvm::Constant *> Entries;
+  for (const SourceSite &Site : Sites) {
+    Entries.push_back(llvm::ConstantStruct::get(SiteTy,
+        {getSiteString(M, Site.File), getSiteString(M, Site.Function),
+         IRB.getInt32(Site.Line), IRB.getInt32(Site.Column)}));
+  }
+  llvm::ArrayType *TableTy = llvm::ArrayType::get(SiteTy, Entries.size());
+  auto *Table = new llvm::GlobalVariable(M, TableTy, true,
+      llvm::GlobalValue::PrivateLinkage,
+      llvm::ConstantArray::get(TableTy, Entries), "tasksan.sites");
+
+  llvm::Function *RegisterSites = checkSanitizerInterfaceFunction(
+      M.getOrInsertFunction(kTsanRegisterSitesName, IRB.getInt32Ty(),
+                            IRB.getInt8PtrTy(), IRB.getInt32Ty()));
+
+  TsanCtorFunction = llvm::Function::Create(
+      llvm::FunctionType::get(IRB.getVoidTy(), false),
+      llvm::GlobalValue::InternalLinkage, kTsanModuleCtorName, &M);
+  llvm::BasicBlock *BB = llvm::BasicBlock::Create(Ctx, "", TsanCtorFunction);
+  IRB.SetInsertPoint(llvm::ReturnInst::Create(Ctx, BB));
+  llvm::Value *Base = IRB.CreateCall(RegisterSites,
+      {IRB.CreatePointerCast(Table, IRB.getInt8PtrTy()),
+       IRB.getInt32(Entries.size())});
+  IRB.CreateStore(Base, SiteBase);
+  llvm::appendToGlobalCtors(M, TsanCtorFunction, 0);
+  return true;
+}
+
 static llvm::ConstantInt *createOrdering(llvm::IRBuilder<> *IRB, llvm::AtomicOrdering ord) {
   uint32_t v = 0;
   switch (ord) {
@@ -619,9 +1625,19 @@ static llvm::ConstantInt *createOrdering(llvm::IRBuilder<> *IRB, llvm::AtomicOrd
 // Since tasksan is running after everyone else, the calls should not be
 // replaced back with intrinsics. If that becomes wrong at some point,
 // we will need to call e.g. __tasksan_memset to avoid the intrinsics.
+// The bytes they touch are reported as one range each, by
+// __tasksan_read_range and __tasksan_write_range, instead of one
+// access per word.
 bool TaskSanitizer::instrumentMemIntrinsic(llvm::Instruction *I) {
   llvm::IRBuilder<> IRB(I);
+  // the site id needs a debug location, like the loads and stores
+  llvm::Value *SiteId = I->getDebugLoc() ? getSiteId(I) : nullptr;
   if (llvm::MemSetInst *M = llvm::dyn_cast<llvm::MemSetInst>(I)) {
+    NumChecks += SiteId ? 1 : 0;
+    if (SiteId)
+      IRB.CreateCall(TsanWriteRange,
+          {IRB.CreatePointerCast(M->getArgOperand(0), IRB.getInt8PtrTy()),
+           IRB.CreateIntCast(M->getArgOperand(2), IntptrTy, false), SiteId});
     IRB.CreateCall(
         MemsetFn,
         {IRB.CreatePointerCast(M->getArgOperand(0), IRB.getInt8PtrTy()),
@@ -629,6 +1645,17 @@ bool TaskSanitizer::instrumentMemIntrinsic(llvm::Instruction *I) {
          IRB.CreateIntCast(M->getArgOperand(2), IntptrTy, false)});
     I->eraseFromParent();
   } else if (llvm::MemTransferInst *M = llvm::dyn_cast<llvm::MemTransferInst>(I)) {
+    if (SiteId) {
+      NumChecks += 2;
+      llvm::Value *Size =
+          IRB.CreateIntCast(M->getArgOperand(2), IntptrTy, false);
+      IRB.CreateCall(TsanReadRange,
+          {IRB.CreatePointerCast(M->getArgOperand(1), IRB.getInt8PtrTy()),
+           Size, SiteId});
+      IRB.CreateCall(TsanWriteRange,
+          {IRB.CreatePointerCast(M->getArgOperand(0), IRB.getInt8PtrTy()),
+           Size, SiteId});
+    }
     IRB.CreateCall(
         llvm::isa<llvm::MemCpyInst>(M) ? MemcpyFn : MemmoveFn,
         {IRB.CreatePointerCast(M->getArgOperand(0), IRB.getInt8PtrTy()),
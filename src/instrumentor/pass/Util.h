@@ -113,6 +113,15 @@ bool isTaskBodyFunction(llvm::StringRef name) {
   return false;
 }
 
+/**
+ * Checks if a function is an outlined OpenMP region or task body
+ * generated by clang, e.g. .omp_outlined. or .omp_task_entry.
+ */
+bool isOutlinedFunction(llvm::StringRef name) {
+  return name.find(".omp_outlined.") != llvm::StringRef::npos ||
+         name.find(".omp_task_entry.") != llvm::StringRef::npos;
+}
+
 bool isLLVMCall(llvm::StringRef name) {
   if (name.find("llvm") != llvm::StringRef::npos) return true;
   else return false;
@@ -0,0 +1,49 @@
+#ifndef _TEST_DETECTORTESTFIXTURE_H_
+#define _TEST_DETECTORTESTFIXTURE_H_
+
+#include <gtest/gtest.h>
+
+#include "common/defs.h"
+#include "common/SiteTable.h"
+
+// Base of the detector tests: makes access records of some_function
+// at the sites of lines 100 to 100 + SITES - 1, registered once.
+class DetectorTestFixture : public ::testing::Test {
+protected:
+  static const int SITES = 1024;
+  static const int FIRST_LINE = 100;
+
+  ADDRESS addr;
+  uint32_t siteBase;
+
+  explicit DetectorTestFixture(ADDRESS addr = (ADDRESS)0x1000)
+      : addr(addr), siteBase(getSiteBase()) {}
+
+  // Returns an access of taskId to addr at the given site
+  AccessRecord makeAccess(INTEGER taskId, VALUE value, int site,
+                          bool isWrite = true) {
+    AccessRecord access;
+    access.accessing_task_id = taskId;
+    access.destination_address = addr;
+    access.value_written = value;
+    access.source_site_id = siteBase + site;
+    access.is_write_action = isWrite;
+    return access;
+  }
+
+private:
+  static uint32_t getSiteBase() {
+    static SourceSite sites[SITES];
+    static uint32_t base = 0;
+    if (!base) {
+      for (int i = 0; i < SITES; i++) {
+        sites[i] = SourceSite{"test.cc", "some_function",
+                              (uint32_t)(FIRST_LINE + i), 1};
+      }
+      base = SiteTable::instance().registerModule(sites, SITES);
+    }
+    return base;
+  }
+};
+
+#endif // end DetectorTestFixture.h
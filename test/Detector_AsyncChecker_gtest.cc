@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include "detector/determinacy/asyncChecker.h"
+#include "DetectorTestFixture.h"
+
+class TestAsyncCheckerFixture : public DetectorTestFixture {
+protected:
+  Checker checker;
+
+  // posts one write of taskId from the calling thread
+  void write(AsyncChecker & async, INTEGER taskId, int site) {
+    AccessRecord access = makeAccess(taskId, taskId, site);
+    async.saveMemoryAccesses(&access, 1);
+  }
+};
+
+TEST_F(TestAsyncCheckerFixture, CheckRaceOfTwoThreadsIsReported) {
+  AsyncChecker async(checker, 1);
+  async.onTaskCreate(1);
+  async.onTaskCreate(2);
+  std::thread first([&]() { write(async, 1, 0); });
+  std::thread second([&]() { write(async, 2, 1); });
+  first.join();
+  second.join();
+  async.stop();
+  EXPECT_EQ(1, checker.getConflicts().size());
+}
+
+TEST_F(TestAsyncCheckerFixture, CheckEdgeIsAppliedBeforeLaterAccesses) {
+  AsyncChecker async(checker, 2);
+  std::thread first([&]() {
+    async.onTaskCreate(1);
+    write(async, 1, 0);
+    async.saveHappensBeforeEdge(1, 2);
+  });
+  first.join();
+  // posted from another channel after the edge
+  std::thread second([&]() { write(async, 2, 1); });
+  second.join();
+  async.stop();
+  EXPECT_TRUE(checker.getConflicts().empty());
+}
+
+TEST_F(TestAsyncCheckerFixture, CheckSegmentsAreCheckedBeforeTheyEnd) {
+  AsyncChecker async(checker, 2);
+  async.onTaskCreate(1);
+  async.onTaskSpawn(1, 2);
+  async.onTaskContinue(1, 3);
+  write(async, 3, 0);
+
+  std::thread child([&]() {
+    write(async, 2, 1);
+    async.onTaskEnd(2);
+  });
+  child.join();
+
+  async.onTaskSync(3, 4, {2});
+  write(async, 4, 2);
+  async.stop();
+
+  auto & conflicts = checker.getConflicts();
+  EXPECT_EQ(1, conflicts.size());
+  EXPECT_EQ(1, conflicts.count({100, 101}));
+}
+
+TEST_F(TestAsyncCheckerFixture, CheckAllWorkersFinishSegmentBeforeItEnds) {
+  AsyncChecker async(checker, 4);
+  std::vector<AccessRecord> parent, child;
+  for (int i = 0; i < 256; i++) {
+    parent.push_back(makeAccess(1, 1, 0));
+    parent.back().destination_address = (ADDRESS)(long)(0x10000 + i * 8);
+    child.push_back(makeAccess(2, 2, 1));
+    child.back().destination_address = parent.back().destination_address;
+  }
+
+  async.onTaskCreate(1);
+  async.saveMemoryAccesses(parent.data(), parent.size());
+  async.onTaskSpawn(1, 2);
+  async.onTaskContinue(1, 3);
+  std::thread worker([&]() {
+    async.saveMemoryAccesses(child.data(), child.size());
+    async.onTaskEnd(2);
+  });
+  worker.join();
+  async.onTaskSync(3, 4, {2});  // releases task 2
+  async.stop();
+  EXPECT_TRUE(checker.getConflicts().empty());
+}
+
+TEST_F(TestAsyncCheckerFixture, CheckManyBatchesFromManyThreads) {
+  AsyncChecker async(checker, 2);
+  std::vector<std::thread> workers;
+  for (int task = 1; task <= 4; task++) {
+    workers.push_back(std::thread([&, task]() {
+      async.onTaskCreate(task);
+      std::vector<AccessRecord> batch;
+      for (int i = 0; i < 5000; i++) {
+        AccessRecord access = makeAccess(task, i, task);
+        access.destination_address = (ADDRESS)(long)((task << 20) + i * 8);
+        batch.push_back(access);
+      }
+      batch.push_back(makeAccess(task, task, task)); // the shared address
+      for (size_t i = 0; i < batch.size(); i += 100) {
+        async.saveMemoryAccesses(&batch[i],
+                                 std::min((size_t)100, batch.size() - i));
+      }
+    }));
+  }
+  for (auto & worker : workers) worker.join();
+  async.stop();
+  EXPECT_EQ(6, checker.getConflicts().size()); // pairs of 4 tasks
+}
@@ -0,0 +1,405 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "detector/determinacy/checker.h"
+#include "detector/determinacy/logParser.h"
+#include "DetectorTestFixture.h"
+
+class TestCheckerFixture : public DetectorTestFixture {
+protected:
+  VALUE source_line_num = FIRST_LINE;
+  INTEGER funcId = 6;
+
+  Checker checker;
+
+  TestCheckerFixture(): DetectorTestFixture((ADDRESS)0x033) {}
+
+  virtual void SetUp() {
+    checker.registerFuncSignature("some_function", funcId);
+    checker.onTaskCreate(1);
+    checker.onTaskCreate(2);
+  }
+
+  // Returns an access at the site of line
+  AccessRecord makeAccess(INTEGER taskId, VALUE value,
+                          VALUE line, bool is_write) {
+    return DetectorTestFixture::makeAccess(taskId, value, line - FIRST_LINE,
+                                           is_write);
+  }
+};
+
+TEST_F(TestCheckerFixture, CheckNoConflictForSingleTask) {
+  checker.saveMemoryAccess(makeAccess(1, 10, source_line_num, true));
+  checker.saveMemoryAccess(makeAccess(1, 11, source_line_num + 1, true));
+  EXPECT_TRUE(checker.getConflicts().empty());
+}
+
+TEST_F(TestCheckerFixture, CheckWriteWriteConflictOfParallelTasks) {
+  checker.saveMemoryAccess(makeAccess(1, 10, source_line_num, true));
+  checker.saveMemoryAccess(makeAccess(2, 11, source_line_num + 1, true));
+  EXPECT_EQ(1, checker.getConflicts().size());
+}
+
+TEST_F(TestCheckerFixture, CheckSameValueWritesAreNotConflicts) {
+  checker.saveMemoryAccess(makeAccess(1, 10, source_line_num, true));
+  checker.saveMemoryAccess(makeAccess(2, 10, source_line_num + 1, true));
+  EXPECT_TRUE(checker.getConflicts().empty());
+}
+
+TEST_F(TestCheckerFixture, CheckReadWriteConflictOfParallelTasks) {
+  checker.saveMemoryAccess(makeAccess(1, 0, source_line_num, false));
+  checker.saveMemoryAccess(makeAccess(2, 11, source_line_num + 1, true));
+  EXPECT_EQ(1, checker.getConflicts().size());
+}
+
+TEST_F(TestCheckerFixture, CheckNoConflictWithHappensBefore) {
+  checker.saveHappensBeforeEdge(1, 3);
+  checker.saveMemoryAccess(makeAccess(1, 10, source_line_num, true));
+  checker.saveMemoryAccess(makeAccess(3, 11, source_line_num + 1, true));
+  EXPECT_TRUE(checker.getConflicts().empty());
+}
+
+TEST_F(TestCheckerFixture, CheckLogParserMatchesTypedPath) {
+  LogParser parser(checker);
+  std::string edge("3 1");
+  parser.addTaskNode(edge);
+
+  std::stringstream first("33 10 100 6");
+  parser.detectRaceOnMem(1, "W", first);
+  std::stringstream second("33 11 101 6");
+  parser.detectRaceOnMem(3, "W", second);
+  EXPECT_TRUE(checker.getConflicts().empty());
+
+  std::stringstream third("33 12 102 6");
+  parser.detectRaceOnMem(2, "W", third);
+  EXPECT_EQ(2, checker.getConflicts().size());
+}
+
+TEST_F(TestCheckerFixture, CheckBatchOfAccessesIsChecked) {
+  AccessRecord batch[3] = {
+    makeAccess(1, 10, source_line_num, true),
+    makeAccess(1, 11, source_line_num + 1, true),
+    makeAccess(2, 0, source_line_num + 2, false)
+  };
+  checker.saveMemoryAccesses(batch, 3);
+  EXPECT_EQ(2, checker.getConflicts().size());
+}
+
+TEST_F(TestCheckerFixture, CheckConcurrentBatchesAcrossShards) {
+  auto worker = [this](INTEGER taskId) {
+    AccessRecord batch[256];
+    for (int i = 0; i < 256; i++) {
+      batch[i] = makeAccess(taskId, taskId, source_line_num + taskId, true);
+      batch[i].destination_address = (ADDRESS)(long)((taskId << 16) + i * 8);
+    }
+    batch[255].destination_address = addr; // the only shared address
+    checker.saveMemoryAccesses(batch, 256);
+  };
+  std::thread first(worker, 1);
+  std::thread second(worker, 2);
+  first.join();
+  second.join();
+  EXPECT_EQ(1, checker.getConflicts().size());
+}
+
+TEST_F(TestCheckerFixture, CheckConflictsAreReportedWithSiteLines) {
+  checker.saveMemoryAccess(makeAccess(1, 10, 1000, true));
+  checker.saveMemoryAccess(makeAccess(2, 11, 300, true));
+  auto & conflicts = checker.getConflicts();
+  ASSERT_EQ(1, conflicts.size());
+  EXPECT_EQ(300, conflicts.begin()->first.first);
+  EXPECT_EQ(1000, conflicts.begin()->first.second);
+
+  const Conflict & conflict = *conflicts.begin()->second.begin();
+  EXPECT_EQ("some_function", conflict.action1.source_func_name);
+}
+
+TEST_F(TestCheckerFixture, CheckConflictsKeepCallStacks) {
+  AccessRecord first = makeAccess(1, 10, 1000, true);
+  first.stack_id = 5;
+  AccessRecord second = makeAccess(2, 11, 300, true);
+  second.stack_id = 9;
+  checker.saveMemoryAccess(first);
+  checker.saveMemoryAccess(second);
+  auto & conflicts = checker.getConflicts();
+  ASSERT_EQ(1, conflicts.size());
+
+  const Conflict & conflict = *conflicts.begin()->second.begin();
+  EXPECT_EQ(9, conflict.action1.stack_id);
+  EXPECT_EQ(5, conflict.action2.stack_id);
+  EXPECT_EQ(1000, conflict.action2.source_line_num);
+}
+
+TEST_F(TestCheckerFixture, CheckHistoryGrowsForParallelAccesses) {
+  // more parallel readers than the default history capacity
+  for (int task = 1; task <= 2 * HISTORY_DEFAULT_CAPACITY; task++) {
+    checker.saveMemoryAccess(makeAccess(task, 0, source_line_num + task, false));
+  }
+  checker.saveMemoryAccess(makeAccess(99, 7, source_line_num, true));
+  EXPECT_EQ(2 * HISTORY_DEFAULT_CAPACITY, checker.getConflicts().size());
+}
+
+TEST_F(TestCheckerFixture, CheckOrderedAccessesAreEvictedFirst) {
+  setenv("TASKSAN_HISTORY_CAPACITY", "2", 1);
+  setenv("TASKSAN_HISTORY_MAX_CAPACITY", "2", 1);
+  Checker small;
+  unsetenv("TASKSAN_HISTORY_CAPACITY");
+  unsetenv("TASKSAN_HISTORY_MAX_CAPACITY");
+
+  small.onTaskCreate(1);
+  small.onTaskCreate(2);
+  small.saveHappensBeforeEdge(2, 3);
+  small.saveMemoryAccess(makeAccess(1, 1, source_line_num, true));
+  small.saveMemoryAccess(makeAccess(2, 2, source_line_num + 1, true));
+  const AddressHistory * history = small.findHistory(addr);
+  ASSERT_NE(nullptr, history);
+  ASSERT_EQ(2u, history->count);
+  EXPECT_EQ(1, history->at(0).taskID);
+  EXPECT_EQ(2, history->at(1).taskID);
+
+  // the write of task 2 happens before task 3: it goes first,
+  // though the write of task 1 is older
+  small.saveMemoryAccess(makeAccess(3, 3, source_line_num + 2, true));
+  history = small.findHistory(addr);
+  ASSERT_EQ(2u, history->count);
+  EXPECT_EQ(1, history->at(0).taskID);
+  EXPECT_EQ(3, history->at(1).taskID);
+
+  // nothing happens before task 4: the oldest write goes
+  small.saveMemoryAccess(makeAccess(4, 4, source_line_num + 3, true));
+  history = small.findHistory(addr);
+  ASSERT_EQ(2u, history->count);
+  EXPECT_EQ(3, history->at(0).taskID);
+  EXPECT_EQ(4, history->at(1).taskID);
+}
+
+TEST_F(TestCheckerFixture, CheckRangeConflictsWithEarlierPoint) {
+  checker.saveMemoryAccess(makeAccess(1, 10, source_line_num, true));
+  AccessRecord range = makeAccess(2, 0, source_line_num + 1, false);
+  range.destination_address = (ADDRESS)0x010;
+  range.range_size = 64;  // covers addr
+  checker.saveMemoryAccess(range);
+  EXPECT_EQ(1, checker.getConflicts().size());
+}
+
+TEST_F(TestCheckerFixture, CheckPointConflictsWithEarlierRange) {
+  AccessRecord range = makeAccess(1, 0, source_line_num, true);
+  range.destination_address = (ADDRESS)0x010;
+  range.range_size = 64;
+  checker.saveMemoryAccess(range);
+  checker.saveMemoryAccess(makeAccess(2, 0, source_line_num + 1, false));
+  EXPECT_EQ(1, checker.getConflicts().size());
+}
+
+TEST_F(TestCheckerFixture, CheckReadsOfRangesDoNotConflict) {
+  AccessRecord range = makeAccess(1, 0, source_line_num, false);
+  range.destination_address = (ADDRESS)0x010;
+  range.range_size = 64;
+  checker.saveMemoryAccess(range);
+  checker.saveMemoryAccess(makeAccess(2, 0, source_line_num + 1, false));
+  EXPECT_TRUE(checker.getConflicts().empty());
+}
+
+TEST_F(TestCheckerFixture, CheckOverlappingRangesConflict) {
+  AccessRecord first = makeAccess(1, 0, source_line_num, true);
+  first.destination_address = (ADDRESS)0x1000;
+  first.range_size = 256;
+  AccessRecord apart = makeAccess(2, 0, source_line_num + 1, true);
+  apart.destination_address = (ADDRESS)0x1100;  // right after first
+  apart.range_size = 256;
+  AccessRecord overlapping = makeAccess(2, 0, source_line_num + 2, false);
+  overlapping.destination_address = (ADDRESS)0x10f8;
+  overlapping.range_size = 16;
+
+  checker.saveMemoryAccess(first);
+  checker.saveMemoryAccess(apart);
+  EXPECT_TRUE(checker.getConflicts().empty());
+  checker.saveMemoryAccess(overlapping);
+  auto & conflicts = checker.getConflicts();
+  EXPECT_EQ(1, conflicts.size());
+  EXPECT_EQ(1, conflicts.count({source_line_num, source_line_num + 2}));
+}
+
+TEST_F(TestCheckerFixture, CheckNoRangeConflictWithHappensBefore) {
+  checker.saveHappensBeforeEdge(1, 3);
+  AccessRecord range = makeAccess(1, 0, source_line_num, true);
+  range.destination_address = (ADDRESS)0x010;
+  range.range_size = 64;
+  checker.saveMemoryAccess(range);
+  checker.saveMemoryAccess(makeAccess(3, 11, source_line_num + 1, true));
+  range.accessing_task_id = 3;
+  checker.saveMemoryAccess(range);
+  EXPECT_TRUE(checker.getConflicts().empty());
+}
+
+TEST_F(TestCheckerFixture, CheckLargeRangeIsCheckedAgainstPoints) {
+  // spans more granules than RANGE_SCAN_LOCK_ALL, so all shards
+  // are locked for the scan
+  AccessRecord point = makeAccess(1, 10, source_line_num, true);
+  point.destination_address = (ADDRESS)(0x100000 + 65536 - 8);
+  checker.saveMemoryAccess(point);
+  AccessRecord range = makeAccess(2, 0, source_line_num + 1, true);
+  range.destination_address = (ADDRESS)0x100000;
+  range.range_size = 65536;
+  checker.saveMemoryAccess(range);
+  EXPECT_EQ(1, checker.getConflicts().size());
+}
+
+TEST_F(TestCheckerFixture, CheckStridedRangeCoversElementsOnly) {
+  // 4 bytes every 16 bytes, like a loop over one field of structs
+  AccessRecord strided = makeAccess(1, 0, source_line_num, true);
+  strided.destination_address = (ADDRESS)0x2000;
+  strided.range_size = 15 * 16 + 4;
+  strided.range_stride = 16;
+  strided.range_width = 4;
+  checker.saveMemoryAccess(strided);
+
+  AccessRecord between = makeAccess(2, 0, source_line_num + 1, false);
+  between.destination_address = (ADDRESS)0x2008;
+  checker.saveMemoryAccess(between);
+  EXPECT_TRUE(checker.getConflicts().empty());
+
+  AccessRecord element = makeAccess(2, 0, source_line_num + 2, false);
+  element.destination_address = (ADDRESS)0x2042;
+  checker.saveMemoryAccess(element);
+  EXPECT_EQ(1, checker.getConflicts().count({source_line_num,
+                                             source_line_num + 2}));
+  EXPECT_EQ(1, checker.getConflicts().size());
+}
+
+TEST_F(TestCheckerFixture, CheckInterleavedStridedRangesDoNotConflict) {
+  AccessRecord even = makeAccess(1, 0, source_line_num, true);
+  even.destination_address = (ADDRESS)0x3000;
+  even.range_size = 63 * 16 + 8;
+  even.range_stride = 16;
+  even.range_width = 8;
+  AccessRecord odd = even;
+  odd.accessing_task_id = 2;
+  odd.source_site_id = siteBase + 1;
+  odd.destination_address = (ADDRESS)0x3008;
+  checker.saveMemoryAccess(even);
+  checker.saveMemoryAccess(odd);
+  EXPECT_TRUE(checker.getConflicts().empty());
+
+  AccessRecord copy = makeAccess(2, 0, source_line_num + 2, false);
+  copy.destination_address = (ADDRESS)0x3100;
+  copy.range_size = 8;  // one element of even
+  checker.saveMemoryAccess(copy);
+  EXPECT_EQ(1, checker.getConflicts().size());
+}
+
+TEST_F(TestCheckerFixture, CheckSummarizedLoopReadsConflictOnlyWithWrites) {
+  // two parallel tasks run the same loop reading a[2 * i] of
+  // 8-byte elements; the pass reports it as one strided read
+  AccessRecord loop = makeAccess(1, 0, source_line_num, false);
+  loop.destination_address = (ADDRESS)0x6000;
+  loop.range_size = 63 * 16 + 8;
+  loop.range_stride = 16;
+  loop.range_width = 8;
+  checker.saveMemoryAccess(loop);
+  loop.accessing_task_id = 2;
+  checker.saveMemoryAccess(loop);
+  EXPECT_TRUE(checker.getConflicts().empty());
+
+  AccessRecord write = makeAccess(2, 5, source_line_num + 1, true);
+  write.destination_address = (ADDRESS)(0x6000 + 16 * 5 + 8);  // a[11]
+  checker.saveMemoryAccess(write);
+  EXPECT_TRUE(checker.getConflicts().empty());
+
+  write.destination_address = (ADDRESS)(0x6000 + 16 * 5);  // a[10]
+  checker.saveMemoryAccess(write);
+  EXPECT_EQ(1, checker.getConflicts().size());
+}
+
+TEST_F(TestCheckerFixture, CheckStridedRangeMeetsEarlierPoints) {
+  AccessRecord point = makeAccess(1, 10, source_line_num, true);
+  point.destination_address = (ADDRESS)(0x4000 + 8 * 24);
+  checker.saveMemoryAccess(point);
+  point.destination_address = (ADDRESS)(0x4000 + 8 * 24 + 4);  // in a gap
+  checker.saveMemoryAccess(point);
+
+  AccessRecord strided = makeAccess(2, 0, source_line_num + 1, false);
+  strided.destination_address = (ADDRESS)0x4000;
+  strided.range_size = 99 * 8 + 4;
+  strided.range_stride = 8;
+  strided.range_width = 4;
+  checker.saveMemoryAccess(strided);
+  EXPECT_EQ(1, checker.getConflicts().size());
+}
+
+TEST(RangeCellTest, CheckStridedOverlapAndCover) {
+  RangeCell fields;  // 4 bytes every 16 from 0x100
+  fields.start = 0x100;
+  fields.end = 0x100 + 9 * 16 + 4;
+  fields.stride = 16;
+  fields.width = 4;
+  uintptr_t at;
+  EXPECT_TRUE(fields.overlaps(0x108, 0x114, at));
+  EXPECT_EQ(0x110u, at);
+  EXPECT_FALSE(fields.overlaps(0x104, 0x110, at));
+
+  RangeCell part = fields;  // every element from the third on
+  part.start = 0x120;
+  EXPECT_TRUE(fields.covers(part));
+  part.start = 0x122;
+  part.end = 0x124;
+  part.stride = 0;
+  EXPECT_TRUE(fields.covers(part));
+  part.end = 0x126;
+  EXPECT_FALSE(fields.covers(part));
+
+  RangeCell shifted = fields;
+  shifted.start = 0x10a;
+  shifted.end += 10;
+  EXPECT_FALSE(fields.overlaps(shifted, at));
+  shifted.stride = 24;  // its second element meets the third one
+  EXPECT_TRUE(fields.overlaps(shifted, at));
+  EXPECT_EQ(0x122u, at);
+}
+
+TEST(RangeHistoryTest, CheckHugeRangeDoesNotWidenSmallSearches) {
+  RangeHistory history;
+  RangeCell range;
+  range.stride = 0;
+  range.width = 0;
+  range.start = 0x10000;  // one range of 1 MB
+  range.end = 0x10000 + (1 << 20);
+  history.insert(range);
+  for (uintptr_t i = 0; i < 1000; i++) {  // and 1000 of 8 bytes in it
+    range.start = 0x10000 + 64 * i;
+    range.end = range.start + 8;
+    history.insert(range);
+  }
+
+  uintptr_t point = 0x10000 + 64 * 500 + 4;
+  size_t visited = 0;
+  size_t scanned = history.forEachOverlap(point, point + 1,
+      [&](const RangeCell &) { visited++; return false; });
+  EXPECT_EQ(2u, visited);
+  EXPECT_GE(3u, scanned);
+
+  // removing ranges keeps the others
+  history.forEachOverlap(point, point + 1,
+      [&](const RangeCell & found) { return found.end - found.start == 8; });
+  EXPECT_EQ(1000u, history.size());
+  visited = 0;
+  history.forEachOverlap(0x10000, 0x10000 + (1 << 20),
+      [&](const RangeCell &) { visited++; return false; });
+  EXPECT_EQ(1000u, visited);
+}
+
+TEST(SiteTableTest, CheckModulesGetDisjointIds) {
+  static SourceSite first[2] = {{"a.cc", "f", 1, 1}, {"a.cc", "f", 2, 1}};
+  static SourceSite second[1] = {{"b.cc", "g", 7, 3}};
+  uint32_t firstBase = SiteTable::instance().registerModule(first, 2);
+  uint32_t secondBase = SiteTable::instance().registerModule(second, 1);
+
+  EXPECT_NE(0, firstBase);
+  EXPECT_EQ(firstBase + 2, secondBase);
+  EXPECT_EQ(2, SiteTable::instance().find(firstBase + 1)->line);
+  EXPECT_EQ(7, SiteTable::instance().find(secondBase)->line);
+  EXPECT_EQ(NULL, SiteTable::instance().find(0));
+}
@@ -0,0 +1,267 @@
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <memory>
+
+#include "detector/determinacy/serialBagEngine.h"
+#include "detector/determinacy/vectorClockEngine.h"
+#include "detector/determinacy/spOrderEngine.h"
+
+// Runs every test on each happens-before engine
+template <typename Engine>
+class TestHBEngineFixture : public ::testing::Test {
+protected:
+  Engine engine;
+
+  bool happensBefore(int prev, int cur) {
+    return engine.happensBefore(engine.getTaskView(cur), prev);
+  }
+};
+
+typedef ::testing::Types<SerialBagEngine, VectorClockEngine,
+                         SPOrderEngine> Engines;
+TYPED_TEST_CASE(TestHBEngineFixture, Engines);
+
+TYPED_TEST(TestHBEngineFixture, CheckUnrelatedTasksAreParallel) {
+  this->engine.onTaskCreate(1);
+  this->engine.onTaskCreate(2);
+  EXPECT_FALSE(this->happensBefore(1, 2));
+  EXPECT_FALSE(this->happensBefore(2, 1));
+}
+
+TYPED_TEST(TestHBEngineFixture, CheckChainIsTransitive) {
+  for (int task = 1; task <= 5; task++) {
+    this->engine.onTaskCreate(task);
+    if (task > 1) this->engine.saveHappensBeforeEdge(task - 1, task);
+  }
+  EXPECT_TRUE(this->happensBefore(1, 5));
+  EXPECT_TRUE(this->happensBefore(3, 4));
+  EXPECT_FALSE(this->happensBefore(5, 1));
+}
+
+// 1 spawns 2 and continues as 3, which spawns 4 and continues
+// as 5; 6 waits for 2, 4 and 5
+TYPED_TEST(TestHBEngineFixture, CheckSpawnAndTaskwait) {
+  for (int task = 1; task <= 6; task++) this->engine.onTaskCreate(task);
+  this->engine.saveHappensBeforeEdge(1, 2);
+  this->engine.saveHappensBeforeEdge(1, 3);
+  this->engine.saveHappensBeforeEdge(3, 4);
+  this->engine.saveHappensBeforeEdge(3, 5);
+  this->engine.saveHappensBeforeEdge(5, 6);
+  this->engine.saveHappensBeforeEdge(2, 6);
+  this->engine.saveHappensBeforeEdge(4, 6);
+
+  EXPECT_FALSE(this->happensBefore(2, 3));
+  EXPECT_FALSE(this->happensBefore(2, 4));
+  EXPECT_FALSE(this->happensBefore(4, 5));
+  EXPECT_TRUE(this->happensBefore(1, 4));
+  EXPECT_TRUE(this->happensBefore(2, 6));
+  EXPECT_TRUE(this->happensBefore(4, 6));
+  EXPECT_TRUE(this->happensBefore(1, 6));
+  EXPECT_EQ(6, this->engine.taskCount());
+}
+
+// the same graph through fork-join events, queried while the
+// segments run
+TYPED_TEST(TestHBEngineFixture, CheckForkJoinEvents) {
+  for (int task = 1; task <= 6; task++) this->engine.onTaskCreate(task);
+  this->engine.onTaskSpawn(1, 2);
+  this->engine.onTaskContinue(1, 3);
+  EXPECT_FALSE(this->happensBefore(2, 3));
+  EXPECT_TRUE(this->happensBefore(1, 3));
+
+  this->engine.onTaskSpawn(3, 4);
+  this->engine.onTaskContinue(3, 5);
+  EXPECT_FALSE(this->happensBefore(2, 4));
+  EXPECT_FALSE(this->happensBefore(4, 5));
+  EXPECT_FALSE(this->happensBefore(2, 5));
+  EXPECT_TRUE(this->happensBefore(1, 4));
+  EXPECT_TRUE(this->happensBefore(3, 5));
+
+  this->engine.onTaskSync(5, 6, {2, 4});
+  EXPECT_TRUE(this->happensBefore(2, 6));
+  EXPECT_TRUE(this->happensBefore(4, 6));
+  EXPECT_TRUE(this->happensBefore(1, 6));
+  EXPECT_FALSE(this->happensBefore(6, 2));
+}
+
+TYPED_TEST(TestHBEngineFixture, CheckNestedTaskwaits) {
+  for (int task = 1; task <= 7; task++) this->engine.onTaskCreate(task);
+  this->engine.onTaskSpawn(1, 2);     // parent 1 creates 2
+  this->engine.onTaskContinue(1, 3);
+  this->engine.onTaskSpawn(2, 4);     // child 2 creates 4
+  this->engine.onTaskContinue(2, 5);
+  EXPECT_FALSE(this->happensBefore(4, 3));
+
+  this->engine.onTaskSync(5, 6, {4}); // child waits
+  EXPECT_TRUE(this->happensBefore(4, 6));
+  EXPECT_FALSE(this->happensBefore(6, 3));
+
+  this->engine.onTaskSync(3, 7, {2}); // parent waits
+  EXPECT_TRUE(this->happensBefore(2, 7));
+  EXPECT_TRUE(this->happensBefore(3, 7));
+}
+
+TYPED_TEST(TestHBEngineFixture, CheckUnknownTasksAreNotOrdered) {
+  this->engine.onTaskCreate(1);
+  EXPECT_EQ(NULL, this->engine.getTaskView(42));
+  EXPECT_FALSE(this->engine.happensBefore(NULL, 1));
+  EXPECT_FALSE(this->happensBefore(42, 1));
+}
+
+TEST(SerialBagEngineTest, CheckEndedTasksAreReleasedAfterJoin) {
+  SerialBagEngine engine;
+  for (int task = 1; task <= 4; task++) engine.onTaskCreate(task);
+  engine.onTaskSpawn(1, 2);
+  engine.onTaskContinue(1, 3);   // 1 ends, nothing refers to it
+  EXPECT_EQ(1, engine.releasedTaskCount());
+
+  engine.onTaskEnd(2);           // 2 waits for the taskwait of 3
+  EXPECT_EQ(1, engine.retiredTaskCount());
+  EXPECT_TRUE(engine.happensBefore(engine.getTaskView(2), 1));
+
+  engine.onTaskSync(3, 4, {2});
+  EXPECT_EQ(0, engine.retiredTaskCount());
+  EXPECT_EQ(3, engine.releasedTaskCount());
+  EXPECT_EQ(1, engine.liveTaskCount());
+  EXPECT_EQ(4, engine.taskCount());
+
+  const VOID * view = engine.getTaskView(4);
+  EXPECT_TRUE(engine.happensBefore(view, 1));
+  EXPECT_TRUE(engine.happensBefore(view, 2));
+  EXPECT_TRUE(engine.happensBefore(view, 3));
+}
+
+TEST(SerialBagEngineTest, CheckKeptTaskIsMergedAfterItEnds) {
+  SerialBagEngine engine;
+  for (int task = 1; task <= 5; task++) engine.onTaskCreate(task);
+  engine.onTaskSpawn(1, 2);
+  engine.onTaskContinue(1, 3);
+  engine.keepTask(2);            // 2 has an out dependence
+  engine.onTaskEnd(2);
+  engine.onTaskSync(3, 4, {2});
+  EXPECT_EQ(1, engine.retiredTaskCount());
+
+  engine.saveHappensBeforeEdge(2, 5);
+  const VOID * view = engine.getTaskView(5);
+  EXPECT_TRUE(engine.happensBefore(view, 2));
+  EXPECT_TRUE(engine.happensBefore(view, 1));
+  EXPECT_FALSE(engine.happensBefore(view, 3));
+}
+
+TEST(SerialBagEngineTest, CheckRetirementCanBeDisabled) {
+  SerialBagEngine engine(false);
+  for (int task = 1; task <= 3; task++) engine.onTaskCreate(task);
+  engine.onTaskSpawn(1, 2);
+  engine.onTaskContinue(1, 3);
+  engine.onTaskEnd(2);
+  EXPECT_EQ(3, engine.liveTaskCount());
+  EXPECT_EQ(0, engine.releasedTaskCount());
+}
+
+// a taskwait joins the whole child task, not only its first
+// segment, which the edge based engines see
+TEST(SPOrderEngineTest, CheckTaskwaitJoinsAllSegmentsOfChild) {
+  SPOrderEngine engine;
+  for (int task = 1; task <= 7; task++) engine.onTaskCreate(task);
+  engine.onTaskSpawn(1, 2);
+  engine.onTaskContinue(1, 3);
+  engine.onTaskSpawn(2, 4);
+  engine.onTaskContinue(2, 5);
+  engine.onTaskSync(5, 6, {4});
+  engine.onTaskSync(3, 7, {2});
+
+  EXPECT_STREQ("sp-order", engine.getName());
+  EXPECT_TRUE(engine.happensBefore(engine.getTaskView(7), 4));
+  EXPECT_TRUE(engine.happensBefore(engine.getTaskView(7), 6));
+}
+
+TEST(SPOrderEngineTest, CheckDependenceEdgeFallsBack) {
+  SPOrderEngine engine;
+  for (int task = 1; task <= 4; task++) engine.onTaskCreate(task);
+  engine.onTaskSpawn(1, 2);
+  engine.onTaskContinue(1, 3);
+  EXPECT_STREQ("sp-order", engine.getName());
+
+  engine.saveHappensBeforeEdge(2, 4); // a depend clause
+  EXPECT_STRNE("sp-order", engine.getName());
+  EXPECT_TRUE(engine.happensBefore(engine.getTaskView(4), 2));
+  EXPECT_TRUE(engine.happensBefore(engine.getTaskView(2), 1));
+  EXPECT_FALSE(engine.happensBefore(engine.getTaskView(3), 2));
+  EXPECT_EQ(4, engine.taskCount());
+}
+
+// a child which creates a task and ends without a taskwait
+TEST(SPOrderEngineTest, CheckEscapingGrandchildFallsBack) {
+  SPOrderEngine engine;
+  for (int task = 1; task <= 6; task++) engine.onTaskCreate(task);
+  engine.onTaskSpawn(1, 2);
+  engine.onTaskContinue(1, 3);
+  engine.onTaskSpawn(2, 4);
+  engine.onTaskContinue(2, 5);
+  engine.onTaskSync(3, 6, {2});
+
+  EXPECT_STRNE("sp-order", engine.getName());
+  EXPECT_FALSE(engine.happensBefore(engine.getTaskView(6), 4));
+  EXPECT_TRUE(engine.happensBefore(engine.getTaskView(6), 2));
+}
+
+TEST(OrderListTest, CheckOrderSurvivesRelabeling) {
+  OrderList list;
+  std::vector<OMNode *> nodes;
+  OMNode * node = list.getBase();
+  // always inserting after the same node exhausts its gap
+  for (int i = 0; i < 2000; i++) {
+    nodes.push_back(list.insertAfter(node));
+  }
+  for (size_t i = 1; i < nodes.size(); i++) {
+    EXPECT_TRUE(OrderList::precedes(nodes[i], nodes[i - 1]));
+  }
+  EXPECT_TRUE(OrderList::precedes(list.getBase(), nodes.back()));
+}
+
+TEST(HBSetTest, CheckMembershipAcrossLevels) {
+  HBSet set;
+  int ids[] = {0, 63, 255, 256, 4095, 70000, 1 << 30};
+  for (int id : ids) set.insert(id);
+  for (int id : ids) EXPECT_TRUE(set.contains(id));
+  EXPECT_FALSE(set.contains(1));
+  EXPECT_FALSE(set.contains(4096));
+  EXPECT_FALSE(set.contains((1 << 30) + 1));
+  EXPECT_EQ(7, set.size());
+}
+
+TEST(HBSetTest, CheckSharedSetsAreNotChanged) {
+  HBSet parent;
+  for (int id = 0; id < 1000; id++) parent.insert(id);
+
+  HBSet child(parent);
+  child.insert(5000);
+  HBSet other;
+  other.insert(3);
+  other.insert(100000);
+  other.unite(parent);
+
+  EXPECT_FALSE(parent.contains(5000));
+  EXPECT_FALSE(parent.contains(100000));
+  EXPECT_EQ(1000, parent.size());
+  EXPECT_EQ(1001, child.size());
+  EXPECT_EQ(1001, other.size());
+  EXPECT_TRUE(other.contains(999));
+  EXPECT_TRUE(other.contains(100000));
+}
+
+TEST(HBEngineSelectionTest, CheckEngineIsSelectedFromEnvironment) {
+  unsetenv("TASKSAN_HB_ENGINE");
+  std::unique_ptr<HBEngine> engine(createHBEngine());
+  EXPECT_STREQ("serial-bag", engine->getName());
+
+  setenv("TASKSAN_HB_ENGINE", "vector-clock", 1);
+  engine.reset(createHBEngine());
+  EXPECT_STREQ("vector-clock", engine->getName());
+
+  setenv("TASKSAN_HB_ENGINE", "sp-order", 1);
+  engine.reset(createHBEngine());
+  EXPECT_STREQ("sp-order", engine->getName());
+  unsetenv("TASKSAN_HB_ENGINE");
+}
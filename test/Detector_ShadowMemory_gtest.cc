@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "detector/determinacy/shadowMemory.h"
+
+class TestShadowMemoryFixture : public ::testing::Test {
+protected:
+  ShadowMemory<long> shadow;
+  long data[64];
+};
+
+TEST_F(TestShadowMemoryFixture, CheckCellsStartZeroed) {
+  EXPECT_EQ(0, shadow.getCell(&data[0]));
+  EXPECT_EQ(0, shadow.getCell(&data[63]));
+  EXPECT_EQ(1, shadow.pageCount());
+}
+
+TEST_F(TestShadowMemoryFixture, CheckSameGranuleSharesCell) {
+  char * bytes = reinterpret_cast<char *>(&data[0]);
+  EXPECT_EQ(&shadow.getCell(bytes), &shadow.getCell(bytes + 7));
+  EXPECT_NE(&shadow.getCell(bytes), &shadow.getCell(bytes + 8));
+}
+
+TEST_F(TestShadowMemoryFixture, CheckCellKeepsValue) {
+  shadow.getCell(&data[3]) = 42;
+  EXPECT_EQ(42, shadow.getCell(&data[3]));
+  EXPECT_EQ(0, shadow.getCell(&data[4]));
+}
+
+TEST_F(TestShadowMemoryFixture, CheckPagesInstalledOnDemand) {
+  char * base = reinterpret_cast<char *>(0x100000000000);
+  size_t pageSpan = size_t(8) << SHADOW_PAGE_BITS;
+  shadow.getCell(base) = 1;
+  shadow.getCell(base + pageSpan) = 2;
+  EXPECT_EQ(2, shadow.pageCount());
+  EXPECT_EQ(1, shadow.getCell(base));
+  EXPECT_EQ(2, shadow.getCell(base + pageSpan));
+
+  long sum = 0;
+  shadow.forEachCell([&sum](long cell) { sum += cell; });
+  EXPECT_EQ(3, sum);
+}
+
+TEST_F(TestShadowMemoryFixture, CheckConcurrentFirstTouchInstallsOnePage) {
+  char * base = reinterpret_cast<char *>(0x200000000000);
+  std::thread first([&]() { shadow.getCell(base); });
+  std::thread second([&]() { shadow.getCell(base + 64); });
+  first.join();
+  second.join();
+  EXPECT_EQ(1, shadow.pageCount());
+}
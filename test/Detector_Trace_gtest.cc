@@ -0,0 +1,172 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "detector/determinacy/traceWriter.h"
+#include "detector/determinacy/traceReader.h"
+#include "detector/determinacy/asyncChecker.h"
+#include "DetectorTestFixture.h"
+
+class TestTraceFixture : public DetectorTestFixture {
+protected:
+  char path[32];
+
+  void SetUp() {
+    snprintf(path, sizeof(path), "/tmp/tasksanTraceXXXXXX");
+    close(mkstemp(path));
+  }
+
+  void TearDown() { unlink(path); }
+
+  void write(EventSink & sink, INTEGER taskId, int site) {
+    AccessRecord access = makeAccess(taskId, taskId, site);
+    sink.saveMemoryAccesses(&access, 1);
+  }
+
+  // the fork-join program of the AsyncChecker tests, with more
+  // accesses per segment so that they span chunks
+  void runSegments(EventSink & sink) {
+    std::vector<AccessRecord> parent, child;
+    for (int i = 0; i < 200; i++) {
+      parent.push_back(makeAccess(3, i, 0));
+      parent.back().destination_address = (ADDRESS)(long)(0x10000 + i * 8);
+      parent.back().is_write_action = (i % 3 == 0);
+      child.push_back(makeAccess(2, -i, 1));
+      child.back().destination_address = (ADDRESS)(long)(0x20000 + i * 8);
+    }
+    child.push_back(makeAccess(2, 2, 1));  // races with task 3
+
+    sink.onTaskCreate(1);
+    sink.onTaskSpawn(1, 2);
+    sink.onTaskContinue(1, 3);
+    sink.saveMemoryAccesses(parent.data(), parent.size());
+    write(sink, 3, 0);
+    std::thread worker([&]() {
+      sink.saveMemoryAccesses(child.data(), child.size());
+      sink.onTaskEnd(2);
+    });
+    worker.join();
+    sink.onTaskSync(3, 4, {2});
+    write(sink, 4, 2);  // ordered after task 2
+  }
+};
+
+TEST(TraceFormatTests, CheckVarintsRoundTrip) {
+  uint8_t buffer[16];
+  for (uint64_t v : {0ull, 1ull, 127ull, 128ull, 300ull, ~0ull}) {
+    uint8_t * end = putVarint(buffer, v);
+    uint64_t decoded;
+    EXPECT_EQ(end, getVarint(buffer, end, decoded));
+    EXPECT_EQ(v, decoded);
+    EXPECT_EQ(NULL, getVarint(buffer, end - 1, decoded));  // truncated
+  }
+  for (int64_t v : {0ll, 1ll, -1ll, -64ll, 1ll << 40, -(1ll << 62)}) {
+    EXPECT_EQ(v, unzigzag(zigzag(v)));
+  }
+  EXPECT_EQ(1u, zigzag(-1));
+}
+
+TEST_F(TestTraceFixture, CheckRaceOfTwoThreadsIsReplayed) {
+  TraceWriter writer(path);
+  ASSERT_TRUE(writer.isOpen());
+  writer.onTaskCreate(1);
+  writer.onTaskCreate(2);
+  std::thread first([&]() { write(writer, 1, 0); });
+  std::thread second([&]() { write(writer, 2, 1); });
+  first.join();
+  second.join();
+  writer.close();
+
+  TraceReader reader;
+  std::string error;
+  ASSERT_TRUE(reader.open(path, error)) << error;
+  EXPECT_EQ(3, reader.getStreamCount());
+
+  Checker checker;
+  ASSERT_TRUE(reader.replay(checker, error)) << error;
+  EXPECT_EQ(2, reader.getEventCount());
+  EXPECT_EQ(2, reader.getAccessCount());
+  auto & conflicts = checker.getConflicts();
+  EXPECT_EQ(1, conflicts.size());
+  EXPECT_EQ(1, conflicts.count({100, 101}));
+}
+
+TEST_F(TestTraceFixture, CheckReplayMatchesOnlineChecking) {
+  Checker online;
+  runSegments(online);
+
+  TraceWriter writer(path, 256);  // many small chunks
+  runSegments(writer);
+  writer.close();
+
+  TraceReader reader;
+  std::string error;
+  ASSERT_TRUE(reader.open(path, error)) << error;
+  EXPECT_LT(4, reader.getChunkCount());
+
+  Checker offline;
+  {
+    AsyncChecker async(offline, 2);
+    ASSERT_TRUE(reader.replay(async, error)) << error;
+  }
+  EXPECT_EQ(403, reader.getAccessCount());
+  auto & expected = online.getConflicts();
+  auto & replayed = offline.getConflicts();
+  EXPECT_EQ(1, expected.size());
+  ASSERT_EQ(expected.size(), replayed.size());
+  for (auto & lines : expected) {
+    ASSERT_EQ(1, replayed.count(lines.first));
+    EXPECT_EQ(lines.second.size(), replayed[lines.first].size());
+  }
+}
+
+TEST_F(TestTraceFixture, CheckRangeAccessesRoundTrip) {
+  AccessRecord range = makeAccess(1, 0, 0);
+  range.range_size = 4096;
+  AccessRecord strided = makeAccess(3, 0, 2);  // misses addr
+  strided.destination_address = (ADDRESS)((long)addr + 4);
+  strided.range_size = 9 * 32 + 4;
+  strided.range_stride = 32;
+  strided.range_width = 4;
+  {
+    TraceWriter writer(path);
+    writer.onTaskCreate(1);
+    writer.onTaskCreate(2);
+    writer.onTaskCreate(3);
+    writer.saveMemoryAccesses(&range, 1);
+    write(writer, 2, 1);
+    writer.saveMemoryAccesses(&strided, 1);
+    writer.close();
+  }
+
+  TraceReader reader;
+  std::string error;
+  ASSERT_TRUE(reader.open(path, error)) << error;
+  Checker checker;
+  ASSERT_TRUE(reader.replay(checker, error)) << error;
+  EXPECT_EQ(3, reader.getAccessCount());
+  auto & conflicts = checker.getConflicts();
+  EXPECT_EQ(2, conflicts.size());  // the strided range meets only range
+  EXPECT_EQ(1, conflicts.count({100, 101}));
+  EXPECT_EQ(1, conflicts.count({100, 102}));
+}
+
+TEST_F(TestTraceFixture, CheckIncompleteTraceIsRejected) {
+  {
+    TraceWriter writer(path);
+    writer.onTaskCreate(1);
+    write(writer, 1, 0);
+  }
+  TraceReader reader;
+  std::string error;
+  ASSERT_TRUE(reader.open(path, error)) << error;
+
+  ASSERT_EQ(0, truncate(path, reader.getSize() - 1));
+  TraceReader truncated;
+  EXPECT_FALSE(truncated.open(path, error));
+  EXPECT_FALSE(error.empty());
+}
@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "functionengine/FunctionEngine.h"
+
+class TestCallStackFixture : public ::testing::Test {
+protected:
+  CallStack stack;
+  std::vector<uint32_t> frames;
+};
+
+TEST_F(TestCallStackFixture, CheckPushAndPop) {
+  EXPECT_EQ(0, stack.size());
+  EXPECT_EQ(0, stack.hash());
+  stack.push(7);
+  stack.push(8);
+  EXPECT_EQ(2, stack.size());
+  EXPECT_EQ(8, stack.getFrames()[1]);
+  stack.pop();
+  stack.pop();
+  stack.pop();  // more pops than pushes
+  EXPECT_EQ(0, stack.size());
+  EXPECT_EQ(0, stack.hash());
+}
+
+TEST_F(TestCallStackFixture, CheckHashFollowsFrames) {
+  stack.push(1);
+  uint64_t outer = stack.hash();
+  stack.push(2);
+  EXPECT_NE(outer, stack.hash());
+  stack.pop();
+  EXPECT_EQ(outer, stack.hash());
+
+  CallStack swapped;
+  swapped.push(2);
+  swapped.push(1);
+  stack.push(2);
+  EXPECT_NE(swapped.hash(), stack.hash());
+}
+
+TEST_F(TestCallStackFixture, CheckDeepFramesAreCountedNotKept) {
+  for (uint32_t i = 0; i < CALLSTACK_CAPACITY + 10; i++) stack.push(i);
+  EXPECT_EQ(CALLSTACK_CAPACITY, stack.size());
+  uint64_t full = stack.hash();
+  for (int i = 0; i < 10; i++) stack.pop();
+  EXPECT_EQ(full, stack.hash());
+  stack.pop();
+  EXPECT_EQ(CALLSTACK_CAPACITY - 1, stack.size());
+}
+
+TEST_F(TestCallStackFixture, CheckSavedFramesAreRecognized) {
+  EXPECT_TRUE(stack.isSaved());  // the empty stack, id 0
+  stack.push(1);
+  stack.push(2);
+  EXPECT_FALSE(stack.isSaved());
+  stack.setSaved(42);
+  EXPECT_TRUE(stack.isSaved());
+
+  stack.push(3);  // a call and its return
+  EXPECT_FALSE(stack.isSaved());
+  stack.pop();
+  EXPECT_TRUE(stack.isSaved());
+  EXPECT_EQ(42, stack.getSavedID());
+
+  stack.pop();  // same depth, other frame
+  stack.push(5);
+  EXPECT_FALSE(stack.isSaved());
+}
+
+TEST_F(TestCallStackFixture, CheckDepotSavesStacksOnce) {
+  FunctionEngine & depot = FunctionEngine::instance();
+  EXPECT_EQ(0, depot.saveStack(stack));
+
+  stack.push(10);
+  stack.push(20);
+  uint32_t id = depot.saveStack(stack);
+  EXPECT_NE(0, id);
+  CallStack same;
+  same.push(10);
+  same.push(20);
+  EXPECT_EQ(id, depot.saveStack(same));
+
+  stack.pop();
+  EXPECT_NE(id, depot.saveStack(stack));
+
+  ASSERT_TRUE(depot.getStack(id, frames));
+  ASSERT_EQ(2, frames.size());
+  EXPECT_EQ(20, frames[0]);  // innermost first
+  EXPECT_EQ(10, frames[1]);
+  EXPECT_FALSE(depot.getStack(1 << 30, frames));
+}
@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+
+#include "instrumentor/eventlogger/AccessFilter.h"
+
+class TestAccessFilterFixture : public ::testing::Test {
+protected:
+  ADDRESS addr = (ADDRESS)0x1000;
+  AccessFilter filter;
+};
+
+TEST_F(TestAccessFilterFixture, CheckRepeatedReadsAreDropped) {
+  EXPECT_FALSE(filter.isRedundantRead(addr));
+  EXPECT_TRUE(filter.isRedundantRead(addr));
+  EXPECT_TRUE(filter.isRedundantRead(addr));
+}
+
+TEST_F(TestAccessFilterFixture, CheckReadAfterWriteIsDropped) {
+  EXPECT_FALSE(filter.isRedundantWrite(addr, 5));
+  EXPECT_TRUE(filter.isRedundantRead(addr));
+}
+
+TEST_F(TestAccessFilterFixture, CheckWriteAfterReadIsKept) {
+  EXPECT_FALSE(filter.isRedundantRead(addr));
+  EXPECT_FALSE(filter.isRedundantWrite(addr, 5));
+  EXPECT_TRUE(filter.isRedundantWrite(addr, 5));
+}
+
+TEST_F(TestAccessFilterFixture, CheckWriteOfNewValueIsKept) {
+  EXPECT_FALSE(filter.isRedundantWrite(addr, 5));
+  EXPECT_FALSE(filter.isRedundantWrite(addr, 6));
+  EXPECT_TRUE(filter.isRedundantWrite(addr, 6));
+}
+
+TEST_F(TestAccessFilterFixture, CheckLoopOverArrayIsFiltered) {
+  int forwarded = 0;
+  for (int round = 0; round < 10; round++) {
+    for (long i = 0; i < 64; i++) {
+      if (!filter.isRedundantRead((ADDRESS)(0x1000 + i * 8))) forwarded++;
+    }
+  }
+  EXPECT_GE(forwarded, 64);
+  EXPECT_LT(forwarded, 64 * 2);
+}
+
+TEST_F(TestAccessFilterFixture, CheckEvictedAddressIsForwardedAgain) {
+  EXPECT_FALSE(filter.isRedundantRead(addr));
+  // fill every slot with other addresses
+  for (long i = 1; i <= ACCESS_FILTER_SLOTS * 16; i++) {
+    filter.isRedundantRead((ADDRESS)(0x1000 + i * 8));
+  }
+  EXPECT_FALSE(filter.isRedundantRead(addr));
+}
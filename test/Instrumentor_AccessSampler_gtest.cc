@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "instrumentor/eventlogger/AccessSampler.h"
+
+class TestAccessSamplerFixture : public ::testing::Test {
+protected:
+  AccessSampler sampler;
+
+  ADDRESS word(long i) { return (ADDRESS)(0x100000 + i * 8); }
+
+  // lets an adaptation window pass
+  void waitWindow() {
+    std::this_thread::sleep_for(
+        std::chrono::nanoseconds(SAMPLING_WINDOW_NS + 1000000));
+  }
+};
+
+TEST_F(TestAccessSamplerFixture, CheckInvalidSpecsAreRejected) {
+  for (const char * spec : {"task", "task=0", "site=1.5", "address=x",
+                            "task=0.5,cycles=0.1", "budget=-1"}) {
+    EXPECT_FALSE(sampler.configure(spec)) << spec;
+  }
+  EXPECT_FALSE(sampler.isEnabled());
+}
+
+TEST_F(TestAccessSamplerFixture, CheckFullRatesKeepEverything) {
+  ASSERT_TRUE(sampler.configure("task=1,site=1,address=1"));
+  EXPECT_TRUE(sampler.isEnabled());
+  EXPECT_FALSE(sampler.hasBudget());
+  for (long i = 0; i < 1000; i++) {
+    EXPECT_TRUE(sampler.keep(i, word(i), i));
+  }
+}
+
+TEST_F(TestAccessSamplerFixture, CheckAddressRateIsConsistentAcrossTasks) {
+  ASSERT_TRUE(sampler.configure("address=0.25"));
+  long kept = 0;
+  for (long i = 0; i < 100000; i++) {
+    bool first = sampler.keep(1, word(i), 1);
+    // another task and byte of the same word decide alike
+    EXPECT_EQ(first, sampler.keep(2, (ADDRESS)((char *)word(i) + 3), 7));
+    kept += first;
+  }
+  EXPECT_NEAR(0.25, kept / 100000.0, 0.02);
+}
+
+TEST_F(TestAccessSamplerFixture, CheckTaskRateKeepsWholeTasks) {
+  ASSERT_TRUE(sampler.configure("task=0.5"));
+  long keptTasks = 0;
+  for (int task = 0; task < 1000; task++) {
+    bool kept = sampler.keep(task, word(0), 1);
+    for (long i = 1; i < 16; i++) {
+      EXPECT_EQ(kept, sampler.keep(task, word(i), i));
+    }
+    keptTasks += kept;
+  }
+  EXPECT_NEAR(500, keptTasks, 60);
+}
+
+TEST_F(TestAccessSamplerFixture, CheckBudgetAdaptsAddressRate) {
+  ASSERT_TRUE(sampler.configure("address=0.8,budget=0.1"));
+  sampler.addThread();
+  EXPECT_NEAR(0.8, sampler.getAddressRate(), 1e-6);
+
+  waitWindow();
+  sampler.addDetectorTime(SAMPLING_WINDOW_NS * 10);  // far over budget
+  EXPECT_NEAR(0.4, sampler.getAddressRate(), 1e-6);  // at most halved
+
+  waitWindow();
+  sampler.addDetectorTime(0);  // idle detector
+  EXPECT_NEAR(0.5, sampler.getAddressRate(), 1e-6);
+
+  for (int i = 0; i < 3; i++) {
+    waitWindow();
+    sampler.addDetectorTime(0);
+  }
+  EXPECT_NEAR(0.8, sampler.getAddressRate(), 1e-6);  // configured rate
+}
+
+TEST_F(TestAccessSamplerFixture, CheckClearedBudgetKeepsRates) {
+  ASSERT_TRUE(sampler.configure("address=0.8,budget=0.1"));
+  sampler.clearBudget();
+  EXPECT_FALSE(sampler.hasBudget());
+  EXPECT_NEAR(0.8, sampler.getAddressRate(), 1e-6);
+  EXPECT_EQ(std::string::npos, sampler.describe().find("budget"));
+}
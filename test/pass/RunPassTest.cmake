@@ -0,0 +1,27 @@
+##################################################################
+##  TaskSanitizer: a lightweight determinacy race checking
+##          tool for OpenMP task applications
+##
+##    Copyright (c) 2015 - 2021 Hassan Salehe Matar
+##      Copying or using this code by any means whatsoever
+##      without consent of the owner is strictly prohibited.
+##
+##   Contact: hassansalehe-at-gmail-dot-com
+##
+##################################################################
+
+# Runs the pass on an IR file through opt, which verifies the
+# result, and matches the output against the CHECK lines of the file.
+# Usage: cmake -DOPT=... -DFILECHECK=... -DPASS=... -DINPUT=...
+#              -P RunPassTest.cmake
+
+execute_process(
+  COMMAND ${OPT} -load ${PASS} -O1 -verify -S ${INPUT}
+  COMMAND ${FILECHECK} ${INPUT}
+  RESULTS_VARIABLE results)
+
+foreach(result ${results})
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "pass test ${INPUT} failed: ${results}")
+  endif()
+endforeach()
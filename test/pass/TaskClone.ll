@@ -0,0 +1,43 @@
+; Checks that the accesses of a function cloned for task context
+; load the site base in the clone, not in the original function.
+; helper is called from a task and is visible to serial code, so
+; the pass clones it; the verifier rejects the module if the clone
+; uses a value of the original.
+;
+; CHECK-LABEL: define void @helper(
+; CHECK-NOT: tasksan.site_base
+; CHECK: ret void
+; CHECK-LABEL: define internal void @helper.tasksan(
+; CHECK: load i32, i32* @tasksan.site_base
+
+@shared = global i32 0, align 4
+
+define void @helper() #0 !dbg !6 {
+entry:
+  store i32 1, i32* @shared, align 4, !dbg !7
+  ret void, !dbg !8
+}
+
+define void @.omp_outlined.() !dbg !9 {
+entry:
+  call void @helper(), !dbg !10
+  ret void, !dbg !11
+}
+
+attributes #0 = { noinline }
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3, !4}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang", isOptimized: false, runtimeVersion: 0, emissionKind: FullDebug, enums: !2)
+!1 = !DIFile(filename: "clone.c", directory: "/tmp")
+!2 = !{}
+!3 = !{i32 2, !"Dwarf Version", i32 4}
+!4 = !{i32 2, !"Debug Info Version", i32 3}
+!5 = !DISubroutineType(types: !2)
+!6 = distinct !DISubprogram(name: "helper", scope: !1, file: !1, line: 3, type: !5, isLocal: false, isDefinition: true, scopeLine: 3, isOptimized: false, unit: !0)
+!7 = !DILocation(line: 4, column: 10, scope: !6)
+!8 = !DILocation(line: 5, column: 1, scope: !6)
+!9 = distinct !DISubprogram(name: ".omp_outlined.", scope: !1, file: !1, line: 7, type: !5, isLocal: false, isDefinition: true, scopeLine: 7, isOptimized: false, unit: !0)
+!10 = !DILocation(line: 8, column: 3, scope: !9)
+!11 = !DILocation(line: 9, column: 1, scope: !9)
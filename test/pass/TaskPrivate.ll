@@ -0,0 +1,58 @@
+; Checks which accesses the pass treats as private to a task.
+; A heap block whose pointer stays in the function is private, also
+; when the pointer is spilled to an alloca as clang does at -O0.
+; thread_local variables are shared by the tasks of a thread, so
+; their accesses are checked.
+;
+; CHECK-LABEL: define void @.omp_outlined..heap(
+; CHECK-NOT: __tasksan_write4
+; CHECK: ret void
+; CHECK-LABEL: define void @.omp_outlined..tls(
+; CHECK: __tasksan_write4
+; CHECK: ret void
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+@counter = thread_local global i32 0, align 4
+
+define void @.omp_outlined..heap() !dbg !6 {
+entry:
+  %p = alloca i32*, align 8
+  %call = call i8* @malloc(i64 4), !dbg !7
+  %0 = bitcast i8* %call to i32*, !dbg !7
+  store i32* %0, i32** %p, align 8, !dbg !7
+  %1 = load i32*, i32** %p, align 8, !dbg !8
+  store i32 1, i32* %1, align 4, !dbg !8
+  %2 = load i32*, i32** %p, align 8, !dbg !9
+  %3 = bitcast i32* %2 to i8*, !dbg !9
+  call void @free(i8* %3), !dbg !9
+  ret void, !dbg !10
+}
+
+define void @.omp_outlined..tls() !dbg !11 {
+entry:
+  store i32 1, i32* @counter, align 4, !dbg !12
+  ret void, !dbg !13
+}
+
+declare i8* @malloc(i64)
+declare void @free(i8*)
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3, !4}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang", isOptimized: false, runtimeVersion: 0, emissionKind: FullDebug, enums: !2)
+!1 = !DIFile(filename: "private.c", directory: "/tmp")
+!2 = !{}
+!3 = !{i32 2, !"Dwarf Version", i32 4}
+!4 = !{i32 2, !"Debug Info Version", i32 3}
+!5 = !DISubroutineType(types: !2)
+!6 = distinct !DISubprogram(name: "heap", scope: !1, file: !1, line: 3, type: !5, isLocal: false, isDefinition: true, scopeLine: 3, isOptimized: false, unit: !0)
+!7 = !DILocation(line: 4, column: 12, scope: !6)
+!8 = !DILocation(line: 5, column: 6, scope: !6)
+!9 = !DILocation(line: 6, column: 3, scope: !6)
+!10 = !DILocation(line: 7, column: 1, scope: !6)
+!11 = distinct !DISubprogram(name: "tls", scope: !1, file: !1, line: 9, type: !5, isLocal: false, isDefinition: true, scopeLine: 9, isOptimized: false, unit: !0)
+!12 = !DILocation(line: 10, column: 11, scope: !11)
+!13 = !DILocation(line: 11, column: 1, scope: !11)
@@ -0,0 +1,38 @@
+; Checks that a read repeated after a taskwait is checked again.
+; The taskwait does not touch the location, so MemorySSA optimizes
+; the second read past it; it still ends the task segment.
+;
+; CHECK-LABEL: define void @.omp_outlined.(
+; CHECK: __tasksan_read4
+; CHECK: __kmpc_omp_taskwait
+; CHECK: __tasksan_read4
+; CHECK: ret i32
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define i32 @.omp_outlined.(i32* noalias %p, i8* %loc, i32 %gtid) !dbg !6 {
+entry:
+  %0 = load i32, i32* %p, align 4, !dbg !7
+  %1 = call i32 @__kmpc_omp_taskwait(i8* %loc, i32 %gtid), !dbg !8
+  %2 = load i32, i32* %p, align 4, !dbg !9
+  %3 = add i32 %0, %2, !dbg !9
+  ret i32 %3, !dbg !10
+}
+
+declare i32 @__kmpc_omp_taskwait(i8*, i32)
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3, !4}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang", isOptimized: false, runtimeVersion: 0, emissionKind: FullDebug, enums: !2)
+!1 = !DIFile(filename: "segment.c", directory: "/tmp")
+!2 = !{}
+!3 = !{i32 2, !"Dwarf Version", i32 4}
+!4 = !{i32 2, !"Debug Info Version", i32 3}
+!5 = !DISubroutineType(types: !2)
+!6 = distinct !DISubprogram(name: "segment", scope: !1, file: !1, line: 3, type: !5, isLocal: false, isDefinition: true, scopeLine: 3, isOptimized: false, unit: !0)
+!7 = !DILocation(line: 4, column: 11, scope: !6)
+!8 = !DILocation(line: 5, column: 3, scope: !6)
+!9 = !DILocation(line: 6, column: 11, scope: !6)
+!10 = !DILocation(line: 7, column: 3, scope: !6)